@@ -0,0 +1,68 @@
+#pragma once
+#include "pch.h"
+#include "Debugger/DebugUtilities.h"
+
+//Lookup table of the items (breakpoints, script callbacks, etc.) whose address range overlaps each 4 KB page,
+//for each memory type. Items must be added in increasing index order, so each page's list stays sorted.
+class AddressRangeIndex
+{
+public:
+	static constexpr uint32_t PageShift = 12;
+
+	//Memory types whose size is unknown (0) are indexed up to this address - items that go beyond it
+	//are also added to the type's overflow list, which is used for all higher addresses
+	static constexpr uint32_t MaxUnknownSizeAddress = 0xFFFFFF;
+
+private:
+	vector<vector<uint32_t>> _pages[DebugUtilities::GetMemoryTypeCount()];
+	vector<uint32_t> _overflow[DebugUtilities::GetMemoryTypeCount()];
+
+public:
+	void Clear()
+	{
+		for(int i = 0; i < DebugUtilities::GetMemoryTypeCount(); i++) {
+			_pages[i].clear();
+			_overflow[i].clear();
+		}
+	}
+
+	//memSize is the size of the memory type, or 0 if it is unknown
+	void Add(MemoryType memType, int32_t startAddr, int32_t endAddr, uint32_t memSize, uint32_t itemIndex)
+	{
+		startAddr = std::max(startAddr, 0);
+		if(endAddr < startAddr) {
+			return;
+		}
+
+		uint32_t maxAddr = memSize > 0 ? memSize - 1 : AddressRangeIndex::MaxUnknownSizeAddress;
+		if(memSize == 0 && (uint32_t)endAddr > maxAddr) {
+			_overflow[(int)memType].push_back(itemIndex);
+		}
+
+		if((uint32_t)startAddr > maxAddr) {
+			return;
+		}
+
+		vector<vector<uint32_t>>& pages = _pages[(int)memType];
+		uint32_t lastPage = std::min((uint32_t)endAddr, maxAddr) >> AddressRangeIndex::PageShift;
+		if(pages.size() <= lastPage) {
+			pages.resize(lastPage + 1);
+		}
+		for(uint32_t page = (uint32_t)startAddr >> AddressRangeIndex::PageShift; page <= lastPage; page++) {
+			pages[page].push_back(itemIndex);
+		}
+	}
+
+	//Returns the sorted indexes of the items that may contain this address, or nullptr if there are none
+	__forceinline vector<uint32_t>* GetCandidates(MemoryType memType, int32_t addr)
+	{
+		if(addr < 0) {
+			return nullptr;
+		}
+
+		vector<vector<uint32_t>>& pages = _pages[(int)memType];
+		uint32_t page = (uint32_t)addr >> AddressRangeIndex::PageShift;
+		vector<uint32_t>* candidates = page < pages.size() ? &pages[page] : &_overflow[(int)memType];
+		return candidates->empty() ? nullptr : candidates;
+	}
+};
@@ -106,14 +106,6 @@ enum class RowDataType
 	FlagsB
 };
 
-struct TraceLogPpuState
-{
-	uint32_t Cycle;
-	uint32_t HClock;
-	int32_t Scanline;
-	uint32_t FrameCount;
-};
-
 struct RowPart
 {
 	RowDataType DataType;
@@ -122,9 +114,22 @@ struct RowPart
 	int MinWidth;
 };
 
+//Parsed format string, and the options that affect how rows are formatted
+struct TraceLogRowFormat
+{
+	vector<RowPart> Parts;
+	bool IndentCode = false;
+	bool UseLabels = false;
+
+	//Set when the format contains tags that read memory (these values must be captured when the row is logged to a file)
+	bool NeedMemoryInfo = false;
+};
+
 template<typename TraceLoggerType, typename CpuStateType>
 class BaseTraceLogger : public ITraceLogger
 {
+	static_assert(std::is_trivially_copyable<CpuStateType>::value, "CPU state is saved as raw bytes in trace log files");
+
 protected:
 	static constexpr int ExecutionLogSize = 30000;
 
@@ -138,7 +143,11 @@ protected:
 	CpuType _cpuType = CpuType::Snes;
 	MemoryType _cpuMemoryType = MemoryType::SnesMemory;
 
-	vector<RowPart> _rowParts;
+	TraceLogRowFormat _rowFormat;
+
+	//Copy of _rowFormat taken when logging to a file starts - used to capture and format the file's rows,
+	//so the rows are formatted with the options that were active when they were logged
+	TraceLogRowFormat _fileRowFormat;
 
 	uint32_t _currentPos = 0;
 
@@ -165,17 +174,17 @@ protected:
 		WriteStringValue(output, byteCode, rowPart);
 	}
 
-	void WriteDisassembly(DisassemblyInfo& info, RowPart& rowPart, uint8_t sp, uint32_t pc, string& output)
+	void WriteDisassembly(DisassemblyInfo& info, RowPart& rowPart, uint8_t sp, uint32_t pc, string& output, TraceLogRowFormat& format)
 	{
 		int indentLevel = 0;
 		size_t startPos = output.size();
 
-		if(_options.IndentCode) {
+		if(format.IndentCode) {
 			indentLevel = 0xFF - (sp & 0xFF);
 			output += std::string(indentLevel / 2, ' ');
 		}
 
-		LabelManager* labelManager = _options.UseLabels ? _labelManager : nullptr;
+		LabelManager* labelManager = format.UseLabels ? _labelManager : nullptr;
 		info.GetDisassembly(output, pc, labelManager, _settings);
 
 		if(rowPart.MinWidth > (int)(output.size() - startPos)) {
@@ -183,12 +192,24 @@ protected:
 		}
 	}
 	
-	void WriteEffectiveAddress(DisassemblyInfo& info, RowPart& rowPart, void* cpuState, string& output, MemoryType cpuMemoryType, CpuType cpuType)
+	TraceLogMemoryInfo GetMemoryInfo(DisassemblyInfo& info, void* cpuState)
+	{
+		TraceLogMemoryInfo memInfo = {};
+		memInfo.EffectiveAddress = info.GetEffectiveAddress(_debugger, cpuState, _cpuType);
+		EffectiveAddressInfo& effectiveAddress = memInfo.EffectiveAddress;
+		if(effectiveAddress.Address.Address >= 0 && effectiveAddress.ValueSize > 0) {
+			MemoryType effectiveMemType = effectiveAddress.Address.Type == MemoryType::None ? _cpuMemoryType : effectiveAddress.Address.Type;
+			memInfo.MemoryValue = info.GetMemoryValue(effectiveAddress, _memoryDumper, effectiveMemType);
+		}
+		return memInfo;
+	}
+
+	void WriteEffectiveAddress(TraceLogMemoryInfo& memInfo, RowPart& rowPart, string& output, TraceLogRowFormat& format)
 	{
-		EffectiveAddressInfo effectiveAddress = info.GetEffectiveAddress(_debugger, cpuState, cpuType);
+		EffectiveAddressInfo& effectiveAddress = memInfo.EffectiveAddress;
 		if(effectiveAddress.ShowAddress && effectiveAddress.Address.Address >= 0) {
-			MemoryType effectiveMemType = effectiveAddress.Address.Type == MemoryType::None ? cpuMemoryType : effectiveAddress.Address.Type;
-			if(_options.UseLabels) {
+			MemoryType effectiveMemType = effectiveAddress.Address.Type == MemoryType::None ? _cpuMemoryType : effectiveAddress.Address.Type;
+			if(format.UseLabels) {
 				AddressInfo addr { effectiveAddress.Address.Address, effectiveMemType };
 				string label = _labelManager->GetLabel(addr);
 				if(!label.empty()) {
@@ -197,22 +218,20 @@ protected:
 				}
 			}
 
-			WriteStringValue(output, " [$" + DebugUtilities::AddressToHex(cpuType, effectiveAddress.Address.Address) + "]", rowPart);
+			WriteStringValue(output, " [$" + DebugUtilities::AddressToHex(_cpuType, effectiveAddress.Address.Address) + "]", rowPart);
 		}
 	}
 
-	void WriteMemoryValue(DisassemblyInfo& info, RowPart& rowPart, void* cpuState, string& output, MemoryType memType, CpuType cpuType)
+	void WriteMemoryValue(TraceLogMemoryInfo& memInfo, RowPart& rowPart, string& output)
 	{
-		EffectiveAddressInfo effectiveAddress = info.GetEffectiveAddress(_debugger, cpuState, cpuType);
+		EffectiveAddressInfo& effectiveAddress = memInfo.EffectiveAddress;
 		if(effectiveAddress.Address.Address >= 0 && effectiveAddress.ValueSize > 0) {
-			MemoryType effectiveMemType = effectiveAddress.Address.Type == MemoryType::None ? memType : effectiveAddress.Address.Type;
-			uint16_t value = info.GetMemoryValue(effectiveAddress, _memoryDumper, effectiveMemType);
 			if(rowPart.DisplayInHex) {
 				output += "= $";
 				if(effectiveAddress.ValueSize == 2) {
-					WriteIntValue(output, (uint16_t)value, rowPart);
+					WriteIntValue(output, (uint16_t)memInfo.MemoryValue, rowPart);
 				} else {
-					WriteIntValue(output, (uint8_t)value, rowPart);
+					WriteIntValue(output, (uint8_t)memInfo.MemoryValue, rowPart);
 				}
 			} else {
 				output += "= ";
@@ -278,19 +297,18 @@ protected:
 
 		_pendingLog = false;
 
-		if(_debugger->GetTraceLogFileSaver()->IsEnabled()) {
-			string row;
-			row.reserve(300);
-			
-			//Display PC
-			RowPart rowPart = {};
-			rowPart.DisplayInHex = true;
-			rowPart.MinWidth = DebugUtilities::GetProgramCounterSize(_cpuType);
-			WriteIntValue(row, ((TraceLoggerType*)this)->GetProgramCounter(cpuState), rowPart);
-			row += "  ";
-
-			((TraceLoggerType*)this)->GetTraceRow(row, cpuState, _ppuState[_currentPos], disassemblyInfo);
-			_debugger->GetTraceLogFileSaver()->Log(row);
+		TraceLogFileSaver* fileSaver = _debugger->GetTraceLogFileSaver();
+		if(fileSaver->IsEnabled()) {
+			//Only the raw state is saved here, rows are formatted to text once logging stops
+			TraceLogRecordHeader header;
+			header.RowId = _rowIds[_currentPos];
+			header.Type = _cpuType;
+			header.PpuState = _ppuState[_currentPos];
+			header.Disassembly = disassemblyInfo;
+			if(_fileRowFormat.NeedMemoryInfo) {
+				header.MemoryInfo = GetMemoryInfo(disassemblyInfo, &cpuState);
+			}
+			fileSaver->Log(header, (uint8_t*)&cpuState, sizeof(CpuStateType));
 		}
 
 		_currentPos = (_currentPos + 1) % ExecutionLogSize;
@@ -298,7 +316,8 @@ protected:
 
 	void ParseFormatString(string format)
 	{
-		_rowParts.clear();
+		_rowFormat.Parts.clear();
+		_rowFormat.NeedMemoryInfo = false;
 
 		std::regex formatRegex = std::regex("(\\[\\s*([^[]*?)\\s*(,\\s*([\\d]*)\\s*(h){0,1}){0,1}\\s*\\])|([^[]*)", std::regex_constants::icase);
 		std::sregex_iterator start = std::sregex_iterator(format.cbegin(), format.cend(), formatRegex);
@@ -311,7 +330,7 @@ protected:
 				RowPart part = {};
 				part.DataType = RowDataType::Text;
 				part.Text = match.str(6);
-				_rowParts.push_back(part);
+				_rowFormat.Parts.push_back(part);
 			} else {
 				RowPart part = {};
 
@@ -329,7 +348,11 @@ protected:
 				}
 				part.DisplayInHex = match.str(5) == "h";
 
-				_rowParts.push_back(part);
+				if(part.DataType == RowDataType::EffectiveAddress || part.DataType == RowDataType::MemoryValue) {
+					_rowFormat.NeedMemoryInfo = true;
+				}
+
+				_rowFormat.Parts.push_back(part);
 			}
 		}
 	}
@@ -365,14 +388,24 @@ protected:
 
 	virtual RowDataType GetFormatTagType(string& tag) = 0;
 
-	void ProcessSharedTag(RowPart& rowPart, string& output, CpuStateType& cpuState, TraceLogPpuState& ppuState, DisassemblyInfo& disassemblyInfo)
+	//memInfo contains the values captured when the row was logged (when formatting a trace log file), or nullptr to read them from the current state
+	void ProcessSharedTag(RowPart& rowPart, string& output, CpuStateType& cpuState, TraceLogPpuState& ppuState, DisassemblyInfo& disassemblyInfo, TraceLogRowFormat& format, TraceLogMemoryInfo* memInfo)
 	{
 		switch(rowPart.DataType) {
 			case RowDataType::Text: output += rowPart.Text; break;
 			case RowDataType::ByteCode: WriteByteCode(disassemblyInfo, rowPart, output); break;
-			case RowDataType::Disassembly: WriteDisassembly(disassemblyInfo, rowPart, ((TraceLoggerType*)this)->GetStackPointer(cpuState), ((TraceLoggerType*)this)->GetProgramCounter(cpuState), output); break;
-			case RowDataType::EffectiveAddress: WriteEffectiveAddress(disassemblyInfo, rowPart, &cpuState, output, _cpuMemoryType, _cpuType); break;
-			case RowDataType::MemoryValue: WriteMemoryValue(disassemblyInfo, rowPart, &cpuState, output, _cpuMemoryType, _cpuType); break;
+			case RowDataType::Disassembly: WriteDisassembly(disassemblyInfo, rowPart, ((TraceLoggerType*)this)->GetStackPointer(cpuState), ((TraceLoggerType*)this)->GetProgramCounter(cpuState), output, format); break;
+			case RowDataType::EffectiveAddress:
+			case RowDataType::MemoryValue: {
+				TraceLogMemoryInfo rowMemInfo = memInfo ? *memInfo : GetMemoryInfo(disassemblyInfo, &cpuState);
+				if(rowPart.DataType == RowDataType::EffectiveAddress) {
+					WriteEffectiveAddress(rowMemInfo, rowPart, output, format);
+				} else {
+					WriteMemoryValue(rowMemInfo, rowPart, output);
+				}
+				break;
+			}
+
 			case RowDataType::Align: WriteAlign(0, rowPart, output); break;
 
 			case RowDataType::Cycle: WriteIntValue(output, ppuState.Cycle, rowPart); break;
@@ -477,6 +510,8 @@ public:
 		}
 
 		ParseFormatString(format);
+		_rowFormat.IndentCode = _options.IndentCode;
+		_rowFormat.UseLabels = _options.UseLabels;
 		
 		_debugger->ProcessConfigChange();
 	}
@@ -502,6 +537,30 @@ public:
 		return true;
 	}
 
+	uint32_t GetCpuStateSize() override
+	{
+		return sizeof(CpuStateType);
+	}
+
+	void StartFileLogging() override
+	{
+		_fileRowFormat = _rowFormat;
+	}
+
+	void FormatRecord(TraceLogRecordHeader& header, uint8_t* cpuState, string& output) override
+	{
+		CpuStateType state;
+		memcpy(&state, cpuState, sizeof(CpuStateType));
+
+		RowPart rowPart = {};
+		rowPart.DisplayInHex = true;
+		rowPart.MinWidth = DebugUtilities::GetProgramCounterSize(_cpuType);
+		WriteIntValue(output, ((TraceLoggerType*)this)->GetProgramCounter(state), rowPart);
+		output += "  ";
+
+		((TraceLoggerType*)this)->GetTraceRow(output, state, header.PpuState, header.Disassembly, _fileRowFormat, &header.MemoryInfo);
+	}
+
 	void GetExecutionTrace(TraceRow& row, uint32_t offset) override
 	{
 		int pos = ((int)_currentPos - offset);
@@ -510,7 +569,7 @@ public:
 		CpuStateType& state = _cpuState[index];
 		string logOutput;
 		logOutput.reserve(300);
-		((TraceLoggerType*)this)->GetTraceRow(logOutput, state, _ppuState[index], _disassemblyCache[index]);
+		((TraceLoggerType*)this)->GetTraceRow(logOutput, state, _ppuState[index], _disassemblyCache[index], _rowFormat, nullptr);
 
 		row.Type = _cpuType;
 		_disassemblyCache[index].GetByteCode(row.ByteCode);
@@ -6,6 +6,7 @@
 #include "Debugger/DebugUtilities.h"
 #include "Debugger/ExpressionEvaluator.h"
 #include "Debugger/BaseEventManager.h"
+#include "Debugger/MemoryDumper.h"
 #include "Shared/MemoryOperationType.h"
 
 BreakpointManager::BreakpointManager(Debugger *debugger, IDebugger* cpuDebugger, CpuType cpuType, BaseEventManager* eventManager)
@@ -25,6 +26,7 @@ void BreakpointManager::SetBreakpoints(Breakpoint breakpoints[], uint32_t count)
 		_breakpoints[i].clear();
 		_rpnList[i].clear();
 		_hasBreakpointType[i] = false;
+		_pageIndex[i].Clear();
 	}
 
 	_bpExpEval.reset(new ExpressionEvaluator(_debugger, _cpuDebugger, _cpuType));
@@ -39,10 +41,14 @@ void BreakpointManager::SetBreakpoints(Breakpoint breakpoints[], uint32_t count)
 					continue;
 				}
 
-				if(bp.IsAllowedForOpType(opType)) {
-					_breakpoints[i].push_back(bp);
+				if(!bp.IsAllowedForOpType(opType)) {
+					continue;
 				}
 
+				uint32_t memSize = _debugger->GetMemoryDumper()->GetMemorySize(bp.GetMemoryType());
+				_pageIndex[i].Add(bp.GetMemoryType(), bp.GetStartAddress(), bp.GetEndAddress(), memSize, (uint32_t)_breakpoints[i].size());
+				_breakpoints[i].push_back(bp);
+
 				if(bp.HasCondition()) {
 					bool success = true;
 					ExpressionData data = _bpExpEval->GetRpnList(bp.GetCondition(), success);
@@ -83,11 +89,36 @@ BreakpointType BreakpointManager::GetBreakpointType(MemoryOperationType type)
 
 int BreakpointManager::InternalCheckBreakpoint(MemoryOperationInfo operationInfo, AddressInfo &address, bool processMarkedBreakpoints)
 {
+	//Breakpoints on relative memory match the operation's address, others match the absolute address
+	int opType = (int)operationInfo.Type;
+	bool isRelative = DebugUtilities::IsRelativeMemory(operationInfo.MemType);
+	vector<uint32_t>* relCandidates = isRelative ? _pageIndex[opType].GetCandidates(operationInfo.MemType, operationInfo.Address) : nullptr;
+	vector<uint32_t>* absCandidates = nullptr;
+	if(address.Address >= 0 && !(isRelative && address.Type == operationInfo.MemType)) {
+		absCandidates = _pageIndex[opType].GetCandidates(address.Type, address.Address);
+	}
+
+	if(!relCandidates && !absCandidates) {
+		return -1;
+	}
+
+	//Check candidates in the same order as the breakpoint list (both lists are sorted)
 	EvalResultType resultType;
-	vector<Breakpoint> &breakpoints = _breakpoints[(int)operationInfo.Type];
-	for(size_t i = 0, len = breakpoints.size(); i < len; i++) {
+	vector<Breakpoint> &breakpoints = _breakpoints[opType];
+	size_t relCount = relCandidates ? relCandidates->size() : 0;
+	size_t absCount = absCandidates ? absCandidates->size() : 0;
+	size_t relPos = 0;
+	size_t absPos = 0;
+	while(relPos < relCount || absPos < absCount) {
+		uint32_t i;
+		if(absPos >= absCount || (relPos < relCount && (*relCandidates)[relPos] < (*absCandidates)[absPos])) {
+			i = (*relCandidates)[relPos++];
+		} else {
+			i = (*absCandidates)[absPos++];
+		}
+
 		if(breakpoints[i].Matches(operationInfo, address)) {
-			if(breakpoints[i].HasCondition() && !_bpExpEval->Evaluate(_rpnList[(int)operationInfo.Type][i], resultType, operationInfo, address)) {
+			if(breakpoints[i].HasCondition() && !_bpExpEval->Evaluate(_rpnList[opType][i], resultType, operationInfo, address)) {
 				continue;
 			}
 
@@ -3,6 +3,7 @@
 #include "Debugger/Breakpoint.h"
 #include "Debugger/DebugTypes.h"
 #include "Debugger/DebugUtilities.h"
+#include "Debugger/AddressRangeIndex.h"
 
 class ExpressionEvaluator;
 class Debugger;
@@ -26,6 +27,9 @@ private:
 	bool _hasBreakpoint;
 	bool _hasBreakpointType[BreakpointTypeCount] = {};
 
+	//Indexes (in _breakpoints) of the breakpoints that overlap each 4 KB page, for each operation type
+	AddressRangeIndex _pageIndex[BreakpointTypeCount];
+
 	unique_ptr<ExpressionEvaluator> _bpExpEval;
 
 	BreakpointType GetBreakpointType(MemoryOperationType type);
@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include "Debugger/DebugTypes.h"
+#include "Debugger/DisassemblyInfo.h"
 
 struct TraceRow
 {
@@ -12,6 +13,30 @@ struct TraceRow
 	char LogOutput[500];
 };
 
+struct TraceLogPpuState
+{
+	uint32_t Cycle;
+	uint32_t HClock;
+	int32_t Scanline;
+	uint32_t FrameCount;
+};
+
+struct TraceLogMemoryInfo
+{
+	EffectiveAddressInfo EffectiveAddress;
+	uint16_t MemoryValue = 0;
+};
+
+//Fixed-size header of each row in a binary trace log file, followed by the CPU's state (GetCpuStateSize() bytes)
+struct TraceLogRecordHeader
+{
+	uint64_t RowId;
+	CpuType Type;
+	TraceLogPpuState PpuState;
+	DisassemblyInfo Disassembly;
+	TraceLogMemoryInfo MemoryInfo;
+};
+
 struct TraceLoggerOptions
 {
 	bool Enabled;
@@ -34,5 +59,12 @@ public:
 	virtual void Clear() = 0;
 	virtual void SetOptions(TraceLoggerOptions options) = 0;
 
+	virtual uint32_t GetCpuStateSize() = 0;
+
+	//Called (while execution is paused) when logging to a file starts, to keep a copy of the current format for the file
+	virtual void StartFileLogging() = 0;
+	//Called by the trace log file saver's thread, uses the format copied by StartFileLogging()
+	virtual void FormatRecord(TraceLogRecordHeader& header, uint8_t* cpuState, string& output) = 0;
+
 	__forceinline bool IsEnabled() { return _enabled; }
 };
@@ -17,7 +17,6 @@
 #include "Shared/Emulator.h"
 #include "Shared/Video/BaseVideoFilter.h"
 #include "Shared/Video/VideoRenderer.h"
-#include "Shared/Video/DrawScreenBufferCommand.h"
 #include "Shared/Video/DrawStringCommand.h"
 #include "Shared/KeyManager.h"
 #include "Shared/Interfaces/IConsole.h"
@@ -58,6 +57,29 @@ Emulator* LuaApi::_emu = nullptr;
 MemoryDumper* LuaApi::_memoryDumper = nullptr;
 ScriptingContext* LuaApi::_context = nullptr;
 
+enum class LuaStateHandleType : uint8_t
+{
+	Field,
+	Dynamic,
+	FrameCount,
+	MasterClock,
+	ClockRate,
+	ConsoleType,
+	Region
+};
+
+//Userdata returned by emu.getStateHandle - the state path (null-terminated) is stored right after the struct
+struct LuaStateHandle
+{
+	std::weak_ptr<IConsole> Console;
+	SerializeMapPointer Field;
+	LuaStateHandleType Type;
+
+	const char* GetPath() { return (const char*)this + sizeof(LuaStateHandle); }
+};
+
+static constexpr const char* StateHandleMetatable = "Mesen.StateHandle";
+
 enum class AccessCounterType
 {
 	ReadCount,
@@ -92,6 +114,8 @@ int LuaApi::GetLibrary(lua_State *lua)
 		{ "write", LuaApi::WriteMemory },
 		{ "readWord", LuaApi::ReadMemoryWord },
 		{ "writeWord", LuaApi::WriteMemoryWord },
+		{ "readRange", LuaApi::ReadMemoryRange },
+		{ "writeRange", LuaApi::WriteMemoryRange },
 		
 		{ "convertAddress", LuaApi::ConvertAddress },
 		{ "getLabelAddress", LuaApi::GetLabelAddress },
@@ -144,6 +168,10 @@ int LuaApi::GetLibrary(lua_State *lua)
 
 		{ "getState", LuaApi::GetState },
 		{ "setState", LuaApi::SetState },
+		{ "getStateHandle", LuaApi::GetStateHandle },
+		{ "getStateHandles", LuaApi::GetStateHandles },
+		{ "readStateHandle", LuaApi::ReadStateHandle },
+		{ "readStateHandles", LuaApi::ReadStateHandles },
 
 		{ "selectDrawSurface", LuaApi::SelectDrawSurface },
 
@@ -153,6 +181,12 @@ int LuaApi::GetLibrary(lua_State *lua)
 		{ NULL,NULL }
 	};
 
+	//Metatable used by the handles returned by getStateHandle
+	luaL_newmetatable(lua, StateHandleMetatable);
+	lua_pushcfunction(lua, LuaApi::FreeStateHandle);
+	lua_setfield(lua, -2, "__gc");
+	lua_pop(lua, 1);
+
 	luaL_newlib(lua, apilib);
 
 	//Expose MemoryType enum as "emu.memType"
@@ -299,6 +333,47 @@ int LuaApi::WriteMemoryWord(lua_State *lua)
 	return l.ReturnCount();
 }
 
+int LuaApi::ReadMemoryRange(lua_State *lua)
+{
+	LuaCallHelper l(lua);
+	int type = l.ReadInteger();
+	bool disableSideEffects = (type & 0x100) == 0x100;
+	MemoryType memType = (MemoryType)(type & 0xFF);
+	int length = l.ReadInteger();
+	int address = l.ReadInteger();
+	checkparams();
+	errorCond(address < 0, "address must be >= 0");
+	errorCond(length < 0, "length must be >= 0");
+	checkEnum(MemoryType, memType, "invalid memory type");
+	errorCond((int64_t)address + length > _memoryDumper->GetMemorySize(memType), "range is out of bounds");
+
+	//Return the data as a binary string, written directly into the string's buffer
+	luaL_Buffer buffer;
+	uint8_t* data = (uint8_t*)luaL_buffinitsize(lua, &buffer, length);
+	_memoryDumper->GetMemoryRange(memType, address, length, data, disableSideEffects);
+	luaL_pushresultsize(&buffer, length);
+	return 1;
+}
+
+int LuaApi::WriteMemoryRange(lua_State *lua)
+{
+	LuaCallHelper l(lua);
+	int type = l.ReadInteger();
+	bool disableSideEffects = (type & 0x100) == 0x100;
+	MemoryType memType = (MemoryType)(type & 0xFF);
+	string data = l.ReadString();
+	int address = l.ReadInteger();
+	checkparams();
+	errorCond(address < 0, "address must be >= 0");
+	checkEnum(MemoryType, memType, "invalid memory type");
+	errorCond((int64_t)address + data.size() > _memoryDumper->GetMemorySize(memType), "range is out of bounds");
+
+	for(size_t i = 0; i < data.size(); i++) {
+		_memoryDumper->SetMemoryValue(memType, address + (uint32_t)i, (uint8_t)data[i], disableSideEffects);
+	}
+	return l.ReturnCount();
+}
+
 int LuaApi::ConvertAddress(lua_State *lua)
 {
 	LuaCallHelper l(lua);
@@ -614,10 +689,26 @@ std::pair<unique_ptr<BaseVideoFilter>, FrameInfo> LuaApi::GetRenderedFrame()
 int LuaApi::GetScreenBuffer(lua_State *lua)
 {
 	LuaCallHelper l(lua);
+	l.ForceParamCount(1);
+	bool packed = l.ReadBool();
+	checkminparams(0);
 
 	auto [filter, frameSize] = GetRenderedFrame();
 	uint32_t* rgbBuffer = filter->GetOutputBuffer();
 
+	if(packed) {
+		//Return a binary string containing a 32-bit (little endian) value for each pixel
+		uint32_t length = frameSize.Height * frameSize.Width * sizeof(uint32_t);
+		luaL_Buffer buffer;
+		uint8_t* data = (uint8_t*)luaL_buffinitsize(lua, &buffer, length);
+		for(uint32_t i = 0, len = frameSize.Height * frameSize.Width; i < len; i++) {
+			uint32_t color = rgbBuffer[i] & 0xFFFFFF;
+			memcpy(data + i * sizeof(uint32_t), &color, sizeof(uint32_t));
+		}
+		luaL_pushresultsize(&buffer, length);
+		return 1;
+	}
+
 	lua_createtable(lua, frameSize.Height*frameSize.Width, 0);
 	for(int32_t i = 0, len = frameSize.Height * frameSize.Width; i < len; i++) {
 		lua_pushinteger(lua, rgbBuffer[i] & 0xFFFFFF);
@@ -634,17 +725,29 @@ int LuaApi::SetScreenBuffer(lua_State *lua)
 	FrameInfo size = InternalGetScreenSize();
 
 	int startFrame = _emu->GetFrameCount();
-	unique_ptr<DrawScreenBufferCommand> cmd(new DrawScreenBufferCommand(size.Width, size.Height, startFrame));
-
-	luaL_checktype(lua, 1, LUA_TTABLE);
-	for(int i = 0, len = size.Height * size.Width; i < len; i++) {
-		lua_rawgeti(lua, 1, i+1);
-		uint32_t color = (uint32_t)lua_tointeger(lua, -1);
-		lua_pop(lua, 1);
-		cmd->SetPixel(i, color ^ 0xFF000000);
+	vector<uint32_t> buffer(size.Width * size.Height);
+
+	if(lua_type(lua, 1) == LUA_TSTRING) {
+		//Binary string in the same format as the one returned by getScreenBuffer(true)
+		size_t length = 0;
+		const uint8_t* data = (const uint8_t*)lua_tolstring(lua, 1, &length);
+		errorCond(length < size.Height * size.Width * sizeof(uint32_t), "screen buffer is too small");
+		for(int i = 0, len = size.Height * size.Width; i < len; i++) {
+			uint32_t color;
+			memcpy(&color, data + i * sizeof(uint32_t), sizeof(uint32_t));
+			buffer[i] = color ^ 0xFF000000;
+		}
+	} else {
+		luaL_checktype(lua, 1, LUA_TTABLE);
+		for(int i = 0, len = size.Height * size.Width; i < len; i++) {
+			lua_rawgeti(lua, 1, i+1);
+			uint32_t color = (uint32_t)lua_tointeger(lua, -1);
+			lua_pop(lua, 1);
+			buffer[i] = color ^ 0xFF000000;
+		}
 	}
 	
-	_emu->GetDebugHud()->AddCommand(std::move(cmd));
+	_emu->GetDebugHud()->DrawScreenBuffer(buffer.data(), size.Width, size.Height, startFrame);
 	return l.ReturnCount();
 }
 
@@ -1040,6 +1143,184 @@ int LuaApi::GetState(lua_State *lua)
 	return 1;
 }
 
+void LuaApi::GetStatePointers(unordered_map<string, SerializeMapPointer>& pointers)
+{
+	//Only values stored inside the console's components get a pointer - values missing from the
+	//pointer list (e.g temporaries streamed from local variables) are read by serializing the state again
+	Serializer s(0, true, SerializeFormat::Map);
+	s.SetMapPointers(&pointers);
+	s.Stream(*_emu->GetConsole().get(), "", -1);
+
+	for(auto& kvp : s.GetMapValues()) {
+		pointers.try_emplace(kvp.first, SerializeMapPointer());
+	}
+}
+
+void LuaApi::PushStateHandle(lua_State* lua, shared_ptr<IConsole>& console, unordered_map<string, SerializeMapPointer>& pointers, string path)
+{
+	LuaStateHandleType type = LuaStateHandleType::Field;
+	SerializeMapPointer field = {};
+
+	auto result = pointers.find(path);
+	if(result != pointers.end()) {
+		field = result->second;
+		if(!field.Ptr) {
+			type = LuaStateHandleType::Dynamic;
+		}
+	} else if(path == "frameCount") {
+		type = LuaStateHandleType::FrameCount;
+	} else if(path == "masterClock") {
+		type = LuaStateHandleType::MasterClock;
+	} else if(path == "clockRate") {
+		type = LuaStateHandleType::ClockRate;
+	} else if(path == "consoleType") {
+		type = LuaStateHandleType::ConsoleType;
+	} else if(path == "region") {
+		type = LuaStateHandleType::Region;
+	} else {
+		lua_pushnil(lua);
+		return;
+	}
+
+	LuaStateHandle* handle = (LuaStateHandle*)lua_newuserdatauv(lua, sizeof(LuaStateHandle) + path.size() + 1, 0);
+	new (handle) LuaStateHandle();
+	handle->Console = console;
+	handle->Field = field;
+	handle->Type = type;
+	memcpy((char*)handle + sizeof(LuaStateHandle), path.c_str(), path.size() + 1);
+
+	luaL_setmetatable(lua, StateHandleMetatable);
+}
+
+void LuaApi::PushStateHandleValue(lua_State* lua, LuaStateHandle* handle, unique_ptr<Serializer>& fullState)
+{
+	if(handle->Console.lock().get() != _emu->GetConsoleUnsafe()) {
+		luaL_error(lua, "state handle is no longer valid (a different game was loaded)");
+		return;
+	}
+
+	switch(handle->Type) {
+		case LuaStateHandleType::Field:
+			switch(handle->Field.Format) {
+				case SerializeMapValueFormat::Integer: lua_pushinteger(lua, handle->Field.ReadInteger()); break;
+				case SerializeMapValueFormat::Double: lua_pushnumber(lua, handle->Field.ReadDouble()); break;
+				case SerializeMapValueFormat::Bool: lua_pushboolean(lua, *(bool*)handle->Field.Ptr); break;
+				case SerializeMapValueFormat::String: lua_pushstring(lua, ((string*)handle->Field.Ptr)->c_str()); break;
+			}
+			break;
+
+		case LuaStateHandleType::Dynamic: {
+			if(!fullState) {
+				//Only serialize the state once per call, even when several dynamic handles are read
+				fullState.reset(new Serializer(0, true, SerializeFormat::Map));
+				fullState->Stream(*_emu->GetConsole().get(), "", -1);
+			}
+
+			unordered_map<string, SerializeMapValue>& values = fullState->GetMapValues();
+			auto result = values.find(handle->GetPath());
+			if(result == values.end()) {
+				lua_pushnil(lua);
+				break;
+			}
+
+			switch(result->second.Format) {
+				case SerializeMapValueFormat::Integer: lua_pushinteger(lua, result->second.Value.Integer); break;
+				case SerializeMapValueFormat::Double: lua_pushnumber(lua, result->second.Value.Double); break;
+				case SerializeMapValueFormat::Bool: lua_pushboolean(lua, result->second.Value.Bool); break;
+				case SerializeMapValueFormat::String: lua_pushstring(lua, result->second.StringValue.c_str()); break;
+			}
+			break;
+		}
+
+		case LuaStateHandleType::FrameCount: lua_pushinteger(lua, _emu->GetFrameCount()); break;
+		case LuaStateHandleType::MasterClock: lua_pushinteger(lua, (uint32_t)_emu->GetMasterClock()); break;
+		case LuaStateHandleType::ClockRate: lua_pushinteger(lua, _emu->GetMasterClockRate()); break;
+		case LuaStateHandleType::ConsoleType: lua_pushstring(lua, string(magic_enum::enum_name<ConsoleType>(_emu->GetConsoleType())).c_str()); break;
+		case LuaStateHandleType::Region: lua_pushstring(lua, string(magic_enum::enum_name<ConsoleRegion>(_emu->GetRegion())).c_str()); break;
+	}
+}
+
+int LuaApi::FreeStateHandle(lua_State* lua)
+{
+	LuaStateHandle* handle = (LuaStateHandle*)luaL_checkudata(lua, 1, StateHandleMetatable);
+	handle->~LuaStateHandle();
+	return 0;
+}
+
+int LuaApi::GetStateHandle(lua_State* lua)
+{
+	LuaCallHelper l(lua);
+	string path = l.ReadString();
+	checkparams();
+
+	shared_ptr<IConsole> console = _emu->GetConsole();
+	errorCond(!console, "no game is currently running");
+
+	unordered_map<string, SerializeMapPointer> pointers;
+	GetStatePointers(pointers);
+	PushStateHandle(lua, console, pointers, path);
+	return 1;
+}
+
+int LuaApi::GetStateHandles(lua_State* lua)
+{
+	lua_settop(lua, 1);
+	luaL_checktype(lua, 1, LUA_TTABLE);
+
+	shared_ptr<IConsole> console = _emu->GetConsole();
+	errorCond(!console, "no game is currently running");
+
+	//All paths are resolved with a single serialization pass
+	unordered_map<string, SerializeMapPointer> pointers;
+	GetStatePointers(pointers);
+
+	lua_newtable(lua);
+	lua_pushnil(lua);
+	while(lua_next(lua, 1) != 0) {
+		errorCond(lua_type(lua, -1) != LUA_TSTRING, "paths must be strings");
+		size_t len = 0;
+		const char* cstr = lua_tolstring(lua, -1, &len);
+		string path = string(cstr, len);
+		lua_pop(lua, 1);
+
+		//result[key] = handle
+		lua_pushvalue(lua, -1);
+		PushStateHandle(lua, console, pointers, path);
+		lua_settable(lua, 2);
+	}
+	return 1;
+}
+
+int LuaApi::ReadStateHandle(lua_State* lua)
+{
+	lua_settop(lua, 1);
+	LuaStateHandle* handle = (LuaStateHandle*)luaL_checkudata(lua, 1, StateHandleMetatable);
+
+	unique_ptr<Serializer> fullState;
+	PushStateHandleValue(lua, handle, fullState);
+	return 1;
+}
+
+int LuaApi::ReadStateHandles(lua_State* lua)
+{
+	lua_settop(lua, 1);
+	luaL_checktype(lua, 1, LUA_TTABLE);
+
+	unique_ptr<Serializer> fullState;
+	lua_newtable(lua);
+	lua_pushnil(lua);
+	while(lua_next(lua, 1) != 0) {
+		LuaStateHandle* handle = (LuaStateHandle*)luaL_checkudata(lua, -1, StateHandleMetatable);
+		lua_pop(lua, 1);
+
+		//result[key] = value
+		lua_pushvalue(lua, -1);
+		PushStateHandleValue(lua, handle, fullState);
+		lua_settable(lua, 2);
+	}
+	return 1;
+}
+
 int LuaApi::SetState(lua_State* lua)
 {
 	LuaCallHelper l(lua);
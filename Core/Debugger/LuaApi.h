@@ -11,6 +11,10 @@ class Emulator;
 class MemoryDumper;
 class DebugHud;
 class BaseVideoFilter;
+class Serializer;
+class IConsole;
+struct SerializeMapPointer;
+struct LuaStateHandle;
 
 class LuaApi
 {
@@ -30,6 +34,8 @@ public:
 	static int WriteMemory(lua_State *lua);
 	static int ReadMemoryWord(lua_State *lua);
 	static int WriteMemoryWord(lua_State *lua);
+	static int ReadMemoryRange(lua_State *lua);
+	static int WriteMemoryRange(lua_State *lua);
 
 	static int GetLabelAddress(lua_State* lua);
 	static int ConvertAddress(lua_State *lua);
@@ -84,6 +90,10 @@ public:
 
 	static int SetState(lua_State *lua);
 	static int GetState(lua_State *lua);
+	static int GetStateHandle(lua_State *lua);
+	static int GetStateHandles(lua_State *lua);
+	static int ReadStateHandle(lua_State *lua);
+	static int ReadStateHandles(lua_State *lua);
 
 	static int GetAccessCounters(lua_State *lua);
 	static int ResetAccessCounters(lua_State *lua);
@@ -97,5 +107,10 @@ private:
 	static ScriptingContext* _context;
 	
 	static std::pair<unique_ptr<BaseVideoFilter>, FrameInfo> GetRenderedFrame();
+
+	static void GetStatePointers(unordered_map<string, SerializeMapPointer>& pointers);
+	static void PushStateHandle(lua_State* lua, shared_ptr<IConsole>& console, unordered_map<string, SerializeMapPointer>& pointers, string path);
+	static void PushStateHandleValue(lua_State* lua, LuaStateHandle* handle, unique_ptr<Serializer>& fullState);
+	static int FreeStateHandle(lua_State* lua);
 	template<typename T> static void GenerateEnumDefinition(lua_State* lua, string enumName, unordered_set<T> excludedValues = {});
 };
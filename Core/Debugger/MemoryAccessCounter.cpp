@@ -15,29 +15,61 @@ MemoryAccessCounter::MemoryAccessCounter(Debugger* debugger)
 
 	for(int i = (int)DebugUtilities::GetLastCpuMemoryType() + 1; i < DebugUtilities::GetMemoryTypeCount(); i++) {
 		uint32_t memSize = _debugger->GetMemoryDumper()->GetMemorySize((MemoryType)i);
-		_counters[i].reserve(memSize);
-		for(uint32_t j = 0; j < memSize; j++) {
-			_counters[i].push_back({});
+		_pages[i].resize((memSize + PageSize - 1) / PageSize);
+	}
+
+	RebaseStamps(_debugger->GetConsole()->GetMasterClock());
+}
+
+void MemoryAccessCounter::RebaseStamps(uint64_t masterClock)
+{
+	//Keep the most recent half of the stamp range, older stamps are clamped to the oldest value
+	int64_t newBase = (int64_t)masterClock - 0x80000000LL;
+	int64_t delta = _stampBase - newBase;
+	_stampBase = newBase;
+
+	auto rebase = [delta](uint32_t& stamp) {
+		if(stamp) {
+			stamp = (uint32_t)std::clamp<int64_t>((int64_t)stamp + delta, 1, UINT32_MAX);
+		}
+	};
+
+	for(int i = 0; i < DebugUtilities::GetMemoryTypeCount(); i++) {
+		for(unique_ptr<CounterPage>& page : _pages[i]) {
+			if(page) {
+				for(uint32_t j = 0; j < PageSize; j++) {
+					rebase(page->ReadStamp[j]);
+					rebase(page->WriteStamp[j]);
+					rebase(page->ExecStamp[j]);
+				}
+			}
 		}
 	}
 }
 
+uint64_t MemoryAccessCounter::ToMasterClock(uint32_t stamp)
+{
+	return stamp ? (uint64_t)std::max<int64_t>(_stampBase + stamp, 1) : 0;
+}
+
 ReadResult MemoryAccessCounter::ProcessMemoryRead(AddressInfo &addressInfo, uint64_t masterClock)
 {
 	if(addressInfo.Address < 0) {
 		return ReadResult::Normal;
 	}
 
-	AddressCounters& counts = _counters[(int)addressInfo.Type][addressInfo.Address];
-	if(_enableBreakOnUninitRead && counts.WriteStamp == 0 && DebugUtilities::IsVolatileRam(addressInfo.Type)) {
-		ReadResult result = counts.ReadStamp == 0 ? ReadResult::FirstUninitRead : ReadResult::UninitRead;
-		counts.ReadStamp = masterClock;
-		counts.ReadCounter++;
+	CounterPage* page = GetPage(addressInfo);
+	uint32_t offset = addressInfo.Address & PageMask;
+	uint32_t stamp = GetStamp(masterClock);
+	if(_enableBreakOnUninitRead && page->WriteStamp[offset] == 0 && DebugUtilities::IsVolatileRam(addressInfo.Type)) {
+		ReadResult result = page->ReadStamp[offset] == 0 ? ReadResult::FirstUninitRead : ReadResult::UninitRead;
+		page->ReadStamp[offset] = stamp;
+		page->ReadCounter[offset]++;
 		return result;
 	}
 
-	counts.ReadStamp = masterClock;
-	counts.ReadCounter++;
+	page->ReadStamp[offset] = stamp;
+	page->ReadCounter[offset]++;
 	return ReadResult::Normal;
 }
 
@@ -47,9 +79,10 @@ void MemoryAccessCounter::ProcessMemoryWrite(AddressInfo& addressInfo, uint64_t
 		return;
 	}
 
-	AddressCounters& counts = _counters[(int)addressInfo.Type][addressInfo.Address];
-	counts.WriteStamp = masterClock;
-	counts.WriteCounter++;
+	CounterPage* page = GetPage(addressInfo);
+	uint32_t offset = addressInfo.Address & PageMask;
+	page->WriteStamp[offset] = GetStamp(masterClock);
+	page->WriteCounter[offset]++;
 }
 
 void MemoryAccessCounter::ProcessMemoryExec(AddressInfo& addressInfo, uint64_t masterClock)
@@ -58,18 +91,32 @@ void MemoryAccessCounter::ProcessMemoryExec(AddressInfo& addressInfo, uint64_t m
 		return;
 	}
 
-	AddressCounters& counts = _counters[(int)addressInfo.Type][addressInfo.Address];
-	counts.ExecStamp = masterClock;
-	counts.ExecCounter++;
+	CounterPage* page = GetPage(addressInfo);
+	uint32_t offset = addressInfo.Address & PageMask;
+	page->ExecStamp[offset] = GetStamp(masterClock);
+	page->ExecCounter[offset]++;
 }
 
 void MemoryAccessCounter::ResetCounts()
 {
 	DebugBreakHelper helper(_debugger);
 	for(int i = 0; i < DebugUtilities::GetMemoryTypeCount(); i++) {
-		memset(_counters[i].data(), 0, _counters[i].size() * sizeof(AddressCounters));
+		for(unique_ptr<CounterPage>& page : _pages[i]) {
+			page.reset();
+		}
 	}
 	_enableBreakOnUninitRead = _debugger->GetConsole()->GetMasterClock() < 1000;
+	RebaseStamps(_debugger->GetConsole()->GetMasterClock());
+}
+
+void MemoryAccessCounter::GetCounters(CounterPage* page, uint32_t offset, AddressCounters& counts)
+{
+	counts.ReadStamp = ToMasterClock(page->ReadStamp[offset]);
+	counts.WriteStamp = ToMasterClock(page->WriteStamp[offset]);
+	counts.ExecStamp = ToMasterClock(page->ExecStamp[offset]);
+	counts.ReadCounter = page->ReadCounter[offset];
+	counts.WriteCounter = page->WriteCounter[offset];
+	counts.ExecCounter = page->ExecCounter[offset];
 }
 
 void MemoryAccessCounter::GetAccessCounts(uint32_t offset, uint32_t length, MemoryType memoryType, AddressCounters counts[])
@@ -81,12 +128,35 @@ void MemoryAccessCounter::GetAccessCounts(uint32_t offset, uint32_t length, Memo
 			addr.Address = offset + i;
 			AddressInfo info = _debugger->GetAbsoluteAddress(addr);
 			if(info.Address >= 0) {
-				counts[i] = _counters[(int)info.Type][info.Address];
+				CounterPage* page = _pages[(int)info.Type][info.Address >> PageShift].get();
+				if(page) {
+					GetCounters(page, info.Address & PageMask, counts[i]);
+				} else {
+					counts[i] = {};
+				}
 			}
 		}
 	} else {
-		if(offset + length <= _counters[(int)memoryType].size()) {
-			memcpy(counts, _counters[(int)memoryType].data() + offset, length * sizeof(AddressCounters));
+		vector<unique_ptr<CounterPage>>& pages = _pages[(int)memoryType];
+		if((uint64_t)offset + length > (uint64_t)pages.size() * PageSize) {
+			return;
+		}
+
+		//Process the range one page at a time - pages that were never accessed are all zeroes
+		uint32_t i = 0;
+		while(i < length) {
+			uint32_t addr = offset + i;
+			uint32_t pageOffset = addr & PageMask;
+			uint32_t runLength = std::min(length - i, PageSize - pageOffset);
+			CounterPage* page = pages[addr >> PageShift].get();
+			if(page) {
+				for(uint32_t j = 0; j < runLength; j++) {
+					GetCounters(page, pageOffset + j, counts[i + j]);
+				}
+			} else {
+				memset(counts + i, 0, runLength * sizeof(AddressCounters));
+			}
+			i += runLength;
 		}
 	}
 }
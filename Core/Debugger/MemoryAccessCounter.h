@@ -33,11 +33,52 @@ enum class ReadResult
 class MemoryAccessCounter
 {
 private:
-	vector<AddressCounters> _counters[DebugUtilities::GetMemoryTypeCount()];
+	static constexpr uint32_t PageShift = 12;
+	static constexpr uint32_t PageSize = 1 << PageShift;
+	static constexpr uint32_t PageMask = PageSize - 1;
+
+	//Counters for a 4 KB block of memory, stored as separate arrays (most accesses only touch one stamp and one counter)
+	//Stamps are relative to _stampBase (0 = never accessed)
+	struct CounterPage
+	{
+		uint32_t ReadStamp[PageSize];
+		uint32_t WriteStamp[PageSize];
+		uint32_t ExecStamp[PageSize];
+		uint32_t ReadCounter[PageSize];
+		uint32_t WriteCounter[PageSize];
+		uint32_t ExecCounter[PageSize];
+	};
+
+	//Pages are only allocated once an address in them is accessed
+	vector<unique_ptr<CounterPage>> _pages[DebugUtilities::GetMemoryTypeCount()];
+	int64_t _stampBase = 0;
 
 	Debugger* _debugger = nullptr;
 	bool _enableBreakOnUninitRead = false;
 
+	__forceinline CounterPage* GetPage(AddressInfo& addressInfo)
+	{
+		unique_ptr<CounterPage>& page = _pages[(int)addressInfo.Type][addressInfo.Address >> PageShift];
+		if(!page) {
+			page.reset(new CounterPage());
+		}
+		return page.get();
+	}
+
+	__forceinline uint32_t GetStamp(uint64_t masterClock)
+	{
+		uint64_t stamp = (uint64_t)((int64_t)masterClock - _stampBase);
+		if(stamp == 0 || stamp > UINT32_MAX) {
+			RebaseStamps(masterClock);
+			stamp = (uint64_t)((int64_t)masterClock - _stampBase);
+		}
+		return (uint32_t)stamp;
+	}
+
+	void RebaseStamps(uint64_t masterClock);
+	uint64_t ToMasterClock(uint32_t stamp);
+	void GetCounters(CounterPage* page, uint32_t offset, AddressCounters& counts);
+
 public:
 	MemoryAccessCounter(Debugger *debugger);
 
@@ -275,6 +275,28 @@ void MemoryDumper::GetMemoryValues(MemoryType memoryType, uint32_t start, uint32
 	}
 }
 
+void MemoryDumper::GetMemoryRange(MemoryType memoryType, uint32_t start, uint32_t length, uint8_t* output, bool disableSideEffects)
+{
+	uint32_t size = GetMemorySize(memoryType);
+	if(start >= size) {
+		return;
+	}
+	length = std::min(length, size - start);
+
+	if(!DebugUtilities::IsRelativeMemory(memoryType)) {
+		//Copy directly from the memory buffer when possible
+		uint8_t* src = GetMemoryBuffer(memoryType);
+		if(src) {
+			memcpy(output, src + start, length);
+			return;
+		}
+	}
+
+	for(uint32_t i = 0; i < length; i++) {
+		output[i] = InternalGetMemoryValue(memoryType, start + i, disableSideEffects);
+	}
+}
+
 uint8_t MemoryDumper::GetMemoryValue(MemoryType memoryType, uint32_t address, bool disableSideEffects)
 {
 	if(address >= GetMemorySize(memoryType)) {
@@ -40,6 +40,7 @@ public:
 
 	uint8_t GetMemoryValue(MemoryType memoryType, uint32_t address, bool disableSideEffects = true);
 	void GetMemoryValues(MemoryType memoryType, uint32_t start, uint32_t end, uint8_t* output);
+	void GetMemoryRange(MemoryType memoryType, uint32_t start, uint32_t length, uint8_t* output, bool disableSideEffects = true);
 	uint16_t GetMemoryValueWord(MemoryType memoryType, uint32_t address, bool disableSideEffects = true);
 	void SetMemoryValueWord(MemoryType memoryType, uint32_t address, uint16_t value, bool disableSideEffects = true);
 	void SetMemoryValue(MemoryType memoryType, uint32_t address, uint8_t value, bool disableSideEffects = true);
@@ -9,6 +9,7 @@
 #include "Debugger/DebugTypes.h"
 #include "Debugger/Debugger.h"
 #include "Debugger/ScriptManager.h"
+#include "Debugger/MemoryDumper.h"
 #include "Shared/Emulator.h"
 #include "Shared/EmuSettings.h"
 #include "Shared/SaveStateManager.h"
@@ -215,6 +216,33 @@ void ScriptingContext::RegisterMemoryCallback(CallbackType type, int startAddr,
 	}
 
 	_callbacks[(int)type].push_back(callback);
+	RebuildCallbackIndex(type);
+}
+
+void ScriptingContext::RebuildCallbackIndex(CallbackType type)
+{
+	for(int i = 0; i < ScriptingContext::CpuTypeCount; i++) {
+		_callbackIndex[(int)type][i].reset();
+	}
+	_callbackIndexVersion++;
+
+	vector<MemoryCallback>& callbacks = _callbacks[(int)type];
+	for(uint32_t i = 0; i < (uint32_t)callbacks.size(); i++) {
+		MemoryCallback& callback = callbacks[i];
+		unique_ptr<MemoryCallbackIndex>& index = _callbackIndex[(int)type][(int)callback.Cpu];
+		if(!index) {
+			index.reset(new MemoryCallbackIndex());
+		}
+
+		if(DebugUtilities::IsRelativeMemory(callback.MemType)) {
+			index->HasRelativeCallbacks = true;
+		} else {
+			index->HasAbsoluteCallbacks = true;
+		}
+
+		uint32_t memSize = _debugger->GetMemoryDumper()->GetMemorySize(callback.MemType);
+		index->Pages.Add(callback.MemType, (int32_t)callback.StartAddress, (int32_t)callback.EndAddress, memSize, i);
+	}
 }
 
 void ScriptingContext::RefreshMemoryCallbackFlags()
@@ -248,6 +276,7 @@ void ScriptingContext::UnregisterMemoryCallback(CallbackType type, int startAddr
 
 		if(isMatch) {
 			_callbacks[(int)type].erase(_callbacks[(int)type].begin() + i);
+			RebuildCallbackIndex(type);
 			break;
 		}
 	}
@@ -272,39 +301,88 @@ bool ScriptingContext::IsAddressMatch(MemoryCallback& callback, AddressInfo addr
 	return addr.Type == callback.MemType && addr.Address >= (int32_t)callback.StartAddress && addr.Address <= (int32_t)callback.EndAddress;
 }
 
+bool ScriptingContext::HasMemoryCallback(CallbackType type, int reference)
+{
+	for(MemoryCallback& callback : _callbacks[(int)type]) {
+		if(callback.Reference == reference) {
+			return true;
+		}
+	}
+	return false;
+}
+
 template<typename T>
 void ScriptingContext::InternalCallMemoryCallback(AddressInfo relAddr, T& value, CallbackType type, CpuType cpuType)
 {
-	if(_callbacks[(int)type].empty()) {
+	MemoryCallbackIndex* index = _callbackIndex[(int)type][(int)cpuType].get();
+	if(!index) {
 		return;
 	}
 
-	_context = this;
-	bool needTimerReset = true;
-	lua_setwatchdogtimer(_lua, ScriptingContext::ExecutionCountHook, 1000);
-	LuaApi::SetContext(this);
-	for(MemoryCallback& callback : _callbacks[(int)type]) {
-		if(callback.Cpu != cpuType) {
-			continue;
-		} 
+	//Callbacks on relative memory match the relative address, others match the absolute address
+	vector<uint32_t>* relCandidates = index->HasRelativeCallbacks ? index->Pages.GetCandidates(relAddr.Type, relAddr.Address) : nullptr;
+	vector<uint32_t>* absCandidates = nullptr;
+	AddressInfo absAddr = {};
+	if(index->HasAbsoluteCallbacks) {
+		absAddr = _debugger->GetAbsoluteAddress(relAddr);
+		absCandidates = index->Pages.GetCandidates(absAddr.Type, absAddr.Address);
+	}
 
-		if(DebugUtilities::IsRelativeMemory(callback.MemType)) {
-			if(!IsAddressMatch(callback, relAddr)) {
-				continue;
-			}
+	if(!relCandidates && !absCandidates) {
+		return;
+	}
+
+	//Find the matching callbacks before calling any of them - a callback can add/remove callbacks, which
+	//rebuilds the index. Callbacks added by a callback are called starting with the next memory access.
+	constexpr uint32_t LocalRefCount = 16;
+	int localRefs[LocalRefCount];
+	vector<int> extraRefs;
+	uint32_t matchCount = 0;
+
+	//Check the candidates in the same order as the callback list (both lists are sorted)
+	size_t relCount = relCandidates ? relCandidates->size() : 0;
+	size_t absCount = absCandidates ? absCandidates->size() : 0;
+	size_t relPos = 0;
+	size_t absPos = 0;
+	while(relPos < relCount || absPos < absCount) {
+		uint32_t i;
+		bool isRelative = absPos >= absCount || (relPos < relCount && (*relCandidates)[relPos] < (*absCandidates)[absPos]);
+		if(isRelative) {
+			i = (*relCandidates)[relPos++];
 		} else {
-			if(!IsAddressMatch(callback, _debugger->GetAbsoluteAddress(relAddr))) {
-				continue;
+			i = (*absCandidates)[absPos++];
+		}
+
+		MemoryCallback& callback = _callbacks[(int)type][i];
+		if(IsAddressMatch(callback, isRelative ? relAddr : absAddr)) {
+			if(matchCount < LocalRefCount) {
+				localRefs[matchCount] = callback.Reference;
+			} else {
+				extraRefs.push_back(callback.Reference);
 			}
+			matchCount++;
 		}
+	}
+
+	if(matchCount == 0) {
+		return;
+	}
 
-		if(needTimerReset) {
-			_timer.Reset();
-			needTimerReset = false;
+	_context = this;
+	_timer.Reset();
+	lua_setwatchdogtimer(_lua, ScriptingContext::ExecutionCountHook, 1000);
+	LuaApi::SetContext(this);
+
+	uint32_t indexVersion = _callbackIndexVersion;
+	for(uint32_t j = 0; j < matchCount; j++) {
+		int reference = j < LocalRefCount ? localRefs[j] : extraRefs[j - LocalRefCount];
+		if(indexVersion != _callbackIndexVersion && !HasMemoryCallback(type, reference)) {
+			//Removed by one of the previous callbacks
+			continue;
 		}
 
 		int top = lua_gettop(_lua);
-		lua_rawgeti(_lua, LUA_REGISTRYINDEX, callback.Reference);
+		lua_rawgeti(_lua, LUA_REGISTRYINDEX, reference);
 		lua_pushinteger(_lua, relAddr.Address);
 		lua_pushinteger(_lua, value);
 		if(lua_pcall(_lua, 2, LUA_MULTRET, 0) != 0) {
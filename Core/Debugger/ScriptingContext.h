@@ -4,6 +4,8 @@
 #include "Utilities/SimpleLock.h"
 #include "Utilities/Timer.h"
 #include "Debugger/DebugTypes.h"
+#include "Debugger/DebugUtilities.h"
+#include "Debugger/AddressRangeIndex.h"
 #include "Shared/EventType.h"
 
 class Debugger;
@@ -25,6 +27,14 @@ struct MemoryCallback
 	int Reference;
 };
 
+struct MemoryCallbackIndex
+{
+	//Indexes (in _callbacks) of the callbacks that overlap each 4 KB page
+	AddressRangeIndex Pages;
+	bool HasRelativeCallbacks = false;
+	bool HasAbsoluteCallbacks = false;
+};
+
 enum class ScriptDrawSurface
 {
 	ConsoleScreen,
@@ -34,6 +44,8 @@ enum class ScriptDrawSurface
 class ScriptingContext
 {
 private:
+	static constexpr int CpuTypeCount = (int)DebugUtilities::GetLastCpuType() + 1;
+
 	static ScriptingContext* _context;
 	lua_State* _lua = nullptr;
 	Timer _timer;
@@ -59,9 +71,16 @@ protected:
 	vector<MemoryCallback> _callbacks[3];
 	vector<int> _eventCallbacks[(int)EventType::LastValue + 1];
 
+	//Lookup tables used to skip memory accesses that can't match any callback, for each callback type and cpu
+	unique_ptr<MemoryCallbackIndex> _callbackIndex[3][CpuTypeCount];
+	uint32_t _callbackIndexVersion = 0;
+
+	void RebuildCallbackIndex(CallbackType type);
+
 	template<typename T> void InternalCallMemoryCallback(AddressInfo relAddr, T& value, CallbackType type, CpuType cpuType);
 
 	bool IsAddressMatch(MemoryCallback& callback, AddressInfo addr);
+	bool HasMemoryCallback(CallbackType type, int reference);
 
 public:
 	ScriptingContext(Debugger* debugger);
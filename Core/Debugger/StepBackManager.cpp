@@ -49,7 +49,7 @@ bool StepBackManager::CheckStepBack()
 				_cache.pop_back();
 				if(_cache.size()) {
 					//If cache isn't empty, load the last state
-					_emu->Deserialize(_cache.back().SaveState, SaveStateManager::FileFormatVersion, true, std::nullopt, false);
+					_emu->Deserialize(_cache.back().SaveState, true, false);
 
 					_emu->GetRewindManager()->StopRewinding(true, true);
 					_active = false;
@@ -72,13 +72,13 @@ bool StepBackManager::CheckStepBack()
 		//Create a save state every instruction for the last X clocks
 		_cache.push_back(StepBackCacheEntry());
 		_cache.back().Clock = clock;
-		_emu->Serialize(_cache.back().SaveState, true, 0);
+		_emu->Serialize(_cache.back().SaveState, true);
 	}
 
 	if(clock >= _targetClock) {
 		//If the CPU is back to where it was before step back, check if the cache contains data
 		if(_cache.size() > 0) {
-			_emu->Deserialize(_cache.back().SaveState, SaveStateManager::FileFormatVersion, true, std::nullopt, false);
+			_emu->Deserialize(_cache.back().SaveState, true, false);
 			_rewindManager->StopRewinding(true, true);
 		} else if(_allowRetry && clock > _prevClock && (clock - _prevClock) > StepBackManager::DefaultClockLimit) {
 			//Cache is empty, this can happen when a single instruction takes more than X clocks (e.g block transfers, dma)
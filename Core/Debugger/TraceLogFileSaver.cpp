@@ -0,0 +1,227 @@
+#include "pch.h"
+#include "Debugger/TraceLogFileSaver.h"
+#include "Debugger/Debugger.h"
+#include "Debugger/ITraceLogger.h"
+#include "Debugger/DebugBreakHelper.h"
+#include "Debugger/DebugUtilities.h"
+
+TraceLogFileSaver::TraceLogFileSaver(Debugger* debugger)
+{
+	_debugger = debugger;
+	_enabled = false;
+	_logging = false;
+	_stopFlag = false;
+	_writePos = 0;
+	_readPos = 0;
+	_formatting = false;
+	_cancelFormat = false;
+	_formatPosition = 0;
+	_formatSize = 0;
+}
+
+TraceLogFileSaver::~TraceLogFileSaver()
+{
+	//Finish converting the file (the trace loggers are still alive - the saver is destroyed first)
+	StopLogging();
+	WaitForFormatThread();
+}
+
+void TraceLogFileSaver::WaitForFormatThread()
+{
+	if(_formatThread) {
+		_formatThread->join();
+		_formatThread.reset();
+	}
+}
+
+void TraceLogFileSaver::CancelFormat()
+{
+	_cancelFormat = true;
+	WaitForFormatThread();
+}
+
+double TraceLogFileSaver::GetFormatProgress()
+{
+	uint64_t size = _formatSize;
+	return size > 0 ? std::min(1.0, (double)_formatPosition / size) : 0.0;
+}
+
+void TraceLogFileSaver::StartLogging(string filename)
+{
+	StopLogging();
+
+	//The UI doesn't allow logging again before the previous file is done, but make sure it is
+	WaitForFormatThread();
+
+	_outputFilepath = filename;
+	_binaryFilepath = filename + ".bin";
+	_outputFile.open(_binaryFilepath, ios::out | ios::binary);
+	if(!_outputFile) {
+		return;
+	}
+
+	uint32_t headerSize = sizeof(TraceLogRecordHeader);
+	_outputFile.write(FileSignature, 4);
+	_outputFile.write((char*)&headerSize, sizeof(headerSize));
+
+	if(!_buffer) {
+		_buffer.reset(new uint8_t[BufferSize]);
+	}
+	_writePos = 0;
+	_readPos = 0;
+	_stopFlag = false;
+	_dataAvailable.Reset();
+	_writerThread.reset(new std::thread(&TraceLogFileSaver::WriterThread, this));
+
+	{
+		//Keep a copy of each logger's current format, used to capture and format the rows logged to the file
+		DebugBreakHelper helper(_debugger);
+		for(int i = 0; i <= (int)DebugUtilities::GetLastCpuType(); i++) {
+			ITraceLogger* logger = _debugger->GetTraceLogger((CpuType)i);
+			if(logger) {
+				logger->StartFileLogging();
+			}
+		}
+		_enabled = true;
+	}
+}
+
+void TraceLogFileSaver::StopLogging()
+{
+	if(!_enabled) {
+		return;
+	}
+
+	_enabled = false;
+	while(_logging) {
+		//Wait for the emulation thread to finish adding the current row
+	}
+
+	_stopFlag = true;
+	_dataAvailable.Signal();
+	_writerThread->join();
+	_writerThread.reset();
+	_outputFile.close();
+
+	//Convert the file to text on a separate thread, to avoid blocking the caller (UI) for large logs
+	_cancelFormat = false;
+	_formatPosition = 0;
+	_formatSize = 0;
+	_formatting = true;
+	_formatThread.reset(new std::thread([this, binaryFile = _binaryFilepath, textFile = _outputFilepath]() {
+		//If the conversion is cancelled (or fails), the binary file is kept along with the partial text file
+		if(FormatLog(binaryFile, textFile)) {
+			std::remove(binaryFile.c_str());
+		}
+		_formatting = false;
+	}));
+}
+
+void TraceLogFileSaver::WriteToBuffer(uint64_t pos, uint8_t* data, uint32_t size)
+{
+	uint32_t start = (uint32_t)(pos & BufferMask);
+	uint32_t firstPart = std::min(size, BufferSize - start);
+	memcpy(_buffer.get() + start, data, firstPart);
+	if(firstPart < size) {
+		memcpy(_buffer.get(), data + firstPart, size - firstPart);
+	}
+}
+
+void TraceLogFileSaver::Log(TraceLogRecordHeader& header, uint8_t* cpuState, uint32_t cpuStateSize)
+{
+	_logging = true;
+	if(_enabled) {
+		uint32_t size = sizeof(TraceLogRecordHeader) + cpuStateSize;
+		uint64_t writePos = _writePos.load(std::memory_order_relaxed);
+		while(writePos + size - _readPos.load(std::memory_order_acquire) > BufferSize) {
+			//Buffer is full, wait for the writer thread to catch up
+			_dataAvailable.Signal();
+			std::this_thread::yield();
+		}
+
+		WriteToBuffer(writePos, (uint8_t*)&header, sizeof(TraceLogRecordHeader));
+		WriteToBuffer(writePos + sizeof(TraceLogRecordHeader), cpuState, cpuStateSize);
+		_writePos.store(writePos + size, std::memory_order_release);
+	}
+	_logging = false;
+}
+
+void TraceLogFileSaver::WriterThread()
+{
+	while(true) {
+		bool stop = _stopFlag;
+		uint64_t readPos = _readPos.load(std::memory_order_relaxed);
+		uint64_t writePos = _writePos.load(std::memory_order_acquire);
+
+		if(readPos != writePos) {
+			uint32_t start = (uint32_t)(readPos & BufferMask);
+			uint32_t length = (uint32_t)(writePos - readPos);
+			uint32_t firstPart = std::min(length, BufferSize - start);
+			_outputFile.write((char*)_buffer.get() + start, firstPart);
+			if(firstPart < length) {
+				_outputFile.write((char*)_buffer.get(), length - firstPart);
+			}
+			_readPos.store(writePos, std::memory_order_release);
+		} else if(stop) {
+			break;
+		} else {
+			_dataAvailable.Wait(10);
+		}
+	}
+}
+
+bool TraceLogFileSaver::FormatLog(string binaryFile, string textFile)
+{
+	ifstream input(binaryFile, ios::in | ios::binary);
+	if(!input) {
+		return false;
+	}
+
+	input.seekg(0, ios::end);
+	_formatSize = (uint64_t)input.tellg();
+	input.seekg(0, ios::beg);
+
+	char signature[4] = {};
+	uint32_t headerSize = 0;
+	input.read(signature, 4);
+	input.read((char*)&headerSize, sizeof(headerSize));
+	if(memcmp(signature, FileSignature, 4) != 0 || headerSize != sizeof(TraceLogRecordHeader)) {
+		return false;
+	}
+
+	ofstream output(textFile, ios::out | ios::binary);
+	if(!output) {
+		return false;
+	}
+
+	string outputBuffer;
+	outputBuffer.reserve(40000);
+	vector<uint8_t> cpuState;
+	TraceLogRecordHeader header;
+	while(input.read((char*)&header, sizeof(TraceLogRecordHeader))) {
+		ITraceLogger* logger = _debugger->GetTraceLogger(header.Type);
+		if(!logger) {
+			break;
+		}
+
+		cpuState.resize(logger->GetCpuStateSize());
+		if(!input.read((char*)cpuState.data(), cpuState.size())) {
+			break;
+		}
+
+		logger->FormatRecord(header, cpuState.data(), outputBuffer);
+		outputBuffer += '\n';
+		if(outputBuffer.size() > 32768) {
+			output << outputBuffer;
+			outputBuffer.clear();
+
+			_formatPosition = (uint64_t)input.tellg();
+			if(_cancelFormat) {
+				return false;
+			}
+		}
+	}
+
+	output << outputBuffer;
+	return true;
+}
@@ -1,48 +1,62 @@
 #pragma once
 #include "pch.h"
+#include <thread>
+#include "Debugger/ITraceLogger.h"
+#include "Utilities/AutoResetEvent.h"
 
+class Debugger;
+
+//Saves trace logs to a file: rows are pushed as binary records (see TraceLogRecordHeader) into a ring buffer,
+//and written to disk by a separate thread. Once logging stops, the binary file is converted to text by another
+//thread (this can take a while for large logs - see GetFormatProgress/CancelFormat).
 class TraceLogFileSaver
 {
 private:
-	bool _enabled = false;
+	static constexpr uint32_t BufferSize = 0x400000;
+	static constexpr uint32_t BufferMask = BufferSize - 1;
+	static constexpr char FileSignature[5] = "MTLB";
+
+	Debugger* _debugger = nullptr;
+
+	atomic<bool> _enabled;
+	atomic<bool> _logging;
 	string _outputFilepath;
-	string _outputBuffer;
+	string _binaryFilepath;
 	ofstream _outputFile;
 
+	unique_ptr<uint8_t[]> _buffer;
+	atomic<uint64_t> _writePos;
+	atomic<uint64_t> _readPos;
+
+	unique_ptr<std::thread> _writerThread;
+	AutoResetEvent _dataAvailable;
+	atomic<bool> _stopFlag;
+
+	unique_ptr<std::thread> _formatThread;
+	atomic<bool> _formatting;
+	atomic<bool> _cancelFormat;
+	atomic<uint64_t> _formatPosition;
+	atomic<uint64_t> _formatSize;
+
+	void WriterThread();
+	void WriteToBuffer(uint64_t pos, uint8_t* data, uint32_t size);
+	void WaitForFormatThread();
+	bool FormatLog(string binaryFile, string textFile);
+
 public:
-	~TraceLogFileSaver()
-	{
-		StopLogging();
-	}
-
-	void StartLogging(string filename)
-	{
-		_outputBuffer.clear();
-		_outputFile.open(filename, ios::out | ios::binary);
-		_enabled = true;
-	}
-
-	void StopLogging()
-	{
-		if(_enabled) {
-			_enabled = false;
-			if(_outputFile) {
-				if(!_outputBuffer.empty()) {
-					_outputFile << _outputBuffer;
-				}
-				_outputFile.close();
-			}
-		}
-	}
-
-	__forceinline bool IsEnabled() { return _enabled; }
-
-	void Log(string& log)
-	{
-		_outputBuffer += log + '\n';
-		if(_outputBuffer.size() > 32768) {
-			_outputFile << _outputBuffer;
-			_outputBuffer.clear();
-		}
-	}
-};
\ No newline at end of file
+	TraceLogFileSaver(Debugger* debugger);
+	~TraceLogFileSaver();
+
+	void StartLogging(string filename);
+	void StopLogging();
+
+	__forceinline bool IsEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+	void Log(TraceLogRecordHeader& header, uint8_t* cpuState, uint32_t cpuStateSize);
+
+	bool IsFormatting() { return _formatting; }
+	//Returns a value between 0 and 1 while the text file is being generated
+	double GetFormatProgress();
+	//Stops converting the binary file - the text file only contains the rows that were converted so far, the binary file is kept
+	void CancelFormat();
+};
@@ -39,12 +39,12 @@ RowDataType GbTraceLogger::GetFormatTagType(string& tag)
 	}
 }
 
-void GbTraceLogger::GetTraceRow(string &output, GbCpuState &cpuState, TraceLogPpuState &ppuState, DisassemblyInfo &disassemblyInfo)
+void GbTraceLogger::GetTraceRow(string &output, GbCpuState &cpuState, TraceLogPpuState &ppuState, DisassemblyInfo &disassemblyInfo, TraceLogRowFormat& format, TraceLogMemoryInfo* memInfo)
 {
 	constexpr char activeStatusLetters[4] = { 'Z', 'N', 'H', 'C' };
 	constexpr char inactiveStatusLetters[4] = { 'z', 'n', 'h', 'c' };
 
-	for(RowPart& rowPart : _rowParts) {
+	for(RowPart& rowPart : format.Parts) {
 		switch(rowPart.DataType) {
 			case RowDataType::A: WriteIntValue(output, cpuState.A, rowPart); break;
 			case RowDataType::B: WriteIntValue(output, cpuState.B, rowPart); break;
@@ -56,7 +56,7 @@ void GbTraceLogger::GetTraceRow(string &output, GbCpuState &cpuState, TraceLogPp
 			case RowDataType::L: WriteIntValue(output, cpuState.L, rowPart); break;
 			case RowDataType::SP: WriteIntValue(output, cpuState.SP, rowPart); break;
 			case RowDataType::PS: GetStatusFlag(activeStatusLetters, inactiveStatusLetters, output, cpuState.Flags >> 4, rowPart, 4); break;
-			default: ProcessSharedTag(rowPart, output, cpuState, ppuState, disassemblyInfo); break;
+			default: ProcessSharedTag(rowPart, output, cpuState, ppuState, disassemblyInfo, format, memInfo); break;
 		}
 	}
 }
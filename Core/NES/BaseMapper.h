@@ -105,6 +105,10 @@ protected:
 	
 	virtual bool HasBusConflicts() { return false; }
 
+	//Mappers that watch the PPU's bus (A12, nametable fetches, etc.) or expose PPU-dependent state through
+	//their registers need the PPU to run in lockstep with the CPU - others can let it run in catch-up mode
+	virtual bool NeedsPpuCallbacks() { return true; }
+
 	uint8_t InternalReadRam(uint16_t addr);
 
 	virtual void WriteRegister(uint16_t addr, uint8_t value);
@@ -170,6 +174,7 @@ public:
 
 	GameSystem GetGameSystem();
 	PpuModel GetPpuModel();
+	bool AllowPpuCatchUp() { return !NeedsPpuCallbacks(); }
 
 	virtual void SetRegion(ConsoleRegion region) { }
 	virtual void ProcessCpuClock() { }
@@ -130,6 +130,23 @@ public:
 	int32_t GetScanlineCount() { return _vblankEnd + 2; }
 	uint32_t GetFrameCycle() { return ((_scanline + 1) * 341) + _cycle; }
 
+	//Returns the master clock the PPU must be run to before anything outside of the PPU can observe its state (other
+	//than register accesses): the start of the next scanline (end of frame, input polling, APU status) or the NMI dot
+	uint64_t GetNextSyncClock()
+	{
+		uint32_t dots;
+		if(_scanline == _nmiScanline && _cycle == 0) {
+			dots = 1;
+		} else {
+			dots = 341 - _cycle;
+			if(_scanline == -1 && dots > 1) {
+				//The last dot of the pre-render scanline is skipped on odd frames
+				dots--;
+			}
+		}
+		return _masterClock + dots * _masterClockDivider;
+	}
+
 	virtual uint16_t* GetScreenBuffer(bool previousBuffer) = 0;
 	virtual void UpdateTimings(ConsoleRegion region, bool overclockAllowed = true) = 0;
 
@@ -30,19 +30,19 @@ RowDataType NesTraceLogger::GetFormatTagType(string& tag)
 	}
 }
 
-void NesTraceLogger::GetTraceRow(string &output, NesCpuState &cpuState, TraceLogPpuState &ppuState, DisassemblyInfo &disassemblyInfo)
+void NesTraceLogger::GetTraceRow(string &output, NesCpuState &cpuState, TraceLogPpuState &ppuState, DisassemblyInfo &disassemblyInfo, TraceLogRowFormat& format, TraceLogMemoryInfo* memInfo)
 {
 	constexpr char activeStatusLetters[8] = { 'N', 'V', '-', '-', 'D', 'I', 'Z', 'C' };
 	constexpr char inactiveStatusLetters[8] = { 'n', 'v', '-', '-', 'd', 'i', 'z', 'c' };
 
-	for(RowPart& rowPart : _rowParts) {
+	for(RowPart& rowPart : format.Parts) {
 		switch(rowPart.DataType) {
 			case RowDataType::A: WriteIntValue(output, cpuState.A, rowPart); break;
 			case RowDataType::X: WriteIntValue(output, cpuState.X, rowPart); break;
 			case RowDataType::Y: WriteIntValue(output, cpuState.Y, rowPart); break;
 			case RowDataType::SP: WriteIntValue(output, cpuState.SP, rowPart); break;
 			case RowDataType::PS: GetStatusFlag(activeStatusLetters, inactiveStatusLetters, output, cpuState.PS, rowPart); break;
-			default: ProcessSharedTag(rowPart, output, cpuState, ppuState, disassemblyInfo); break;
+			default: ProcessSharedTag(rowPart, output, cpuState, ppuState, disassemblyInfo, format, memInfo); break;
 		}
 	}
 }
@@ -5,6 +5,7 @@
 #include "Utilities/PNGHelper.h"
 #include "Utilities/HexUtilities.h"
 #include "Utilities/SimpleLock.h"
+#include "Utilities/AutoResetEvent.h"
 #include "Utilities/Timer.h"
 
 class BaseHdNesPack;
@@ -114,7 +115,8 @@ struct HdPpuPixelInfo
 struct HdScreenInfo
 {
 	HdPpuPixelInfo* ScreenTiles;
-	unordered_map<uint32_t, uint8_t> WatchedAddressValues;
+	int32_t ChrPages[8] = {}; //Absolute 1 KB CHR ROM page mapped to each PPU page at the end of the frame (only set when a texture budget is used)
+	vector<uint8_t> WatchedAddressValues; //Indexed by the slot assigned to each watched address (see HdPackData::WatchedMemoryAddresses)
 	uint32_t FrameNumber = 0;
 
 	HdScreenInfo(const HdScreenInfo& that) = delete;
@@ -169,6 +171,9 @@ protected:
 public:
 	string Name;
 
+	//Index in HdPackData::FrameConditions (-1 for conditions that depend on the pixel)
+	int32_t FrameIndex = -1;
+
 	virtual HdPackConditionType GetConditionType() = 0;
 	virtual string GetConditionName() = 0;
 	virtual bool IsExcludedFromFile() { return Name.size() > 0 && Name[0] == '!'; }
@@ -201,6 +206,9 @@ public:
 		
 	}
 
+	//Conditions that use the cache have the same result for every pixel of a frame
+	bool IsFrameConstant() { return _useCache; }
+
 protected:
 	int8_t _resultCache = -1;
 	bool _useCache = false;
@@ -208,10 +216,93 @@ protected:
 	virtual bool InternalCheckCondition(int x, int y, HdPpuTileInfo* tile) = 0;
 };
 
+enum class HdPackConditionOpcode : uint8_t
+{
+	FrameConstant,
+	HMirror,
+	VMirror,
+	BgPriority,
+	SpritePalette,
+	PositionCheck,
+	TileNearby,
+	SpriteNearby,
+	Generic
+};
+
+//Condition lowered by HdPackLoader into a compact form that HdPackConditionEvaluator can check without virtual calls
+struct HdPackConditionOp
+{
+	HdPackConditionOpcode Opcode = HdPackConditionOpcode::Generic;
+	bool Invert = false;
+	uint32_t Operand = 0;
+	HdPackCondition* Condition = nullptr;
+};
+
+//Results of the conditions that give the same result for every pixel of a frame (memory checks, frame ranges, etc.),
+//stored as a bitset indexed by HdPackCondition::FrameIndex. Each condition is evaluated at most once per frame.
+class HdPackFrameConditions
+{
+private:
+	vector<HdPackCondition*> _conditions;
+	vector<uint64_t> _evaluated;
+	vector<uint64_t> _results;
+
+	__noinline bool Evaluate(uint32_t index)
+	{
+		bool result = _conditions[index]->CheckCondition(0, 0, nullptr);
+		uint64_t bit = 1ULL << (index & 0x3F);
+		_evaluated[index >> 6] |= bit;
+		if(result) {
+			_results[index >> 6] |= bit;
+		}
+		return result;
+	}
+
+public:
+	void Init(const vector<HdPackCondition*>& conditions)
+	{
+		_conditions = conditions;
+		_evaluated.assign((conditions.size() + 63) / 64, 0);
+		_results.assign(_evaluated.size(), 0);
+	}
+
+	void Reset()
+	{
+		std::fill(_evaluated.begin(), _evaluated.end(), 0);
+		std::fill(_results.begin(), _results.end(), 0);
+	}
+
+	void EvaluateAll()
+	{
+		for(uint32_t i = 0; i < (uint32_t)_conditions.size(); i++) {
+			Check(i);
+		}
+	}
+
+	__forceinline bool Check(uint32_t index)
+	{
+		uint64_t bit = 1ULL << (index & 0x3F);
+		if(!(_evaluated[index >> 6] & bit)) {
+			return Evaluate(index);
+		}
+		return (_results[index >> 6] & bit) != 0;
+	}
+};
+
+//Counters for the texture budget (see HdPackData::SetTextureBudget)
+struct HdPackTextureStats
+{
+	atomic<uint64_t> Hits = { 0 };
+	atomic<uint64_t> Misses = { 0 };
+	atomic<uint64_t> Decodes = { 0 };
+	atomic<uint64_t> Evictions = { 0 };
+	atomic<int64_t> ResidentBytes = { 0 };
+};
+
 struct HdPackBitmapInfo
 {
 private:
-	bool _initDone = false;
+	atomic<bool> _initDone = { false };
 	SimpleLock _lock;
 
 public:
@@ -221,6 +312,18 @@ public:
 	uint32_t Width;
 	uint32_t Height;
 
+	HdPackTextureStats* Stats = nullptr;
+	bool KeepFileData = false;
+	//Used to check if the file changed since the HD pack's cache was created
+	uint64_t FileSize = 0;
+	int64_t FileTime = 0;
+	uint32_t LastUsedFrame = 0;
+
+	bool IsLoaded()
+	{
+		return _initDone;
+	}
+
 	void Init()
 	{
 		if(_initDone) {
@@ -235,19 +338,41 @@ public:
 		//Timer tmr;
 		if(PNGHelper::ReadPNG(FileData, PixelData, Width, Height)) {
 			//MessageManager::Log("[HDPack] PNG file loaded: " + PngName + " (" + std::to_string(tmr.GetElapsedMS()) + ")");
-			PremultiplyAlpha();
+			PremultiplyAlpha(PixelData);
 		} else {
 			MessageManager::Log("[HDPack] PNG file " + PngName + " is invalid.");
 		}
-		FileData = {};
+		if(!KeepFileData) {
+			FileData = {};
+		}
+		if(Stats) {
+			Stats->Decodes++;
+			Stats->ResidentBytes += PixelData.size() * sizeof(uint32_t);
+		}
 		_initDone = true;
 	}
 
-	void PremultiplyAlpha()
+	//Frees the decoded pixels, the PNG file is decoded again on the next Init() call
+	void Unload()
+	{
+		auto lock = _lock.AcquireSafe();
+		if(!_initDone || FileData.empty()) {
+			return;
+		}
+
+		if(Stats) {
+			Stats->Evictions++;
+			Stats->ResidentBytes -= PixelData.size() * sizeof(uint32_t);
+		}
+		PixelData = {};
+		_initDone = false;
+	}
+
+	static void PremultiplyAlpha(vector<uint32_t>& pixelData)
 	{
-		for(size_t i = 0; i < PixelData.size(); i++) {
-			if(PixelData[i] < 0xFF000000) {
-				uint8_t* output = (uint8_t*)(PixelData.data() + i);
+		for(size_t i = 0; i < pixelData.size(); i++) {
+			if(pixelData[i] < 0xFF000000) {
+				uint8_t* output = (uint8_t*)(pixelData.data() + i);
 				uint8_t alpha = output[3] + 1;
 				output[0] = (uint8_t)((alpha * output[0]) >> 8);
 				output[1] = (uint8_t)((alpha * output[1]) >> 8);
@@ -260,7 +385,7 @@ public:
 struct HdPackTileInfo : public HdTileKey
 {
 private:
-	bool _needInit = true;
+	atomic<bool> _needInit = { true };
 
 public:
 	uint32_t X;
@@ -279,17 +404,10 @@ public:
 	uint32_t ChrBankId;
 
 	vector<HdPackCondition*> Conditions;
+	vector<HdPackConditionOp> CompiledConditions;
 	bool ForceDisableCache;
-
-	bool MatchesCondition(int x, int y, HdPpuTileInfo* tile)
-	{
-		for(HdPackCondition* condition : Conditions) {
-			if(!condition->CheckCondition(x, y, tile)) {
-				return false;
-			}
-		}
-		return true;
-	}
+	bool HasFrameConstantConditions = false;
+	atomic<uint32_t> LastUsedFrame = { 0 };
 
 	vector<uint32_t> ToRgb(uint32_t* palette)
 	{
@@ -312,24 +430,53 @@ public:
 		return rgbBuffer;
 	}
 
-	void UpdateFlags()
+	static void GetTileFlags(vector<uint32_t>& tileData, bool& blank, bool& hasTransparentPixels, bool& isFullyTransparent)
 	{
-		Blank = true;
-		HasTransparentPixels = false;
-		IsFullyTransparent = true;
-		for(size_t i = 0; i < HdTileData.size(); i++) {
-			if(HdTileData[i] != HdTileData[0]) {
-				Blank = false;
+		blank = true;
+		hasTransparentPixels = false;
+		isFullyTransparent = true;
+		for(size_t i = 0; i < tileData.size(); i++) {
+			if(tileData[i] != tileData[0]) {
+				blank = false;
+			}
+			if((tileData[i] & 0xFF000000) != 0xFF000000) {
+				hasTransparentPixels = true;
 			}
-			if((HdTileData[i] & 0xFF000000) != 0xFF000000) {
-				HasTransparentPixels = true;
+			if(tileData[i] & 0xFF000000) {
+				isFullyTransparent = false;
 			}
-			if(HdTileData[i] & 0xFF000000) {
-				IsFullyTransparent = false;
+		}
+	}
+
+	void UpdateFlags()
+	{
+		GetTileFlags(HdTileData, Blank, HasTransparentPixels, IsFullyTransparent);
+	}
+
+	//Copies the tile's pixels out of its (decoded) bitmap
+	void ExtractTileData(vector<uint32_t>& bitmapData, uint32_t bitmapWidth, vector<uint32_t>& out)
+	{
+		uint32_t bitmapOffset = Y * bitmapWidth + X;
+
+		out.resize(Width * Height);
+		if(bitmapData.size() >= bitmapOffset + ((Height - 1) * bitmapWidth) + Width) {
+			for(uint32_t y = 0; y < Height; y++) {
+				memcpy(out.data() + (y * Width), bitmapData.data() + bitmapOffset, Width * sizeof(uint32_t));
+				bitmapOffset += bitmapWidth;
 			}
 		}
 	}
 
+	//Used when the tile's pixels were loaded from the HD pack's cache file
+	void SetPreloadedData(vector<uint32_t>&& tileData, bool blank, bool hasTransparentPixels, bool isFullyTransparent)
+	{
+		HdTileData = std::move(tileData);
+		Blank = blank;
+		HasTransparentPixels = hasTransparentPixels;
+		IsFullyTransparent = isFullyTransparent;
+		_needInit = false;
+	}
+
 	__forceinline bool NeedInit()
 	{
 		return _needInit;
@@ -337,21 +484,34 @@ public:
 
 	__noinline void Init()
 	{
-		_needInit = false;
 		Bitmap->Init();
+		Bitmap->LastUsedFrame = LastUsedFrame;
 
-		uint32_t bitmapOffset = Y * Bitmap->Width + X;
-		uint32_t* pngData = Bitmap->PixelData.data();
+		ExtractTileData(Bitmap->PixelData, Bitmap->Width, HdTileData);
+		UpdateFlags();
 
-		HdTileData.resize(Width * Height);
-		if(Bitmap->PixelData.size() >= bitmapOffset + ((Height - 1) * Bitmap->Width) + Width) {
-			for(uint32_t y = 0; y < Height; y++) {
-				memcpy(HdTileData.data() + (y * Width), pngData + bitmapOffset, Width * sizeof(uint32_t));
-				bitmapOffset += Bitmap->Width;
-			}
+		if(Bitmap->Stats) {
+			Bitmap->Stats->Misses++;
+			Bitmap->Stats->ResidentBytes += HdTileData.size() * sizeof(uint32_t);
 		}
 
-		UpdateFlags();
+		//Cleared last, the tile's data must be ready before other threads can use it
+		_needInit = false;
+	}
+
+	//Frees the tile's HD data, it is copied from the bitmap again on the next Init() call (must not be called while rendering)
+	void Unload()
+	{
+		if(_needInit) {
+			return;
+		}
+
+		if(Bitmap->Stats) {
+			Bitmap->Stats->Evictions++;
+			Bitmap->Stats->ResidentBytes -= HdTileData.size() * sizeof(uint32_t);
+		}
+		HdTileData = {};
+		_needInit = true;
 	}
 
 	string ToString(int pngIndex)
@@ -469,14 +629,104 @@ struct BgmTrackInfo
 	uint32_t LoopPosition = 0;
 };
 
+//Open-addressing hash table built once the pack is loaded, used to find the tiles that match a HdTileKey
+class HdPackTileLookup
+{
+public:
+	struct Entry
+	{
+		HdTileKey Key;
+		uint32_t Hash = 0;
+		uint32_t CandidateCount = 0;
+		HdPackTileInfo** Candidates = nullptr;
+	};
+
+private:
+	vector<Entry> _entries;
+	vector<HdPackTileInfo*> _candidates;
+	uint32_t _shift = 0;
+
+	__forceinline uint32_t GetSlot(uint32_t hash) const
+	{
+		//Spread the hash's bits, since CHR ROM tile hashes are mostly in their lowest bits
+		return (hash * 0x9E3779B1) >> _shift;
+	}
+
+public:
+	void Build(const unordered_map<HdTileKey, vector<HdPackTileInfo*>>& tilesByKey)
+	{
+		//Keep the table at most half full to keep probe sequences short
+		uint32_t bits = 4;
+		while(((size_t)1 << bits) < tilesByKey.size() * 2) {
+			bits++;
+		}
+		_shift = 32 - bits;
+		_entries.assign((size_t)1 << bits, {});
+
+		size_t candidateCount = 0;
+		for(auto& [key, tiles] : tilesByKey) {
+			candidateCount += tiles.size();
+		}
+		_candidates.clear();
+		_candidates.reserve(candidateCount);
+
+		uint32_t mask = (uint32_t)_entries.size() - 1;
+		for(auto& [key, tiles] : tilesByKey) {
+			Entry entry;
+			entry.Key = key;
+			entry.Hash = key.GetHashCode();
+			entry.CandidateCount = (uint32_t)tiles.size();
+			entry.Candidates = _candidates.data() + _candidates.size();
+			_candidates.insert(_candidates.end(), tiles.begin(), tiles.end());
+
+			uint32_t slot = GetSlot(entry.Hash);
+			while(_entries[slot].CandidateCount > 0) {
+				slot = (slot + 1) & mask;
+			}
+			_entries[slot] = entry;
+		}
+	}
+
+	__forceinline const Entry* Find(const HdTileKey& key) const
+	{
+		return Find(key, key.GetHashCode());
+	}
+
+	__forceinline const Entry* Find(const HdTileKey& key, uint32_t hash) const
+	{
+		if(_entries.empty()) {
+			return nullptr;
+		}
+
+		uint32_t mask = (uint32_t)_entries.size() - 1;
+		uint32_t slot = GetSlot(hash);
+		while(true) {
+			const Entry& entry = _entries[slot];
+			if(entry.CandidateCount == 0) {
+				return nullptr;
+			} else if(entry.Hash == hash && key == entry.Key) {
+				return &entry;
+			}
+			slot = (slot + 1) & mask;
+		}
+	}
+};
+
 struct HdPackData
 {
 private:
-	bool _cancelLoad = false;
+	atomic<bool> _cancelLoad = { false };
+
+	SimpleLock _prefetchLock;
+	AutoResetEvent _prefetchSignal;
+	vector<HdPackBitmapInfo*> _prefetchQueue;
 
 public:
 	static constexpr int BgLayerCount = 40;
 
+	//Decoded data that hasn't been used for this many frames can be evicted when over the texture budget
+	static constexpr uint32_t TextureMinIdleFrames = 120;
+
 	vector<HdBackgroundInfo> BackgroundsByPriority[HdPackData::BgLayerCount];
 	vector<unique_ptr<HdPackBitmapInfo>> BackgroundFileData;
 	vector<unique_ptr<HdPackBitmapInfo>> ImageFileData;
@@ -484,8 +734,10 @@ public:
 	vector<unique_ptr<HdPackCondition>> Conditions;
 	vector<HdPackAdditionalSpriteInfo> AdditionalSprites;
 	vector<FallbackTileInfo> FallbackTiles;
-	unordered_set<uint32_t> WatchedMemoryAddresses;
-	unordered_map<HdTileKey, vector<HdPackTileInfo*>> TileByKey;
+	vector<HdPackCondition*> FrameConditions;
+	vector<uint32_t> WatchedMemoryAddresses;
+	HdPackTileLookup TileByKey;
+	unordered_map<uint32_t, vector<HdPackBitmapInfo*>> BitmapsByChrPage;
 	unordered_map<string, string> PatchesByHash;
 	unordered_map<int, BgmTrackInfo> BgmFilesById;
 	unordered_map<int, string> SfxFilesById;
@@ -498,31 +750,102 @@ public:
 	uint32_t Version = 0;
 	uint32_t OptionFlags = 0;
 
+	uint64_t TextureBudget = 0;
+	HdPackTextureStats TextureStats;
+
+	string CachePath;
+	string DefinitionHash;
+	bool CacheNeedsSave = false;
+	bool TilesPreloaded = false;
+
 	HdPackData() { }
 	~HdPackData() { }
 
 	HdPackData(const HdPackData&) = delete;
 	HdPackData& operator=(const HdPackData&) = delete;
 
+	//When a budget is set, PNG files are decoded on first use (or when prefetched) instead of on load,
+	//and their compressed data is kept so that their pixels can be evicted and decoded again later
+	void SetTextureBudget(uint64_t budget)
+	{
+		TextureBudget = budget;
+		for(auto& bitmap : BackgroundFileData) {
+			bitmap->KeepFileData = budget > 0;
+		}
+		for(auto& bitmap : ImageFileData) {
+			bitmap->KeepFileData = budget > 0;
+			if(budget == 0 && TilesPreloaded) {
+				//The tiles' pixels were loaded from the cache, the PNG files are only needed to reload evicted tiles
+				bitmap->FileData = {};
+			}
+		}
+	}
+
+	void RequestPrefetch(HdPackBitmapInfo* bitmap)
+	{
+		{
+			auto lock = _prefetchLock.AcquireSafe();
+			_prefetchQueue.push_back(bitmap);
+		}
+		_prefetchSignal.Signal();
+	}
+
+	void ProcessPrefetchQueue()
+	{
+		if(TextureBudget == 0) {
+			return;
+		}
+
+		while(!_cancelLoad) {
+			_prefetchSignal.Wait();
+
+			vector<HdPackBitmapInfo*> bitmaps;
+			{
+				auto lock = _prefetchLock.AcquireSafe();
+				bitmaps.swap(_prefetchQueue);
+			}
+
+			for(HdPackBitmapInfo* bitmap : bitmaps) {
+				if(_cancelLoad) {
+					return;
+				}
+				bitmap->Init();
+			}
+		}
+	}
+
 	void LoadAsync()
 	{
+		if(TextureBudget > 0) {
+			//PNG files are decoded on demand (see ProcessPrefetchQueue)
+			return;
+		}
+
 		for(auto& bitmap : BackgroundFileData) {
 			bitmap->Init();
 			if(_cancelLoad) {
 				return;
 			}
 		}
-		for(auto& bitmap : ImageFileData) {
-			bitmap->Init();
-			if(_cancelLoad) {
-				return;
+		if(!TilesPreloaded) {
+			for(auto& bitmap : ImageFileData) {
+				bitmap->Init();
+				if(_cancelLoad) {
+					return;
+				}
 			}
 		}
 	}
 
+	bool IsLoadCancelled()
+	{
+		return _cancelLoad;
+	}
+
 	void CancelLoad()
 	{
 		_cancelLoad = true;
+		_prefetchSignal.Signal();
 	}
 };
 
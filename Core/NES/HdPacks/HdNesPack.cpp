@@ -3,6 +3,8 @@
 #include <unordered_map>
 #include "NES/HdPacks/HdNesPack.h"
 #include "NES/HdPacks/HdPackLoader.h"
+#include "NES/HdPacks/HdPackConditions.h"
+#include "NES/HdPacks/HdPackBlending.h"
 #include "NES/NesConsole.h"
 #include "NES/BaseMapper.h"
 #include "NES/NesDefaultVideoFilter.h"
@@ -10,6 +12,7 @@
 #include "Shared/EmuSettings.h"
 #include "Utilities/FolderUtilities.h"
 #include "Utilities/PNGHelper.h"
+#include "Utilities/ThreadPool.h"
 
 template<uint32_t scale>
 HdNesPack<scale>::HdNesPack(NesConsole* console, EmuSettings* settings, HdPackData* hdData)
@@ -19,12 +22,31 @@ HdNesPack<scale>::HdNesPack(NesConsole* console, EmuSettings* settings, HdPackDa
 	_hdData = hdData;
 
 	InitializeFallbackTiles();
+	InitializeEmphasisLut();
 	CleanupInvalidRules();
+	_frameConditions.Init(_hdData->FrameConditions);
+
+	if constexpr(scale >= 3) {
+		//Higher scales are expensive enough to be worth splitting the screen into bands of scanlines
+		//The pool is shared with the scale filters (both run on the video decoder's thread)
+		_renderPool = ThreadPool::GetSharedPool();
+		if(_renderPool->GetWorkerCount() == 0) {
+			_renderPool.reset();
+		}
+	}
 }
 
 template<uint32_t scale>
 HdNesPack<scale>::~HdNesPack()
 {
+	if(_hdData->TextureBudget > 0) {
+		HdPackTextureStats& stats = _hdData->TextureStats;
+		MessageManager::Log(
+			"[HDPack] Texture cache: " + std::to_string(stats.Hits) + " hits, " + std::to_string(stats.Misses) + " misses, " +
+			std::to_string(stats.Decodes) + " PNG decodes, " + std::to_string(stats.Evictions) + " evictions, " +
+			std::to_string(stats.ResidentBytes / 1024) + " KB resident"
+		);
+	}
 }
 
 template<uint32_t scale>
@@ -79,37 +101,35 @@ void HdNesPack<scale>::InitializeFallbackTiles()
 }
 
 template<uint32_t scale>
-template<HdPackBlendMode blendMode>
-void HdNesPack<scale>::BlendColors(uint8_t output[4], uint8_t input[4])
+void HdNesPack<scale>::InitializeEmphasisLut()
 {
-	if constexpr(blendMode == HdPackBlendMode::Alpha) {
-		uint8_t invertedAlpha = 256 - input[3];
-		output[0] = input[0] + (uint8_t)((invertedAlpha * output[0]) >> 8);
-		output[1] = input[1] + (uint8_t)((invertedAlpha * output[1]) >> 8);
-		output[2] = input[2] + (uint8_t)((invertedAlpha * output[2]) >> 8);
-		output[3] = 0xFF;
-	} else if constexpr(blendMode == HdPackBlendMode::Add) {
-		output[0] = (uint8_t)std::min(255, (int)input[0] + (int)output[0]);
-		output[1] = (uint8_t)std::min(255, (int)input[1] + (int)output[1]);
-		output[2] = (uint8_t)std::min(255, (int)input[2] + (int)output[2]);
-		output[3] = 0xFF;
-	} else if constexpr(blendMode == HdPackBlendMode::Subtract) {
-		output[0] = (uint8_t)std::max(0, (int)output[0] - (int)input[0]);
-		output[1] = (uint8_t)std::max(0, (int)output[1] - (int)input[1]);
-		output[2] = (uint8_t)std::max(0, (int)output[2] - (int)input[2]);
-		output[3] = 0xFF;
-	}
-}
+	for(int emphasisBits = 0; emphasisBits < 8; emphasisBits++) {
+		double red = 1.0, green = 1.0, blue = 1.0;
+		if(emphasisBits & 0x01) {
+			//Intensify red
+			red *= 1.1;
+			green *= 0.9;
+			blue *= 0.9;
+		}
+		if(emphasisBits & 0x02) {
+			//Intensify green
+			green *= 1.1;
+			red *= 0.9;
+			blue *= 0.9;
+		}
+		if(emphasisBits & 0x04) {
+			//Intensify blue
+			blue *= 1.1;
+			red *= 0.9;
+			green *= 0.9;
+		}
 
-template<uint32_t scale>
-uint32_t HdNesPack<scale>::AdjustBrightness(uint8_t input[4], int brightness)
-{
-	return (
-		std::min(255, (brightness * ((int)input[0] + 1)) >> 8) |
-		(std::min(255, (brightness * ((int)input[1] + 1)) >> 8) << 8) |
-		(std::min(255, (brightness * ((int)input[2] + 1)) >> 8) << 16) |
-		(input[3] << 24)
-	);
+		for(int i = 0; i < 256; i++) {
+			_emphasisLut[emphasisBits][0][i] = (uint8_t)std::min<uint16_t>((uint16_t)(i * blue), 255);
+			_emphasisLut[emphasisBits][1][i] = (uint8_t)std::min<uint16_t>((uint16_t)(i * green), 255);
+			_emphasisLut[emphasisBits][2][i] = (uint8_t)std::min<uint16_t>((uint16_t)(i * red), 255);
+		}
+	}
 }
 
 template<uint32_t scale>
@@ -130,44 +150,35 @@ void HdNesPack<scale>::DrawColor(uint32_t color, uint32_t *outputBuffer, uint32_
 	}
 }
 
+template<uint32_t scale>
+void HdNesPack<scale>::DrawColorSpan(uint32_t color, uint32_t *outputBuffer, uint32_t screenWidth, uint32_t pixelCount)
+{
+	for(uint32_t i = 0; i < scale; i++) {
+		std::fill(outputBuffer, outputBuffer + scale * pixelCount, color);
+		outputBuffer += screenWidth;
+	}
+}
+
 template<uint32_t scale>
 template<HdPackBlendMode blendMode>
-void HdNesPack<scale>::DrawCustomBackground(HdBackgroundInfo& bgInfo, uint32_t *outputBuffer, uint32_t x, uint32_t y, uint32_t screenWidth)
+void HdNesPack<scale>::DrawCustomBackground(HdBackgroundInfo& bgInfo, uint32_t *outputBuffer, uint32_t x, uint32_t y, uint32_t screenWidth, uint32_t pixelCount)
 {
 	uint32_t width = bgInfo.Data->Width;
 	uint32_t *pngData = bgInfo.data() + ((bgInfo.Top + y) * scale * width) + ((bgInfo.Left + x) * scale);
+	uint32_t rowWidth = pixelCount * scale;
 
 	if(bgInfo.Brightness == 255) {
 		for(uint32_t i = 0; i < scale; i++) {
-			for(uint32_t j = 0; j < scale; j++) {
-				uint32_t pixelColor = pngData[j];
-				if constexpr(blendMode == HdPackBlendMode::Alpha) {
-					if(pixelColor >= 0xFF000000) {
-						outputBuffer[j] = pixelColor;
-					} else if(pixelColor >= 0x01000000) {
-						BlendColors<blendMode>((uint8_t*)(outputBuffer + j), (uint8_t*)(&pixelColor));
-					}
-				} else {
-					BlendColors<blendMode>((uint8_t*)(outputBuffer + j), (uint8_t*)(&pixelColor));
-				}
-			}
+			HdPackBlending::BlendRow<blendMode>(outputBuffer, pngData, rowWidth);
 			outputBuffer += screenWidth;
 			pngData += width;
 		}
 	} else {
+		//Spans never cover more than a single 8x8 tile
+		uint32_t rowData[8 * scale];
 		for(uint32_t i = 0; i < scale; i++) {
-			for(uint32_t j = 0; j < scale; j++) {
-				uint32_t pixelColor = AdjustBrightness((uint8_t*)(pngData + j), bgInfo.Brightness);
-				if constexpr(blendMode == HdPackBlendMode::Alpha) {
-					if(pixelColor >= 0xFF000000) {
-						outputBuffer[j] = pixelColor;
-					} else if(pixelColor >= 0x01000000) {
-						BlendColors<blendMode>((uint8_t*)(outputBuffer + j), (uint8_t*)(&pixelColor));
-					}
-				} else {
-					BlendColors<blendMode>((uint8_t*)(outputBuffer + j), (uint8_t*)(&pixelColor));
-				}
-			}
+			HdPackBlending::AdjustBrightnessRow(rowData, pngData, rowWidth, bgInfo.Brightness);
+			HdPackBlending::BlendRow<blendMode>(outputBuffer, rowData, rowWidth);
 			outputBuffer += screenWidth;
 			pngData += width;
 		}
@@ -181,77 +192,88 @@ void HdNesPack<scale>::DrawTile(HdPpuTileInfo &tileInfo, HdPackTileInfo &hdPackT
 		return;
 	}
 
-	uint32_t *bitmapData = hdPackTileInfo.HdTileData.data();
-	uint32_t tileWidth = 8 * scale;
+	constexpr int32_t tileWidth = 8 * scale;
 	uint8_t tileOffsetX = tileInfo.HorizontalMirroring ? 7 - tileInfo.OffsetX : tileInfo.OffsetX;
-	uint32_t bitmapOffset = (tileInfo.OffsetY * scale) * tileWidth + tileOffsetX * scale;
-	int32_t bitmapSmallInc = 1;
-	int32_t bitmapLargeInc = tileWidth - scale;
-	if(tileInfo.HorizontalMirroring) {
-		bitmapOffset += scale - 1;
-		bitmapSmallInc = -1;
-		bitmapLargeInc = tileWidth + scale;
-	}
+	uint32_t *bitmapRow = hdPackTileInfo.HdTileData.data() + (tileInfo.OffsetY * scale) * tileWidth + tileOffsetX * scale;
+	int32_t bitmapRowInc = tileWidth;
 	if(tileInfo.VerticalMirroring) {
-		bitmapOffset += tileWidth * (scale - 1);
-		bitmapLargeInc = (tileInfo.HorizontalMirroring ? (int32_t)scale : -(int32_t)scale) - (int32_t)tileWidth;
+		bitmapRow += tileWidth * (scale - 1);
+		bitmapRowInc = -tileWidth;
 	}
 
-	uint32_t rgbValue;
-	if(hdPackTileInfo.HasTransparentPixels || hdPackTileInfo.Brightness != 255) {
-		for(uint32_t y = 0; y < scale; y++) {
-			for(uint32_t x = 0; x < scale; x++) {
-				if(hdPackTileInfo.Brightness == 255) {
-					rgbValue = *(bitmapData + bitmapOffset);
-				} else {
-					rgbValue = AdjustBrightness((uint8_t*)(bitmapData + bitmapOffset), hdPackTileInfo.Brightness);
-				}
+	bool adjustBrightness = hdPackTileInfo.Brightness != 255;
+	uint32_t rowData[scale];
+	for(uint32_t y = 0; y < scale; y++) {
+		uint32_t* src = bitmapRow;
+		if(tileInfo.HorizontalMirroring) {
+			std::reverse_copy(bitmapRow, bitmapRow + scale, rowData);
+			src = rowData;
+		}
 
-				if(!hdPackTileInfo.HasTransparentPixels || (bitmapData[bitmapOffset] & 0xFF000000) == 0xFF000000) {
-					*outputBuffer = rgbValue;
-				} else {
-					if(bitmapData[bitmapOffset] & 0xFF000000) {
-						BlendColors<HdPackBlendMode::Alpha>((uint8_t*)outputBuffer, (uint8_t*)&rgbValue);
-					}
-				}
-				outputBuffer++;
-				bitmapOffset += bitmapSmallInc;
-			}
-			bitmapOffset += bitmapLargeInc;
-			outputBuffer += screenWidth - scale;
+		if(adjustBrightness) {
+			HdPackBlending::AdjustBrightnessRow(rowData, src, scale, hdPackTileInfo.Brightness);
+			src = rowData;
 		}
-	} else {
-		for(uint32_t y = 0; y < scale; y++) {
-			for(uint32_t x = 0; x < scale; x++) {
-				*outputBuffer = *(bitmapData + bitmapOffset);
-				outputBuffer++;
-				bitmapOffset += bitmapSmallInc;
-			}
-			bitmapOffset += bitmapLargeInc;
-			outputBuffer += screenWidth - scale;
+
+		if(hdPackTileInfo.HasTransparentPixels) {
+			HdPackBlending::BlendRow<HdPackBlendMode::Alpha>(outputBuffer, src, scale);
+		} else {
+			memcpy(outputBuffer, src, scale * sizeof(uint32_t));
+		}
+
+		bitmapRow += bitmapRowInc;
+		outputBuffer += screenWidth;
+	}
+}
+
+template<uint32_t scale>
+void HdNesPack<scale>::DrawTileSpan(HdPpuTileInfo &tileInfo, HdPackTileInfo &hdPackTileInfo, uint32_t *outputBuffer, uint32_t screenWidth, uint32_t pixelCount)
+{
+	//Draws pixelCount consecutive pixels of a (non-mirrored) tile's row, starting at tileInfo's offset
+	if(hdPackTileInfo.IsFullyTransparent) {
+		return;
+	}
+
+	constexpr uint32_t tileWidth = 8 * scale;
+	uint32_t rowWidth = pixelCount * scale;
+	uint32_t *bitmapRow = hdPackTileInfo.HdTileData.data() + (tileInfo.OffsetY * scale) * tileWidth + tileInfo.OffsetX * scale;
+
+	uint32_t rowData[tileWidth];
+	for(uint32_t y = 0; y < scale; y++) {
+		uint32_t* src = bitmapRow;
+		if(hdPackTileInfo.Brightness != 255) {
+			HdPackBlending::AdjustBrightnessRow(rowData, src, rowWidth, hdPackTileInfo.Brightness);
+			src = rowData;
 		}
+
+		if(hdPackTileInfo.HasTransparentPixels) {
+			HdPackBlending::BlendRow<HdPackBlendMode::Alpha>(outputBuffer, src, rowWidth);
+		} else {
+			memcpy(outputBuffer, src, rowWidth * sizeof(uint32_t));
+		}
+
+		bitmapRow += tileWidth;
+		outputBuffer += screenWidth;
 	}
 }
 
 template<uint32_t scale>
-void HdNesPack<scale>::OnLineStart(HdPpuPixelInfo &lineFirstPixel, uint8_t y)
+void HdNesPack<scale>::OnLineStart(HdLineState& state, HdPpuPixelInfo &lineFirstPixel, uint8_t y)
 {
-	_scrollX = ((lineFirstPixel.TmpVideoRamAddr & 0x1F) << 3) | lineFirstPixel.XScroll | ((lineFirstPixel.TmpVideoRamAddr & 0x400) ? 0x100 : 0);
-	_useCachedTile = false;
+	state.ScrollX = ((lineFirstPixel.TmpVideoRamAddr & 0x1F) << 3) | lineFirstPixel.XScroll | ((lineFirstPixel.TmpVideoRamAddr & 0x400) ? 0x100 : 0);
+	state.UseCachedTile = false;
 
 	int32_t scrollY = (((lineFirstPixel.TmpVideoRamAddr & 0x3E0) >> 2) | ((lineFirstPixel.TmpVideoRamAddr & 0x7000) >> 12)) + ((lineFirstPixel.TmpVideoRamAddr & 0x800) ? 240 : 0);
 	
 	for(int layer = 0; layer < 4; layer++) {
 		for(int i = 0; i < _activeBgCount[layer]; i++) {
-			HdBgConfig& cfg = _bgConfig[layer * HdNesPack::PriorityLevelsPerLayer + i];
+			HdBgConfig& cfg = state.BgConfig[layer * HdNesPack::PriorityLevelsPerLayer + i];
 			if(cfg.BackgroundIndex < 0) {
 				continue;
 			}
 
 			HdBackgroundInfo& bgInfo = _hdData->BackgroundsByPriority[cfg.BgPriority][cfg.BackgroundIndex];
-			bgInfo.Data->Init();
-
-			cfg.BgScrollX = (int32_t)(_scrollX * bgInfo.HorizontalScrollRatio);
+			cfg.BgScrollX = (int32_t)(state.ScrollX * bgInfo.HorizontalScrollRatio);
 			cfg.BgScrollY = (int32_t)(scrollY * bgInfo.VerticalScrollRatio);
 			if(y >= -cfg.BgScrollY && (y + bgInfo.Top + cfg.BgScrollY + 1) * scale <= bgInfo.Data->Height) {
 				cfg.BgMinX = -cfg.BgScrollX;
@@ -270,7 +292,8 @@ int32_t HdNesPack<scale>::GetLayerIndex(uint8_t priority)
 	for(size_t i = 0; i < _hdData->BackgroundsByPriority[priority].size(); i++) {
 		bool isMatch = true;
 		for(HdPackCondition* condition : _hdData->BackgroundsByPriority[priority][i].Conditions) {
-			if(!condition->CheckCondition(0, 0, nullptr)) {
+			//Background conditions are all frame-constant
+			if(!_frameConditions.Check(condition->FrameIndex)) {
 				isMatch = false;
 				break;
 			}
@@ -289,6 +312,7 @@ void HdNesPack<scale>::OnBeforeApplyFilter()
 	for(unique_ptr<HdPackCondition>& condition : _hdData->Conditions) {
 		condition->Initialize(_hdScreenInfo, this);
 	}
+	_frameConditions.Reset();
 
 	if(_hdData->Palette.size() == 0x40) {
 		memcpy(_palette, _hdData->Palette.data(), 0x40 * sizeof(uint32_t));
@@ -304,6 +328,9 @@ void HdNesPack<scale>::OnBeforeApplyFilter()
 			if(index >= 0) {
 				_bgConfig[layer*10+activeCount].BgPriority = layer * HdNesPack::PriorityLevelsPerLayer + i;
 				_bgConfig[layer*10+activeCount].BackgroundIndex = index;
+				HdPackBitmapInfo* bgData = _hdData->BackgroundsByPriority[layer * HdNesPack::PriorityLevelsPerLayer + i][index].Data;
+				bgData->Init();
+				bgData->LastUsedFrame = _hdScreenInfo->FrameNumber;
 				activeCount++;
 			}
 		}
@@ -415,102 +442,242 @@ void HdNesPack<scale>::InsertAdditionalSprite(int32_t sourceX, int32_t sourceY,
 }
 
 template<uint32_t scale>
-HdPackTileInfo* HdNesPack<scale>::GetCachedMatchingTile(uint32_t x, uint32_t y, HdPpuTileInfo* tile)
+HdPackTileInfo* HdNesPack<scale>::GetCachedMatchingTile(HdLineState& state, uint32_t x, uint32_t y, HdPpuTileInfo* tile)
 {
-	if(((_scrollX + x) & 0x07) == 0) {
-		_useCachedTile = false;
+	if(((state.ScrollX + x) & 0x07) == 0) {
+		state.UseCachedTile = false;
 	}
 
 	bool disableCache = false;
 	HdPackTileInfo* hdPackTileInfo;
-	if(_useCachedTile) {
-		hdPackTileInfo = _cachedTile;
+	if(state.UseCachedTile) {
+		hdPackTileInfo = state.CachedTile;
 	} else {
-		hdPackTileInfo = GetMatchingTile(x, y, tile, &disableCache);
+		hdPackTileInfo = GetMatchingTile(state, x, y, tile, &disableCache);
 
 		if(!disableCache && _cacheEnabled) {
 			//Use this tile for the next 8 horizontal pixels
 			//Disable cache if a sprite condition is used, because sprites are not on a 8x8 grid
-			_cachedTile = hdPackTileInfo;
-			_useCachedTile = true;
+			state.CachedTile = hdPackTileInfo;
+			state.UseCachedTile = true;
 		}
 	}
 	return hdPackTileInfo;
 }
 
 template<uint32_t scale>
-HdPackTileInfo* HdNesPack<scale>::GetMatchingTile(uint32_t x, uint32_t y, HdPpuTileInfo* tile, bool* disableCache)
+HdPackTileInfo* HdNesPack<scale>::GetMatchingTile(HdLineState& state, uint32_t x, uint32_t y, HdPpuTileInfo* tile, bool* disableCache)
 {
-	auto hdTile = _hdData->TileByKey.find(*tile);
-	if(hdTile == _hdData->TileByKey.end()) {
+	uint32_t hash = tile->GetHashCode();
+	HdTileMemoEntry& memo = state.TileMemo[hash & (HdNesPack::TileMemoSize - 1)];
+	if(memo.Valid && memo.Key == *tile) {
+		tile->TileIndex = memo.TileIndex;
+		if(disableCache != nullptr && memo.DisableCache) {
+			*disableCache = true;
+		}
+		return memo.Tile;
+	}
+
+	HdTileKey orgKey = *tile;
+	const HdPackTileLookup::Entry* hdTile = _hdData->TileByKey.Find(*tile, hash);
+	if(!hdTile) {
 		int32_t fallbackTileIndex = GetFallbackTile(tile->TileIndex);
 		if(fallbackTileIndex >= 0) {
 			int32_t orgIndex = tile->TileIndex;
 			tile->TileIndex = fallbackTileIndex;
-			hdTile = _hdData->TileByKey.find(*tile);
-			if(hdTile == _hdData->TileByKey.end()) {
-				hdTile = _hdData->TileByKey.find(tile->GetKey(true));
-				if(hdTile == _hdData->TileByKey.end()) {
+			hdTile = _hdData->TileByKey.Find(*tile);
+			if(!hdTile) {
+				hdTile = _hdData->TileByKey.Find(tile->GetKey(true));
+				if(!hdTile) {
 					tile->TileIndex = orgIndex;
 				}
 			}
 		}
 	
-		if(hdTile == _hdData->TileByKey.end()) {
-			hdTile = _hdData->TileByKey.find(tile->GetKey(true));
+		if(!hdTile) {
+			hdTile = _hdData->TileByKey.Find(tile->GetKey(true));
 		}
 	}
 
-	if(hdTile != _hdData->TileByKey.end()) {
-		for(HdPackTileInfo* hdPackTile : hdTile->second) {
-			if(disableCache != nullptr && hdPackTile->ForceDisableCache) {
-				*disableCache = true;
-			}
+	HdPackTileInfo* result = nullptr;
+	bool canMemoize = true;
+	bool disableTileCache = false;
+	if(hdTile) {
+		for(uint32_t i = 0; i < hdTile->CandidateCount; i++) {
+			HdPackTileInfo* hdPackTile = hdTile->Candidates[i];
+			canMemoize &= hdPackTile->HasFrameConstantConditions;
+			disableTileCache |= hdPackTile->ForceDisableCache;
+
+			if(HdPackConditionEvaluator::Matches(*hdPackTile, _frameConditions, x, y, tile)) {
+				if(hdPackTile->LastUsedFrame.load(std::memory_order_relaxed) != _hdScreenInfo->FrameNumber) {
+					hdPackTile->LastUsedFrame.store(_hdScreenInfo->FrameNumber, std::memory_order_relaxed);
+				}
 
-			if(hdPackTile->MatchesCondition(x, y, tile)) {
 				if(hdPackTile->NeedInit()) {
-					hdPackTile->Init();
+					InitTile(hdPackTile);
+				} else {
+					state.TextureHits++;
 				}
-				return hdPackTile;
+				result = hdPackTile;
+				break;
 			}
 		}
 	}
 
-	return nullptr;
+	if(disableCache != nullptr && disableTileCache) {
+		*disableCache = true;
+	}
+
+	if(canMemoize) {
+		memo.Key = orgKey;
+		memo.Tile = result;
+		memo.TileIndex = tile->TileIndex;
+		memo.DisableCache = disableTileCache;
+		memo.Valid = true;
+	}
+
+	return result;
 }
 
 template<uint32_t scale>
-void HdNesPack<scale>::DrawBackgroundLayer(uint8_t priority, uint32_t x, uint32_t y, uint32_t* outputBuffer, uint32_t screenWidth)
+void HdNesPack<scale>::InitTile(HdPackTileInfo* hdPackTile)
 {
-	HdBgConfig bgConfig = _bgConfig[(int)priority];
-	if((int32_t)x >= bgConfig.BgMinX && (int32_t)x <= bgConfig.BgMaxX) {
+	//Tiles are initialized on first use, which can happen on any of the rendering threads
+	auto lock = _tileInitLock.AcquireSafe();
+	if(hdPackTile->NeedInit()) {
+		hdPackTile->Init();
+	}
+}
+
+template<uint32_t scale>
+void HdNesPack<scale>::DrawBackgroundLayer(HdLineState& state, uint8_t priority, uint32_t x, uint32_t y, uint32_t* outputBuffer, uint32_t screenWidth, uint32_t pixelCount)
+{
+	HdBgConfig& bgConfig = state.BgConfig[(int)priority];
+
+	//Only draw the part of the span that is covered by the background's image
+	int32_t start = std::max((int32_t)x, (int32_t)bgConfig.BgMinX);
+	int32_t end = std::min((int32_t)(x + pixelCount) - 1, (int32_t)bgConfig.BgMaxX);
+	if(start <= end) {
 		HdBackgroundInfo& bgInfo = _hdData->BackgroundsByPriority[bgConfig.BgPriority][bgConfig.BackgroundIndex];
+		uint32_t* spanOutput = outputBuffer + (start - (int32_t)x) * scale;
+		uint32_t spanLength = end - start + 1;
 		switch(bgInfo.BlendMode) {
-			case HdPackBlendMode::Alpha: DrawCustomBackground<HdPackBlendMode::Alpha>(bgInfo, outputBuffer, x + bgConfig.BgScrollX, y + bgConfig.BgScrollY, screenWidth); break;
-			case HdPackBlendMode::Add: DrawCustomBackground<HdPackBlendMode::Add>(bgInfo, outputBuffer, x + bgConfig.BgScrollX, y + bgConfig.BgScrollY, screenWidth); break;
-			case HdPackBlendMode::Subtract: DrawCustomBackground<HdPackBlendMode::Subtract>(bgInfo, outputBuffer, x + bgConfig.BgScrollX, y + bgConfig.BgScrollY, screenWidth); break;
+			case HdPackBlendMode::Alpha: DrawCustomBackground<HdPackBlendMode::Alpha>(bgInfo, spanOutput, start + bgConfig.BgScrollX, y + bgConfig.BgScrollY, screenWidth, spanLength); break;
+			case HdPackBlendMode::Add: DrawCustomBackground<HdPackBlendMode::Add>(bgInfo, spanOutput, start + bgConfig.BgScrollX, y + bgConfig.BgScrollY, screenWidth, spanLength); break;
+			case HdPackBlendMode::Subtract: DrawCustomBackground<HdPackBlendMode::Subtract>(bgInfo, spanOutput, start + bgConfig.BgScrollX, y + bgConfig.BgScrollY, screenWidth, spanLength); break;
+		}
+	}
+}
+
+template<uint32_t scale>
+uint32_t HdNesPack<scale>::DrawPixels(HdLineState& state, uint32_t x, uint32_t xMax, uint32_t y, HdPpuPixelInfo* pixels, uint32_t* outputBuffer, uint32_t screenWidth)
+{
+	HdPpuPixelInfo& pixelInfo = pixels[0];
+	if(pixelInfo.SpriteCount > 0 || pixelInfo.Tile.TileIndex == HdPpuTileInfo::NoTile) {
+		GetPixels(state, x, y, pixelInfo, outputBuffer, screenWidth);
+		return 1;
+	}
+
+	HdPackTileInfo* hdPackTileInfo = GetCachedMatchingTile(state, x, y, &pixelInfo.Tile);
+	uint32_t spanLength = GetSpanLength(state, x, xMax, pixels);
+	if(spanLength > 1) {
+		DrawSpan(state, x, y, pixels, hdPackTileInfo, outputBuffer, screenWidth, spanLength);
+	} else {
+		DrawPixel(state, x, y, pixelInfo, hdPackTileInfo, outputBuffer, screenWidth);
+	}
+	return spanLength;
+}
+
+template<uint32_t scale>
+uint32_t HdNesPack<scale>::GetSpanLength(HdLineState& state, uint32_t x, uint32_t xMax, HdPpuPixelInfo* pixels)
+{
+	//The following pixels can be drawn together with the first one if they would reuse the same
+	//cached HD tile, contain no sprites, and show the next pixels of the same row of the BG tile
+	if(!state.UseCachedTile) {
+		return 1;
+	}
+
+	HdPpuTileInfo& firstTile = pixels[0].Tile;
+	if(firstTile.HorizontalMirroring || firstTile.VerticalMirroring) {
+		return 1;
+	}
+
+	uint32_t length = 1;
+	while(x + length < xMax && ((state.ScrollX + x + length) & 0x07) != 0) {
+		HdPpuPixelInfo& pixelInfo = pixels[length];
+		HdPpuTileInfo& tile = pixelInfo.Tile;
+		if(
+			pixelInfo.SpriteCount > 0 || tile.TileIndex == HdPpuTileInfo::NoTile ||
+			tile.HorizontalMirroring || tile.VerticalMirroring ||
+			tile.OffsetX != firstTile.OffsetX + length || tile.OffsetY != firstTile.OffsetY ||
+			tile.PpuBackgroundColor != firstTile.PpuBackgroundColor
+		) {
+			break;
+		}
+		length++;
+	}
+	return length;
+}
+
+template<uint32_t scale>
+void HdNesPack<scale>::DrawSpan(HdLineState& state, uint32_t x, uint32_t y, HdPpuPixelInfo* pixels, HdPackTileInfo* hdPackTileInfo, uint32_t* outputBuffer, uint32_t screenWidth, uint32_t pixelCount)
+{
+	//Same drawing order as DrawPixel, for a span of pixels that contains no sprites
+	HdPpuTileInfo& firstTile = pixels[0].Tile;
+	DrawColorSpan(_palette[firstTile.PpuBackgroundColor], outputBuffer, screenWidth, pixelCount);
+
+	for(int i = 0; i < _activeBgCount[0]; i++) {
+		DrawBackgroundLayer(state, HdNesPack::BehindBgSpritesPriority+i, x, y, outputBuffer, screenWidth, pixelCount);
+	}
+
+	for(int i = 0; i < _activeBgCount[1]; i++) {
+		DrawBackgroundLayer(state, HdNesPack::BehindBgPriority+i, x, y, outputBuffer, screenWidth, pixelCount);
+	}
+
+	if(hdPackTileInfo) {
+		DrawTileSpan(firstTile, *hdPackTileInfo, outputBuffer, screenWidth, pixelCount);
+	} else if((_hdData->OptionFlags & (int)HdPackOptions::DontRenderOriginalTiles) == 0) {
+		//Draw regular SD background tile
+		for(uint32_t i = 0; i < pixelCount; i++) {
+			if(pixels[i].Tile.BgColorIndex != 0) {
+				DrawColor(_palette[pixels[i].Tile.BgColor], outputBuffer + i * scale, screenWidth);
+			}
 		}
 	}
+
+	for(int i = 0; i < _activeBgCount[2]; i++) {
+		DrawBackgroundLayer(state, HdNesPack::BehindFgSpritesPriority+i, x, y, outputBuffer, screenWidth, pixelCount);
+	}
+
+	for(int i = 0; i < _activeBgCount[3]; i++) {
+		DrawBackgroundLayer(state, HdNesPack::ForegroundPriority+i, x, y, outputBuffer, screenWidth, pixelCount);
+	}
 }
 
 template<uint32_t scale>
-void HdNesPack<scale>::GetPixels(uint32_t x, uint32_t y, HdPpuPixelInfo &pixelInfo, uint32_t *outputBuffer, uint32_t screenWidth)
+void HdNesPack<scale>::GetPixels(HdLineState& state, uint32_t x, uint32_t y, HdPpuPixelInfo &pixelInfo, uint32_t *outputBuffer, uint32_t screenWidth)
 {
 	HdPackTileInfo *hdPackTileInfo = nullptr;
+	if(pixelInfo.Tile.TileIndex != HdPpuTileInfo::NoTile) {
+		hdPackTileInfo = GetCachedMatchingTile(state, x, y, &pixelInfo.Tile);
+	}
+	DrawPixel(state, x, y, pixelInfo, hdPackTileInfo, outputBuffer, screenWidth);
+}
+
+template<uint32_t scale>
+void HdNesPack<scale>::DrawPixel(HdLineState& state, uint32_t x, uint32_t y, HdPpuPixelInfo &pixelInfo, HdPackTileInfo* hdPackTileInfo, uint32_t *outputBuffer, uint32_t screenWidth)
+{
 	HdPackTileInfo *hdPackSpriteInfo = nullptr;
 
 	bool hasSprite = pixelInfo.SpriteCount > 0;
 	bool renderOriginalTiles = ((_hdData->OptionFlags & (int)HdPackOptions::DontRenderOriginalTiles) == 0);
-	if(pixelInfo.Tile.TileIndex != HdPpuTileInfo::NoTile) {
-		hdPackTileInfo = GetCachedMatchingTile(x, y, &pixelInfo.Tile);
-	}
 
 	int lowestBgSprite = 999;
 	
 	DrawColor(_palette[pixelInfo.Tile.PpuBackgroundColor], outputBuffer, screenWidth);
 
 	for(int i = 0; i < _activeBgCount[0]; i++) {
-		DrawBackgroundLayer(HdNesPack::BehindBgSpritesPriority+i, x, y, outputBuffer, screenWidth);
+		DrawBackgroundLayer(state, HdNesPack::BehindBgSpritesPriority+i, x, y, outputBuffer, screenWidth);
 	}
 
 	if(hasSprite) {
@@ -520,7 +687,7 @@ void HdNesPack<scale>::GetPixels(uint32_t x, uint32_t y, HdPpuPixelInfo &pixelIn
 					lowestBgSprite = k;
 				}
 
-				hdPackSpriteInfo = GetMatchingTile(x, y, &pixelInfo.Sprite[k]);
+				hdPackSpriteInfo = GetMatchingTile(state, x, y, &pixelInfo.Sprite[k]);
 				if(hdPackSpriteInfo) {
 					DrawTile(pixelInfo.Sprite[k], *hdPackSpriteInfo, outputBuffer, screenWidth);
 				} else if(pixelInfo.Sprite[k].SpriteColorIndex != 0) {
@@ -531,7 +698,7 @@ void HdNesPack<scale>::GetPixels(uint32_t x, uint32_t y, HdPpuPixelInfo &pixelIn
 	}
 	
 	for(int i = 0; i < _activeBgCount[1]; i++) {
-		DrawBackgroundLayer(HdNesPack::BehindBgPriority+i, x, y, outputBuffer, screenWidth);
+		DrawBackgroundLayer(state, HdNesPack::BehindBgPriority+i, x, y, outputBuffer, screenWidth);
 	}
 	
 	if(hdPackTileInfo) {
@@ -544,13 +711,13 @@ void HdNesPack<scale>::GetPixels(uint32_t x, uint32_t y, HdPpuPixelInfo &pixelIn
 	}
 
 	for(int i = 0; i < _activeBgCount[2]; i++) {
-		DrawBackgroundLayer(HdNesPack::BehindFgSpritesPriority+i, x, y, outputBuffer, screenWidth);
+		DrawBackgroundLayer(state, HdNesPack::BehindFgSpritesPriority+i, x, y, outputBuffer, screenWidth);
 	}
 
 	if(hasSprite) {
 		for(int k = pixelInfo.SpriteCount - 1; k >= 0; k--) {
 			if(!pixelInfo.Sprite[k].BackgroundPriority && lowestBgSprite > k) {
-				hdPackSpriteInfo = GetMatchingTile(x, y, &pixelInfo.Sprite[k]);
+				hdPackSpriteInfo = GetMatchingTile(state, x, y, &pixelInfo.Sprite[k]);
 				if(hdPackSpriteInfo) {
 					DrawTile(pixelInfo.Sprite[k], *hdPackSpriteInfo, outputBuffer, screenWidth);
 				} else if(pixelInfo.Sprite[k].SpriteColorIndex != 0) {
@@ -561,84 +728,181 @@ void HdNesPack<scale>::GetPixels(uint32_t x, uint32_t y, HdPpuPixelInfo &pixelIn
 	}
 
 	for(int i = 0; i < _activeBgCount[3]; i++) {
-		DrawBackgroundLayer(HdNesPack::ForegroundPriority+i, x, y, outputBuffer, screenWidth);
+		DrawBackgroundLayer(state, HdNesPack::ForegroundPriority+i, x, y, outputBuffer, screenWidth);
 	}
 }
 
 template<uint32_t scale>
-void HdNesPack<scale>::Process(HdScreenInfo *hdScreenInfo, uint32_t* outputBuffer, OverscanDimensions &overscan)
+bool HdNesPack<scale>::CanRenderInParallel()
 {
-	_hdScreenInfo = hdScreenInfo;
-	uint32_t hdScale = GetScale();
-	uint32_t screenWidth = (NesConstants::ScreenWidth - overscan.Left - overscan.Right) * hdScale;
+	//Fallback tiles are resolved by updating the tile index in the screen data while rendering,
+	//which tileNearby/tileAtPosition conditions can observe on other scanlines. Keep these packs on
+	//a single thread to guarantee the same output as the serial path.
+	return _renderPool && _fallbackTiles.empty();
+}
 
-	OnBeforeApplyFilter();
-	for(uint32_t i = overscan.Top, iMax = 240 - overscan.Bottom; i < iMax; i++) {
-		OnLineStart(hdScreenInfo->ScreenTiles[i << 8], i);
-		uint32_t bufferIndex = (i - overscan.Top) * screenWidth * hdScale;
+template<uint32_t scale>
+void HdNesPack<scale>::PrepareParallelRendering()
+{
+	//Evaluate all conditions that don't depend on the pixel's position ahead of time, so the
+	//rendering threads only ever read the frame's condition bitset
+	_frameConditions.EvaluateAll();
+}
+
+template<uint32_t scale>
+void HdNesPack<scale>::RenderLines(uint32_t firstLine, uint32_t lastLine, uint32_t* outputBuffer, OverscanDimensions& overscan, uint32_t screenWidth)
+{
+	HdLineState state;
+	std::copy(std::begin(_bgConfig), std::end(_bgConfig), std::begin(state.BgConfig));
+
+	for(uint32_t i = firstLine; i < lastLine; i++) {
+		OnLineStart(state, _hdScreenInfo->ScreenTiles[i << 8], i);
+		uint32_t bufferIndex = (i - overscan.Top) * screenWidth * scale;
 		uint32_t lineStartIndex = bufferIndex;
-		for(uint32_t j = overscan.Left, jMax = 256 - overscan.Right; j < jMax; j++) {
-			GetPixels(j, i, hdScreenInfo->ScreenTiles[i * 256 + j], outputBuffer + bufferIndex, screenWidth);
-			bufferIndex += hdScale;
+		for(uint32_t j = overscan.Left, jMax = 256 - overscan.Right; j < jMax;) {
+			uint32_t pixelCount = DrawPixels(state, j, jMax, i, _hdScreenInfo->ScreenTiles + i * 256 + j, outputBuffer + bufferIndex, screenWidth);
+			j += pixelCount;
+			bufferIndex += pixelCount * scale;
 		}
 
-		ProcessGrayscaleAndEmphasis(hdScreenInfo->ScreenTiles[i * 256], outputBuffer + lineStartIndex, screenWidth);
+		ProcessGrayscaleAndEmphasis(_hdScreenInfo->ScreenTiles[i * 256], outputBuffer + lineStartIndex, screenWidth);
 	}
+
+	_hdData->TextureStats.Hits += state.TextureHits;
 }
 
 template<uint32_t scale>
-void HdNesPack<scale>::ProcessGrayscaleAndEmphasis(HdPpuPixelInfo &pixelInfo, uint32_t* outputBuffer, uint32_t hdScreenWidth)
+void HdNesPack<scale>::PrefetchBitmaps()
 {
-	//Apply grayscale/emphasis bits on a scanline level (less accurate, but shouldn't cause issues and simpler to implement)
-	if(pixelInfo.Grayscale) {
-		uint32_t* out = outputBuffer;
-		for(uint32_t y = 0; y < scale; y++) {
-			for(uint32_t x = 0; x < hdScreenWidth; x++) {
-				uint32_t &rgbValue = out[x];
-				uint8_t average = (((rgbValue >> 16) & 0xFF) + ((rgbValue >> 8) & 0xFF) + (rgbValue & 0xFF)) / 3;
-				rgbValue = (rgbValue & 0xFF000000) | (average << 16) | (average << 8) | average;
+	//Queue the bitmaps used by the tiles in the currently mapped CHR pages (and their neighbors, which
+	//are likely to be mapped next) to be decoded on the loader's thread before they are needed
+	for(int i = 0; i < 8; i++) {
+		int32_t page = _hdScreenInfo->ChrPages[i];
+		if(page == _prefetchedChrPages[i]) {
+			continue;
+		}
+		_prefetchedChrPages[i] = page;
+		if(page < 0) {
+			continue;
+		}
+
+		for(int32_t j = std::max(page - 1, 0); j <= page + 1; j++) {
+			auto result = _hdData->BitmapsByChrPage.find((uint32_t)j);
+			if(result != _hdData->BitmapsByChrPage.end()) {
+				for(HdPackBitmapInfo* bitmap : result->second) {
+					if(!bitmap->IsLoaded()) {
+						bitmap->LastUsedFrame = _hdScreenInfo->FrameNumber;
+						_hdData->RequestPrefetch(bitmap);
+					}
+				}
 			}
-			out += hdScreenWidth;
 		}
 	}
+}
 
-	if(pixelInfo.EmphasisBits) {
-		uint8_t emphasisBits = pixelInfo.EmphasisBits;
-		double red = 1.0, green = 1.0, blue = 1.0;
-		if(emphasisBits & 0x01) {
-			//Intensify red
-			red *= 1.1;
-			green *= 0.9;
-			blue *= 0.9;
-		}
-		if(emphasisBits & 0x02) {
-			//Intensify green
-			green *= 1.1;
-			red *= 0.9;
-			blue *= 0.9;
+template<uint32_t scale>
+void HdNesPack<scale>::EvictTextures()
+{
+	uint32_t frame = _hdScreenInfo->FrameNumber;
+	if(frame - _lastEvictionFrame < HdNesPack::EvictionCheckInterval) {
+		return;
+	}
+	_lastEvictionFrame = frame;
+
+	if(_hdData->TextureStats.ResidentBytes <= (int64_t)_hdData->TextureBudget) {
+		return;
+	}
+
+	//Evict the least recently used bitmaps and tiles that have been idle long enough, until the budget is respected.
+	//Nothing is rendering at this point, so the tiles' data can be freed safely.
+	struct EvictionCandidate
+	{
+		uint32_t LastUsedFrame;
+		HdPackBitmapInfo* Bitmap;
+		HdPackTileInfo* Tile;
+	};
+
+	vector<EvictionCandidate> candidates;
+	auto addBitmaps = [&](vector<unique_ptr<HdPackBitmapInfo>>& bitmaps) {
+		for(unique_ptr<HdPackBitmapInfo>& bitmap : bitmaps) {
+			if(bitmap->IsLoaded() && frame - bitmap->LastUsedFrame >= HdPackData::TextureMinIdleFrames) {
+				candidates.push_back({ bitmap->LastUsedFrame, bitmap.get(), nullptr });
+			}
 		}
-		if(emphasisBits & 0x04) {
-			//Intensify blue
-			blue *= 1.1;
-			red *= 0.9;
-			green *= 0.9;
+	};
+	addBitmaps(_hdData->BackgroundFileData);
+	addBitmaps(_hdData->ImageFileData);
+
+	for(unique_ptr<HdPackTileInfo>& tile : _hdData->Tiles) {
+		uint32_t lastUsedFrame = tile->LastUsedFrame;
+		if(!tile->NeedInit() && frame - lastUsedFrame >= HdPackData::TextureMinIdleFrames) {
+			candidates.push_back({ lastUsedFrame, nullptr, tile.get() });
 		}
+	}
 
-		uint32_t* out = outputBuffer;
-		for(uint32_t y = 0; y < scale; y++) {
-			for(uint32_t x = 0; x < hdScreenWidth; x++) {
-				uint32_t &rgbValue = out[x];
+	std::sort(candidates.begin(), candidates.end(), [](const EvictionCandidate& a, const EvictionCandidate& b) {
+		return (int32_t)(a.LastUsedFrame - b.LastUsedFrame) < 0;
+	});
 
-				rgbValue = 0xFF000000 |
-					(std::min<uint16_t>((uint16_t)(((rgbValue >> 16) & 0xFF) * red), 255) << 16) |
-					(std::min<uint16_t>((uint16_t)(((rgbValue >> 8) & 0xFF) * green), 255) << 8) |
-					std::min<uint16_t>((uint16_t)((rgbValue & 0xFF) * blue), 255);
-			}
-			out += hdScreenWidth;
+	for(EvictionCandidate& candidate : candidates) {
+		if(_hdData->TextureStats.ResidentBytes <= (int64_t)_hdData->TextureBudget) {
+			break;
+		}
+
+		if(candidate.Bitmap) {
+			candidate.Bitmap->Unload();
+		} else {
+			candidate.Tile->Unload();
 		}
 	}
 }
 
+template<uint32_t scale>
+void HdNesPack<scale>::Process(HdScreenInfo *hdScreenInfo, uint32_t* outputBuffer, OverscanDimensions &overscan)
+{
+	_hdScreenInfo = hdScreenInfo;
+	uint32_t screenWidth = (NesConstants::ScreenWidth - overscan.Left - overscan.Right) * scale;
+	uint32_t firstLine = overscan.Top;
+	uint32_t lastLine = NesConstants::ScreenHeight - overscan.Bottom;
+
+	if(_hdData->TextureBudget > 0) {
+		PrefetchBitmaps();
+		EvictTextures();
+	}
+
+	OnBeforeApplyFilter();
+
+	if(CanRenderInParallel() && lastLine > firstLine) {
+		PrepareParallelRendering();
+
+		//Each band keeps its own scroll/tile cache state, which is reset at the start of every scanline,
+		//so splitting on scanline boundaries produces the same output as rendering the whole frame at once
+		uint32_t lineCount = lastLine - firstLine;
+		uint32_t bandCount = std::min(lineCount, (_renderPool->GetWorkerCount() + 1) * HdNesPack::BandsPerThread);
+		_renderPool->Run(bandCount, [=, &overscan](uint32_t band) {
+			uint32_t bandStart = firstLine + lineCount * band / bandCount;
+			uint32_t bandEnd = firstLine + lineCount * (band + 1) / bandCount;
+			RenderLines(bandStart, bandEnd, outputBuffer, overscan, screenWidth);
+		});
+	} else {
+		RenderLines(firstLine, lastLine, outputBuffer, overscan, screenWidth);
+	}
+}
+
+template<uint32_t scale>
+void HdNesPack<scale>::ProcessGrayscaleAndEmphasis(HdPpuPixelInfo &pixelInfo, uint32_t* outputBuffer, uint32_t hdScreenWidth)
+{
+	//Apply grayscale/emphasis bits on a scanline level (less accurate, but shouldn't cause issues and simpler to implement)
+	//The scanline's rows are contiguous in the output buffer, so they can be processed in a single pass
+	if(pixelInfo.Grayscale) {
+		HdPackBlending::GrayscaleRow(outputBuffer, scale * hdScreenWidth);
+	}
+
+	if(pixelInfo.EmphasisBits) {
+		HdPackBlending::EmphasisRow(outputBuffer, scale * hdScreenWidth, _emphasisLut[pixelInfo.EmphasisBits & 0x07]);
+	}
+}
+
 template HdNesPack<1>::HdNesPack(NesConsole* console, EmuSettings* settings, HdPackData* hdData);
 template HdNesPack<2>::HdNesPack(NesConsole* console, EmuSettings* settings, HdPackData* hdData);
 template HdNesPack<3>::HdNesPack(NesConsole* console, EmuSettings* settings, HdPackData* hdData);
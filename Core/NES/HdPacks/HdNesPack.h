@@ -1,9 +1,11 @@
 #pragma once
 #include "pch.h"
 #include "NES/HdPacks/HdData.h"
+#include "Utilities/SimpleLock.h"
 
 class NesConsole;
 class EmuSettings;
+class ThreadPool;
 
 class BaseHdNesPack
 {
@@ -46,6 +48,33 @@ private:
 		int16_t BgMaxX = -1;
 	};
 
+	//Result of a GetMatchingTile call, reused for the rest of the frame when the
+	//candidate tiles' conditions give the same result for every pixel
+	struct HdTileMemoEntry
+	{
+		HdTileKey Key;
+		HdPackTileInfo* Tile = nullptr;
+		int32_t TileIndex = 0;
+		bool DisableCache = false;
+		bool Valid = false;
+	};
+
+	static constexpr uint32_t TileMemoSize = 256;
+
+	//State that is updated while rendering a scanline - each band of scanlines has its own copy
+	struct HdLineState
+	{
+		HdBgConfig BgConfig[40] = {};
+		HdTileMemoEntry TileMemo[TileMemoSize] = {};
+		HdPackTileInfo* CachedTile = nullptr;
+		bool UseCachedTile = false;
+		int32_t ScrollX = 0;
+		uint32_t TextureHits = 0;
+	};
+
+	static constexpr uint32_t BandsPerThread = 2;
+	static constexpr uint32_t EvictionCheckInterval = 30;
+
 	static constexpr uint8_t PriorityLevelsPerLayer = 10;
 	static constexpr uint8_t BehindBgSpritesPriority = 0 * PriorityLevelsPerLayer;
 	static constexpr uint8_t BehindBgPriority = 1 * PriorityLevelsPerLayer;
@@ -60,29 +89,32 @@ private:
 	HdBgConfig _bgConfig[40] = {};
 
 	uint32_t _palette[512] = {};
-	HdPackTileInfo* _cachedTile = nullptr;
+	uint8_t _emphasisLut[8][3][256] = {};
 	bool _cacheEnabled = false;
-	bool _useCachedTile = false;
-	int32_t _scrollX = 0;
+
+	HdPackFrameConditions _frameConditions;
+	int32_t _prefetchedChrPages[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+	uint32_t _lastEvictionFrame = 0;
+	shared_ptr<ThreadPool> _renderPool;
+	SimpleLock _tileInitLock;
 	
 	unordered_map<HdTileKey, vector<HdPackAdditionalSpriteInfo>> _additionalTilesByKey;
 
-	template<HdPackBlendMode blendMode>
-	__forceinline void BlendColors(uint8_t output[4], uint8_t input[4]);
-
-	__forceinline uint32_t AdjustBrightness(uint8_t input[4], int brightness);
 	__forceinline void DrawColor(uint32_t color, uint32_t* outputBuffer, uint32_t screenWidth);
+	__forceinline void DrawColorSpan(uint32_t color, uint32_t* outputBuffer, uint32_t screenWidth, uint32_t pixelCount);
 	__forceinline void DrawTile(HdPpuTileInfo &tileInfo, HdPackTileInfo &hdPackTileInfo, uint32_t* outputBuffer, uint32_t screenWidth);
+	__forceinline void DrawTileSpan(HdPpuTileInfo &tileInfo, HdPackTileInfo &hdPackTileInfo, uint32_t* outputBuffer, uint32_t screenWidth, uint32_t pixelCount);
 	
-	__forceinline HdPackTileInfo* GetCachedMatchingTile(uint32_t x, uint32_t y, HdPpuTileInfo* tile);
-	__forceinline HdPackTileInfo* GetMatchingTile(uint32_t x, uint32_t y, HdPpuTileInfo* tile, bool* disableCache = nullptr);
+	__forceinline HdPackTileInfo* GetCachedMatchingTile(HdLineState& state, uint32_t x, uint32_t y, HdPpuTileInfo* tile);
+	__forceinline HdPackTileInfo* GetMatchingTile(HdLineState& state, uint32_t x, uint32_t y, HdPpuTileInfo* tile, bool* disableCache = nullptr);
+	__noinline void InitTile(HdPackTileInfo* hdPackTile);
 
-	__forceinline void DrawBackgroundLayer(uint8_t priority, uint32_t x, uint32_t y, uint32_t* outputBuffer, uint32_t screenWidth);
+	__forceinline void DrawBackgroundLayer(HdLineState& state, uint8_t priority, uint32_t x, uint32_t y, uint32_t* outputBuffer, uint32_t screenWidth, uint32_t pixelCount = 1);
 
 	template<HdPackBlendMode blendMode>
-	__forceinline void DrawCustomBackground(HdBackgroundInfo& bgInfo, uint32_t *outputBuffer, uint32_t x, uint32_t y, uint32_t screenWidth);
+	__forceinline void DrawCustomBackground(HdBackgroundInfo& bgInfo, uint32_t *outputBuffer, uint32_t x, uint32_t y, uint32_t screenWidth, uint32_t pixelCount);
 
-	void OnLineStart(HdPpuPixelInfo &lineFirstPixel, uint8_t y);
+	void OnLineStart(HdLineState& state, HdPpuPixelInfo &lineFirstPixel, uint8_t y);
 	int32_t GetLayerIndex(uint8_t priority);
 	void OnBeforeApplyFilter();
 
@@ -91,11 +123,23 @@ private:
 	void BuildAdditionalTileCache(int32_t x, int32_t y, HdPpuTileInfo& tile, bool checkFallbackTiles);
 	void InsertAdditionalSprite(int32_t x, int32_t y, HdPpuTileInfo& sprite, HdPackAdditionalSpriteInfo& additionalSprite);
 
-	__forceinline void GetPixels(uint32_t x, uint32_t y, HdPpuPixelInfo &pixelInfo, uint32_t *outputBuffer, uint32_t screenWidth);
+	void PrefetchBitmaps();
+	void EvictTextures();
+
+	bool CanRenderInParallel();
+	void PrepareParallelRendering();
+	void RenderLines(uint32_t firstLine, uint32_t lastLine, uint32_t* outputBuffer, OverscanDimensions& overscan, uint32_t screenWidth);
+
+	__forceinline uint32_t DrawPixels(HdLineState& state, uint32_t x, uint32_t xMax, uint32_t y, HdPpuPixelInfo* pixels, uint32_t* outputBuffer, uint32_t screenWidth);
+	__forceinline uint32_t GetSpanLength(HdLineState& state, uint32_t x, uint32_t xMax, HdPpuPixelInfo* pixels);
+	__forceinline void DrawSpan(HdLineState& state, uint32_t x, uint32_t y, HdPpuPixelInfo* pixels, HdPackTileInfo* hdPackTileInfo, uint32_t* outputBuffer, uint32_t screenWidth, uint32_t pixelCount);
+	__forceinline void GetPixels(HdLineState& state, uint32_t x, uint32_t y, HdPpuPixelInfo &pixelInfo, uint32_t *outputBuffer, uint32_t screenWidth);
+	__forceinline void DrawPixel(HdLineState& state, uint32_t x, uint32_t y, HdPpuPixelInfo &pixelInfo, HdPackTileInfo* hdPackTileInfo, uint32_t *outputBuffer, uint32_t screenWidth);
 	__forceinline void ProcessGrayscaleAndEmphasis(HdPpuPixelInfo &pixelInfo, uint32_t* outputBuffer, uint32_t hdScreenWidth);
 	
 	void CleanupInvalidRules();
 	void InitializeFallbackTiles();
+	void InitializeEmphasisLut();
 
 public:
 	HdNesPack(NesConsole* console, EmuSettings* settings, HdPackData* hdData);
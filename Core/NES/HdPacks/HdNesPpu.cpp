@@ -27,16 +27,26 @@ void* HdNesPpu::OnBeforeSendFrame()
 {
 	HdScreenInfo* info = _info;
 	info->FrameNumber = _frameCount;
-	info->WatchedAddressValues.clear();
-	for(uint32_t address : _hdData->WatchedMemoryAddresses) {
+	vector<uint32_t>& addresses = _hdData->WatchedMemoryAddresses;
+	info->WatchedAddressValues.resize(addresses.size());
+	for(size_t i = 0; i < addresses.size(); i++) {
+		uint32_t address = addresses[i];
 		if(address & HdPackBaseMemoryCondition::PpuMemoryMarker) {
 			if((address & 0x3FFF) >= 0x3F00) {
-				info->WatchedAddressValues[address] = ReadPaletteRam(address);
+				info->WatchedAddressValues[i] = ReadPaletteRam(address);
 			} else {
-				info->WatchedAddressValues[address] = _console->GetMapper()->DebugReadVram(address & 0x3FFF, true);
+				info->WatchedAddressValues[i] = _console->GetMapper()->DebugReadVram(address & 0x3FFF, true);
 			}
 		} else {
-			info->WatchedAddressValues[address] = _console->GetMemoryManager()->DebugRead(address);
+			info->WatchedAddressValues[i] = _console->GetMemoryManager()->DebugRead(address);
+		}
+	}
+
+	if(_hdData->TextureBudget > 0 && !_isChrRam) {
+		BaseMapper* mapper = _console->GetMapper();
+		for(int i = 0; i < 8; i++) {
+			AddressInfo addr = mapper->GetPpuAbsoluteAddress((uint32_t)(i * 0x400));
+			info->ChrPages[i] = addr.Type == MemoryType::NesChrRom && addr.Address >= 0 ? addr.Address / 0x400 : -1;
 		}
 	}
 
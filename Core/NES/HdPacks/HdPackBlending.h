@@ -0,0 +1,210 @@
+#pragma once
+#include "pch.h"
+#include "NES/HdPacks/HdData.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define HDPACK_BLEND_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	#include <arm_neon.h>
+	#define HDPACK_BLEND_NEON
+#endif
+
+//Blending/color functions used to composite HD tiles and backgrounds (all colors are premultiplied ARGB)
+//The row functions process 4 pixels at a time when SSE2/NEON are available and use the scalar
+//versions for the remaining pixels - both must produce exactly the same output.
+class HdPackBlending
+{
+public:
+	template<HdPackBlendMode blendMode>
+	static __forceinline void BlendColors(uint8_t output[4], uint8_t input[4])
+	{
+		if constexpr(blendMode == HdPackBlendMode::Alpha) {
+			uint8_t invertedAlpha = 256 - input[3];
+			output[0] = input[0] + (uint8_t)((invertedAlpha * output[0]) >> 8);
+			output[1] = input[1] + (uint8_t)((invertedAlpha * output[1]) >> 8);
+			output[2] = input[2] + (uint8_t)((invertedAlpha * output[2]) >> 8);
+			output[3] = 0xFF;
+		} else if constexpr(blendMode == HdPackBlendMode::Add) {
+			output[0] = (uint8_t)std::min(255, (int)input[0] + (int)output[0]);
+			output[1] = (uint8_t)std::min(255, (int)input[1] + (int)output[1]);
+			output[2] = (uint8_t)std::min(255, (int)input[2] + (int)output[2]);
+			output[3] = 0xFF;
+		} else if constexpr(blendMode == HdPackBlendMode::Subtract) {
+			output[0] = (uint8_t)std::max(0, (int)output[0] - (int)input[0]);
+			output[1] = (uint8_t)std::max(0, (int)output[1] - (int)input[1]);
+			output[2] = (uint8_t)std::max(0, (int)output[2] - (int)input[2]);
+			output[3] = 0xFF;
+		}
+	}
+
+	static __forceinline uint32_t AdjustBrightness(uint8_t input[4], int brightness)
+	{
+		return (
+			std::min(255, (brightness * ((int)input[0] + 1)) >> 8) |
+			(std::min(255, (brightness * ((int)input[1] + 1)) >> 8) << 8) |
+			(std::min(255, (brightness * ((int)input[2] + 1)) >> 8) << 16) |
+			(input[3] << 24)
+		);
+	}
+
+	//Blends a row of pixels on top of the output
+	//In alpha mode, fully transparent pixels leave the output untouched
+	template<HdPackBlendMode blendMode>
+	static __forceinline void BlendRow(uint32_t* output, const uint32_t* input, uint32_t count)
+	{
+		uint32_t i = 0;
+#if defined(HDPACK_BLEND_SSE2)
+		const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+		for(; i + 4 <= count; i += 4) {
+			__m128i src = _mm_loadu_si128((const __m128i*)(input + i));
+			__m128i dst = _mm_loadu_si128((const __m128i*)(output + i));
+			__m128i result;
+			if constexpr(blendMode == HdPackBlendMode::Alpha) {
+				const __m128i zero = _mm_setzero_si128();
+				__m128i alpha = _mm_srli_epi32(src, 24);
+
+				//Inverted alpha is truncated to 8 bits, like the scalar version
+				__m128i invAlpha = _mm_and_si128(_mm_sub_epi32(_mm_set1_epi32(256), alpha), _mm_set1_epi32(0xFF));
+				invAlpha = _mm_or_si128(invAlpha, _mm_slli_epi32(invAlpha, 16));
+				__m128i invLo = _mm_unpacklo_epi32(invAlpha, invAlpha);
+				__m128i invHi = _mm_unpackhi_epi32(invAlpha, invAlpha);
+
+				__m128i dstLo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), invLo), 8);
+				__m128i dstHi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), invHi), 8);
+				result = _mm_or_si128(_mm_add_epi8(src, _mm_packus_epi16(dstLo, dstHi)), alphaMask);
+
+				__m128i transparent = _mm_cmpeq_epi32(alpha, zero);
+				result = _mm_or_si128(_mm_and_si128(transparent, dst), _mm_andnot_si128(transparent, result));
+			} else if constexpr(blendMode == HdPackBlendMode::Add) {
+				result = _mm_or_si128(_mm_adds_epu8(dst, src), alphaMask);
+			} else {
+				result = _mm_or_si128(_mm_subs_epu8(dst, src), alphaMask);
+			}
+			_mm_storeu_si128((__m128i*)(output + i), result);
+		}
+#elif defined(HDPACK_BLEND_NEON)
+		const uint32x4_t alphaMask = vdupq_n_u32(0xFF000000);
+		for(; i + 4 <= count; i += 4) {
+			uint32x4_t src = vld1q_u32(input + i);
+			uint32x4_t dst = vld1q_u32(output + i);
+			uint32x4_t result;
+			if constexpr(blendMode == HdPackBlendMode::Alpha) {
+				uint32x4_t alpha = vshrq_n_u32(src, 24);
+				uint32x4_t invAlpha = vandq_u32(vsubq_u32(vdupq_n_u32(256), alpha), vdupq_n_u32(0xFF));
+				uint8x16_t invAlpha8 = vreinterpretq_u8_u32(vmulq_u32(invAlpha, vdupq_n_u32(0x01010101)));
+
+				uint8x16_t dst8 = vreinterpretq_u8_u32(dst);
+				uint16x8_t dstLo = vmull_u8(vget_low_u8(dst8), vget_low_u8(invAlpha8));
+				uint16x8_t dstHi = vmull_u8(vget_high_u8(dst8), vget_high_u8(invAlpha8));
+				uint8x16_t scaled = vcombine_u8(vshrn_n_u16(dstLo, 8), vshrn_n_u16(dstHi, 8));
+				result = vorrq_u32(vreinterpretq_u32_u8(vaddq_u8(vreinterpretq_u8_u32(src), scaled)), alphaMask);
+				result = vbslq_u32(vceqq_u32(alpha, vdupq_n_u32(0)), dst, result);
+			} else if constexpr(blendMode == HdPackBlendMode::Add) {
+				result = vorrq_u32(vreinterpretq_u32_u8(vqaddq_u8(vreinterpretq_u8_u32(dst), vreinterpretq_u8_u32(src))), alphaMask);
+			} else {
+				result = vorrq_u32(vreinterpretq_u32_u8(vqsubq_u8(vreinterpretq_u8_u32(dst), vreinterpretq_u8_u32(src))), alphaMask);
+			}
+			vst1q_u32(output + i, result);
+		}
+#endif
+
+		for(; i < count; i++) {
+			uint32_t pixelColor = input[i];
+			if constexpr(blendMode == HdPackBlendMode::Alpha) {
+				if(pixelColor >= 0xFF000000) {
+					output[i] = pixelColor;
+				} else if(pixelColor >= 0x01000000) {
+					BlendColors<blendMode>((uint8_t*)(output + i), (uint8_t*)&pixelColor);
+				}
+			} else {
+				BlendColors<blendMode>((uint8_t*)(output + i), (uint8_t*)&pixelColor);
+			}
+		}
+	}
+
+	//Output and input can point to the same buffer
+	static __forceinline void AdjustBrightnessRow(uint32_t* output, const uint32_t* input, uint32_t count, int brightness)
+	{
+		uint32_t i = 0;
+		if(brightness >= 0 && brightness <= 255) {
+			//(brightness * (color + 1)) fits in 16 bits and never exceeds 255 once shifted in this range
+#if defined(HDPACK_BLEND_SSE2)
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i one = _mm_set1_epi16(1);
+			const __m128i factor = _mm_set1_epi16((int16_t)brightness);
+			const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+			for(; i + 4 <= count; i += 4) {
+				__m128i src = _mm_loadu_si128((const __m128i*)(input + i));
+				__m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_add_epi16(_mm_unpacklo_epi8(src, zero), one), factor), 8);
+				__m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_add_epi16(_mm_unpackhi_epi8(src, zero), one), factor), 8);
+				__m128i result = _mm_or_si128(_mm_andnot_si128(alphaMask, _mm_packus_epi16(lo, hi)), _mm_and_si128(alphaMask, src));
+				_mm_storeu_si128((__m128i*)(output + i), result);
+			}
+#elif defined(HDPACK_BLEND_NEON)
+			const uint8x8_t factor = vdup_n_u8((uint8_t)brightness);
+			const uint16x8_t bias = vdupq_n_u16((uint16_t)brightness);
+			const uint32x4_t alphaMask = vdupq_n_u32(0xFF000000);
+			for(; i + 4 <= count; i += 4) {
+				uint32x4_t src = vld1q_u32(input + i);
+				uint8x16_t src8 = vreinterpretq_u8_u32(src);
+				uint16x8_t lo = vmlal_u8(bias, vget_low_u8(src8), factor);
+				uint16x8_t hi = vmlal_u8(bias, vget_high_u8(src8), factor);
+				uint32x4_t result = vreinterpretq_u32_u8(vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+				vst1q_u32(output + i, vbslq_u32(alphaMask, src, result));
+			}
+#endif
+		}
+
+		for(; i < count; i++) {
+			uint32_t pixelColor = input[i];
+			output[i] = AdjustBrightness((uint8_t*)&pixelColor, brightness);
+		}
+	}
+
+	static __forceinline void GrayscaleRow(uint32_t* buffer, uint32_t count)
+	{
+		uint32_t i = 0;
+#if defined(HDPACK_BLEND_SSE2)
+		const __m128i byteMask = _mm_set1_epi32(0xFF);
+		const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+		//x / 3 == (x * 0xAAAB) >> 17 for every possible sum of 3 color channels
+		const __m128i divideBy3 = _mm_set1_epi32(0xAAAB);
+		for(; i + 4 <= count; i += 4) {
+			__m128i src = _mm_loadu_si128((const __m128i*)(buffer + i));
+			__m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(src, byteMask), _mm_and_si128(_mm_srli_epi32(src, 8), byteMask)), _mm_and_si128(_mm_srli_epi32(src, 16), byteMask));
+			__m128i average = _mm_srli_epi32(_mm_mulhi_epu16(sum, divideBy3), 1);
+			__m128i result = _mm_or_si128(_mm_or_si128(average, _mm_slli_epi32(average, 8)), _mm_slli_epi32(average, 16));
+			_mm_storeu_si128((__m128i*)(buffer + i), _mm_or_si128(result, _mm_and_si128(src, alphaMask)));
+		}
+#elif defined(HDPACK_BLEND_NEON)
+		const uint32x4_t byteMask = vdupq_n_u32(0xFF);
+		const uint32x4_t alphaMask = vdupq_n_u32(0xFF000000);
+		for(; i + 4 <= count; i += 4) {
+			uint32x4_t src = vld1q_u32(buffer + i);
+			uint32x4_t sum = vaddq_u32(vaddq_u32(vandq_u32(src, byteMask), vandq_u32(vshrq_n_u32(src, 8), byteMask)), vandq_u32(vshrq_n_u32(src, 16), byteMask));
+			uint32x4_t average = vshrq_n_u32(vmulq_u32(sum, vdupq_n_u32(0xAAAB)), 17);
+			uint32x4_t result = vmulq_u32(average, vdupq_n_u32(0x010101));
+			vst1q_u32(buffer + i, vorrq_u32(result, vandq_u32(src, alphaMask)));
+		}
+#endif
+
+		for(; i < count; i++) {
+			uint32_t& rgbValue = buffer[i];
+			uint8_t average = (((rgbValue >> 16) & 0xFF) + ((rgbValue >> 8) & 0xFF) + (rgbValue & 0xFF)) / 3;
+			rgbValue = (rgbValue & 0xFF000000) | (average << 16) | (average << 8) | average;
+		}
+	}
+
+	//Lookup tables contain the already clamped result for each channel's value (blue, green, red)
+	static __forceinline void EmphasisRow(uint32_t* buffer, uint32_t count, const uint8_t lut[3][256])
+	{
+		for(uint32_t i = 0; i < count; i++) {
+			uint32_t rgbValue = buffer[i];
+			buffer[i] = 0xFF000000 |
+				(lut[2][(rgbValue >> 16) & 0xFF] << 16) |
+				(lut[1][(rgbValue >> 8) & 0xFF] << 8) |
+				lut[0][rgbValue & 0xFF];
+		}
+	}
+};
@@ -0,0 +1,592 @@
+#include "pch.h"
+#include <unordered_map>
+#include "NES/HdPacks/HdPackCache.h"
+#include "NES/HdPacks/HdPackConditions.h"
+#include "Shared/MessageManager.h"
+#include "Utilities/FolderUtilities.h"
+#include "Utilities/PNGHelper.h"
+#include "Utilities/CompressionHelper.h"
+
+class HdPackCacheReader
+{
+private:
+	vector<uint8_t>& _data;
+	size_t _pos = 0;
+	bool _error = false;
+
+public:
+	HdPackCacheReader(vector<uint8_t>& data) : _data(data) { }
+
+	bool HasError() { return _error; }
+	bool IsEnd() { return _pos >= _data.size(); }
+
+	bool ReadArray(void* dst, size_t size)
+	{
+		if(_error || size > _data.size() - _pos) {
+			_error = true;
+			return false;
+		}
+		memcpy(dst, _data.data() + _pos, size);
+		_pos += size;
+		return true;
+	}
+
+	template<typename T>
+	T Read()
+	{
+		T value = {};
+		ReadArray(&value, sizeof(T));
+		return value;
+	}
+
+	template<typename T>
+	bool ReadVector(vector<T>& out, uint32_t count)
+	{
+		if(_error || (uint64_t)count * sizeof(T) > _data.size() - _pos) {
+			_error = true;
+			return false;
+		}
+		out.resize(count);
+		return ReadArray(out.data(), count * sizeof(T));
+	}
+
+	string ReadString()
+	{
+		uint32_t length = Read<uint32_t>();
+		if(_error || length > _data.size() - _pos) {
+			_error = true;
+			return "";
+		}
+		string value((char*)_data.data() + _pos, length);
+		_pos += length;
+		return value;
+	}
+};
+
+class HdPackCacheWriter
+{
+private:
+	ofstream& _stream;
+
+public:
+	HdPackCacheWriter(ofstream& stream) : _stream(stream) { }
+
+	void WriteArray(const void* src, size_t size)
+	{
+		_stream.write((const char*)src, size);
+	}
+
+	template<typename T>
+	void Write(T value)
+	{
+		WriteArray(&value, sizeof(T));
+	}
+
+	void WriteString(const string& value)
+	{
+		Write((uint32_t)value.size());
+		WriteArray(value.data(), value.size());
+	}
+};
+
+string HdPackCache::GetCachePath(string hdPackFolder, bool loadFromZip)
+{
+	if(loadFromZip) {
+		//The cache can't be stored inside the archive, put it next to it instead
+		return FolderUtilities::CombinePath(FolderUtilities::GetFolderName(hdPackFolder), FolderUtilities::GetFilename(hdPackFolder, false) + ".mcache");
+	} else {
+		return FolderUtilities::CombinePath(hdPackFolder, "hires.mcache");
+	}
+}
+
+unique_ptr<HdPackCondition> HdPackCache::CreateCondition(HdPackConditionType type, uint8_t paletteOffset)
+{
+	switch(type) {
+		case HdPackConditionType::HMirror: return unique_ptr<HdPackCondition>(new HdPackHorizontalMirroringCondition());
+		case HdPackConditionType::VMirror: return unique_ptr<HdPackCondition>(new HdPackVerticalMirroringCondition());
+		case HdPackConditionType::BgPriority: return unique_ptr<HdPackCondition>(new HdPackBgPriorityCondition());
+		case HdPackConditionType::FrameRange: return unique_ptr<HdPackCondition>(new HdPackFrameRangeCondition());
+		case HdPackConditionType::MemoryCheck: return unique_ptr<HdPackCondition>(new HdPackMemoryCheckCondition());
+		case HdPackConditionType::MemoryCheckConstant: return unique_ptr<HdPackCondition>(new HdPackMemoryCheckConstantCondition());
+		case HdPackConditionType::TileNearby: return unique_ptr<HdPackCondition>(new HdPackTileNearbyCondition());
+		case HdPackConditionType::TileAtPos: return unique_ptr<HdPackCondition>(new HdPackTileAtPositionCondition());
+		case HdPackConditionType::SpriteAtPos: return unique_ptr<HdPackCondition>(new HdPackSpriteAtPositionCondition());
+		case HdPackConditionType::SpriteNearby: return unique_ptr<HdPackCondition>(new HdPackSpriteNearbyCondition());
+		case HdPackConditionType::PositionCheckX: return unique_ptr<HdPackCondition>(new HdPackPositionCheckXCondition());
+		case HdPackConditionType::PositionCheckY: return unique_ptr<HdPackCondition>(new HdPackPositionCheckYCondition());
+		case HdPackConditionType::OriginPositionCheckX: return unique_ptr<HdPackCondition>(new HdPackOriginPositionCheckXCondition());
+		case HdPackConditionType::OriginPositionCheckY: return unique_ptr<HdPackCondition>(new HdPackOriginPositionCheckYCondition());
+
+		case HdPackConditionType::SpritePalette:
+			switch(paletteOffset) {
+				case 0x10: return unique_ptr<HdPackCondition>(new HdPackSpritePaletteCondition<0>());
+				case 0x14: return unique_ptr<HdPackCondition>(new HdPackSpritePaletteCondition<1>());
+				case 0x18: return unique_ptr<HdPackCondition>(new HdPackSpritePaletteCondition<2>());
+				case 0x1C: return unique_ptr<HdPackCondition>(new HdPackSpritePaletteCondition<3>());
+			}
+			break;
+	}
+	return nullptr;
+}
+
+bool HdPackCache::Load(HdPackData& data, std::function<bool(string, vector<uint8_t>&)> loadFile, std::function<bool(string, uint64_t&, int64_t&)> getFileInfo)
+{
+	vector<uint8_t> cacheData;
+	ifstream file(data.CachePath, ios::in | ios::binary);
+	if(!file.good()) {
+		return false;
+	}
+
+	file.seekg(0, ios::end);
+	size_t fileSize = (size_t)file.tellg();
+	file.seekg(0, ios::beg);
+	cacheData.resize(fileSize);
+	file.read((char*)cacheData.data(), fileSize);
+	file.close();
+
+	HdPackCacheReader reader(cacheData);
+	char header[4] = {};
+	reader.ReadArray(header, sizeof(header));
+	if(memcmp(header, "MHDC", 4) != 0 || reader.Read<uint32_t>() != HdPackCache::FileVersion || reader.ReadString() != data.DefinitionHash) {
+		return false;
+	}
+
+	//The PNG files are still needed (backgrounds, evicted tiles) - the cache is only valid if none of them changed
+	auto readBitmaps = [&](vector<unique_ptr<HdPackBitmapInfo>>& bitmaps) {
+		uint32_t count = reader.Read<uint32_t>();
+		for(uint32_t i = 0; i < count && !reader.HasError(); i++) {
+			unique_ptr<HdPackBitmapInfo> bitmap(new HdPackBitmapInfo());
+			bitmap->PngName = reader.ReadString();
+			bitmap->FileSize = reader.Read<uint64_t>();
+			bitmap->FileTime = reader.Read<int64_t>();
+
+			uint64_t fileSize = 0;
+			int64_t fileTime = 0;
+			if(reader.HasError() || !getFileInfo(bitmap->PngName, fileSize, fileTime) || fileSize != bitmap->FileSize || fileTime != bitmap->FileTime) {
+				return false;
+			}
+			if(!loadFile(bitmap->PngName, bitmap->FileData)) {
+				return false;
+			}
+			bitmaps.push_back(std::move(bitmap));
+		}
+		return !reader.HasError();
+	};
+
+	vector<unique_ptr<HdPackBitmapInfo>> images;
+	vector<unique_ptr<HdPackBitmapInfo>> backgroundFiles;
+	if(!readBitmaps(images) || !readBitmaps(backgroundFiles)) {
+		return false;
+	}
+
+	vector<uint32_t> watchedAddresses;
+	reader.ReadVector(watchedAddresses, reader.Read<uint32_t>());
+
+	vector<unique_ptr<HdPackCondition>> conditions;
+	uint32_t conditionCount = reader.Read<uint32_t>();
+	for(uint32_t i = 0; i < conditionCount && !reader.HasError(); i++) {
+		HdPackConditionType type = (HdPackConditionType)reader.Read<uint8_t>();
+		string name = reader.ReadString();
+		uint8_t paletteOffset = type == HdPackConditionType::SpritePalette ? reader.Read<uint8_t>() : 0;
+
+		unique_ptr<HdPackCondition> condition = CreateCondition(type, paletteOffset);
+		if(!condition || name.empty()) {
+			return false;
+		}
+		condition->Name = name;
+
+		switch(type) {
+			case HdPackConditionType::TileNearby:
+			case HdPackConditionType::TileAtPos:
+			case HdPackConditionType::SpriteNearby:
+			case HdPackConditionType::SpriteAtPos: {
+				HdPackBaseTileCondition* cond = (HdPackBaseTileCondition*)condition.get();
+				cond->TileX = reader.Read<int32_t>();
+				cond->TileY = reader.Read<int32_t>();
+				cond->PixelOffset = reader.Read<int32_t>();
+				cond->PaletteColors = reader.Read<uint32_t>();
+				reader.ReadArray(cond->TileData, sizeof(cond->TileData));
+				cond->TileIndex = reader.Read<int32_t>();
+				cond->IgnorePalette = reader.Read<uint8_t>() != 0;
+				break;
+			}
+
+			case HdPackConditionType::MemoryCheck:
+			case HdPackConditionType::MemoryCheckConstant: {
+				HdPackBaseMemoryCondition* cond = (HdPackBaseMemoryCondition*)condition.get();
+				cond->OperandA = reader.Read<uint32_t>();
+				cond->Operator = (HdPackConditionOperator)reader.Read<int32_t>();
+				cond->OperandB = reader.Read<uint32_t>();
+				cond->Mask = reader.Read<uint8_t>();
+				cond->SlotA = reader.Read<uint32_t>();
+				cond->SlotB = reader.Read<uint32_t>();
+				if(cond->SlotA >= watchedAddresses.size() || cond->SlotB >= watchedAddresses.size()) {
+					return false;
+				}
+				break;
+			}
+
+			case HdPackConditionType::FrameRange: {
+				HdPackFrameRangeCondition* cond = (HdPackFrameRangeCondition*)condition.get();
+				cond->OperandA = reader.Read<uint32_t>();
+				cond->OperandB = reader.Read<uint32_t>();
+				if(cond->OperandA == 0) {
+					return false;
+				}
+				break;
+			}
+
+			case HdPackConditionType::PositionCheckX:
+			case HdPackConditionType::PositionCheckY:
+			case HdPackConditionType::OriginPositionCheckX:
+			case HdPackConditionType::OriginPositionCheckY: {
+				HdPackConditionOperator op = (HdPackConditionOperator)reader.Read<int32_t>();
+				uint32_t operand = reader.Read<uint32_t>();
+				((HdPackBasePositionCheckCondition*)condition.get())->Initialize(op, operand);
+				break;
+			}
+
+			default:
+				break;
+		}
+
+		conditions.push_back(std::move(condition));
+	}
+
+	auto readConditionList = [&](vector<HdPackCondition*>& out) {
+		uint32_t count = reader.Read<uint32_t>();
+		for(uint32_t i = 0; i < count && !reader.HasError(); i++) {
+			uint32_t index = reader.Read<uint32_t>();
+			if(index >= conditions.size()) {
+				return false;
+			}
+			out.push_back(conditions[index].get());
+		}
+		return !reader.HasError();
+	};
+
+	vector<unique_ptr<HdPackTileInfo>> tiles;
+	uint32_t tileCount = reader.Read<uint32_t>();
+	for(uint32_t i = 0; i < tileCount && !reader.HasError(); i++) {
+		unique_ptr<HdPackTileInfo> tile(new HdPackTileInfo());
+		tile->PaletteColors = reader.Read<uint32_t>();
+		reader.ReadArray(tile->TileData, sizeof(tile->TileData));
+		tile->TileIndex = reader.Read<int32_t>();
+		tile->IsChrRamTile = reader.Read<uint8_t>() != 0;
+		tile->BitmapIndex = reader.Read<uint32_t>();
+		tile->X = reader.Read<uint32_t>();
+		tile->Y = reader.Read<uint32_t>();
+		tile->Width = reader.Read<uint32_t>();
+		tile->Height = reader.Read<uint32_t>();
+		tile->Brightness = reader.Read<int32_t>();
+		tile->DefaultTile = reader.Read<uint8_t>() != 0;
+		tile->ChrBankId = reader.Read<uint32_t>();
+		tile->ForceDisableCache = reader.Read<uint8_t>() != 0;
+		tile->HasFrameConstantConditions = reader.Read<uint8_t>() != 0;
+		tile->TransparencyRequired = false;
+		if(!readConditionList(tile->Conditions) || tile->BitmapIndex >= images.size() || tile->Width == 0 || tile->Height == 0) {
+			return false;
+		}
+		tile->Bitmap = images[tile->BitmapIndex].get();
+		tiles.push_back(std::move(tile));
+	}
+
+	vector<HdBackgroundInfo> backgrounds[HdPackData::BgLayerCount];
+	for(int priority = 0; priority < HdPackData::BgLayerCount; priority++) {
+		uint32_t count = reader.Read<uint32_t>();
+		for(uint32_t i = 0; i < count && !reader.HasError(); i++) {
+			HdBackgroundInfo bgInfo;
+			uint32_t fileIndex = reader.Read<uint32_t>();
+			if(fileIndex >= backgroundFiles.size()) {
+				return false;
+			}
+			bgInfo.Data = backgroundFiles[fileIndex].get();
+			bgInfo.Brightness = reader.Read<int32_t>();
+			bgInfo.HorizontalScrollRatio = reader.Read<float>();
+			bgInfo.VerticalScrollRatio = reader.Read<float>();
+			bgInfo.Priority = reader.Read<uint8_t>();
+			bgInfo.Left = reader.Read<uint32_t>();
+			bgInfo.Top = reader.Read<uint32_t>();
+			bgInfo.BlendMode = (HdPackBlendMode)reader.Read<uint32_t>();
+			if(!readConditionList(bgInfo.Conditions)) {
+				return false;
+			}
+			backgrounds[priority].push_back(bgInfo);
+		}
+	}
+
+	//Pixels of every tile, grouped by bitmap and compressed in chunks (the list of chunks ends with an empty chunk)
+	uint32_t pixelRecordCount = reader.Read<uint32_t>();
+	if(pixelRecordCount != tiles.size()) {
+		return false;
+	}
+
+	uint32_t recordsRead = 0;
+	vector<uint8_t> compressedChunk;
+	vector<uint8_t> chunk;
+	while(!reader.HasError()) {
+		uint32_t chunkSize = reader.Read<uint32_t>();
+		if(chunkSize == 0) {
+			break;
+		}
+
+		if(!reader.ReadVector(compressedChunk, chunkSize) || !CompressionHelper::Decompress(compressedChunk, chunk)) {
+			return false;
+		}
+
+		HdPackCacheReader chunkReader(chunk);
+		while(!chunkReader.IsEnd() && !chunkReader.HasError()) {
+			uint32_t tileIndex = chunkReader.Read<uint32_t>();
+			uint8_t flags = chunkReader.Read<uint8_t>();
+			if(tileIndex >= tiles.size() || !tiles[tileIndex]->NeedInit()) {
+				return false;
+			}
+
+			HdPackTileInfo* tile = tiles[tileIndex].get();
+			vector<uint32_t> tileData;
+			if(!chunkReader.ReadVector(tileData, tile->Width * tile->Height)) {
+				return false;
+			}
+			tile->SetPreloadedData(std::move(tileData), (flags & 0x01) != 0, (flags & 0x02) != 0, (flags & 0x04) != 0);
+			recordsRead++;
+		}
+
+		if(chunkReader.HasError()) {
+			return false;
+		}
+	}
+
+	if(recordsRead != pixelRecordCount) {
+		return false;
+	}
+
+	char footer[4] = {};
+	reader.ReadArray(footer, sizeof(footer));
+	if(reader.HasError() || memcmp(footer, "END!", 4) != 0) {
+		return false;
+	}
+
+	data.ImageFileData = std::move(images);
+	data.BackgroundFileData = std::move(backgroundFiles);
+	data.WatchedMemoryAddresses = std::move(watchedAddresses);
+	data.Conditions = std::move(conditions);
+	data.Tiles = std::move(tiles);
+	for(int priority = 0; priority < HdPackData::BgLayerCount; priority++) {
+		data.BackgroundsByPriority[priority] = std::move(backgrounds[priority]);
+	}
+	data.TilesPreloaded = true;
+	return true;
+}
+
+void HdPackCache::Save(HdPackData& data)
+{
+	if(data.CachePath.empty() || !data.CacheNeedsSave || data.IsLoadCancelled()) {
+		return;
+	}
+	data.CacheNeedsSave = false;
+
+	ofstream file(data.CachePath, ios::out | ios::binary);
+	if(!file.good()) {
+		MessageManager::Log("[HDPack] Could not create cache file: " + data.CachePath);
+		return;
+	}
+
+	HdPackCacheWriter writer(file);
+	writer.WriteArray("MHDC", 4);
+	writer.Write(HdPackCache::FileVersion);
+	writer.WriteString(data.DefinitionHash);
+
+	auto writeBitmaps = [&](vector<unique_ptr<HdPackBitmapInfo>>& bitmaps) {
+		writer.Write((uint32_t)bitmaps.size());
+		for(unique_ptr<HdPackBitmapInfo>& bitmap : bitmaps) {
+			writer.WriteString(bitmap->PngName);
+			writer.Write(bitmap->FileSize);
+			writer.Write(bitmap->FileTime);
+		}
+	};
+	writeBitmaps(data.ImageFileData);
+	writeBitmaps(data.BackgroundFileData);
+
+	writer.Write((uint32_t)data.WatchedMemoryAddresses.size());
+	writer.WriteArray(data.WatchedMemoryAddresses.data(), data.WatchedMemoryAddresses.size() * sizeof(uint32_t));
+
+	std::unordered_map<HdPackCondition*, uint32_t> conditionIndexes;
+	writer.Write((uint32_t)data.Conditions.size());
+	for(size_t i = 0; i < data.Conditions.size(); i++) {
+		HdPackCondition* condition = data.Conditions[i].get();
+		conditionIndexes[condition] = (uint32_t)i;
+
+		HdPackConditionType type = condition->GetConditionType();
+		writer.Write((uint8_t)type);
+		writer.WriteString(condition->Name);
+
+		switch(type) {
+			case HdPackConditionType::SpritePalette:
+				writer.Write(((HdPackBaseSpritePaletteCondition*)condition)->PaletteOffset);
+				break;
+
+			case HdPackConditionType::TileNearby:
+			case HdPackConditionType::TileAtPos:
+			case HdPackConditionType::SpriteNearby:
+			case HdPackConditionType::SpriteAtPos: {
+				HdPackBaseTileCondition* cond = (HdPackBaseTileCondition*)condition;
+				writer.Write(cond->TileX);
+				writer.Write(cond->TileY);
+				writer.Write(cond->PixelOffset);
+				writer.Write(cond->PaletteColors);
+				writer.WriteArray(cond->TileData, sizeof(cond->TileData));
+				writer.Write(cond->TileIndex);
+				writer.Write((uint8_t)cond->IgnorePalette);
+				break;
+			}
+
+			case HdPackConditionType::MemoryCheck:
+			case HdPackConditionType::MemoryCheckConstant: {
+				HdPackBaseMemoryCondition* cond = (HdPackBaseMemoryCondition*)condition;
+				writer.Write(cond->OperandA);
+				writer.Write((int32_t)cond->Operator);
+				writer.Write(cond->OperandB);
+				writer.Write(cond->Mask);
+				writer.Write(cond->SlotA);
+				writer.Write(cond->SlotB);
+				break;
+			}
+
+			case HdPackConditionType::FrameRange: {
+				HdPackFrameRangeCondition* cond = (HdPackFrameRangeCondition*)condition;
+				writer.Write(cond->OperandA);
+				writer.Write(cond->OperandB);
+				break;
+			}
+
+			case HdPackConditionType::PositionCheckX:
+			case HdPackConditionType::PositionCheckY:
+			case HdPackConditionType::OriginPositionCheckX:
+			case HdPackConditionType::OriginPositionCheckY: {
+				HdPackBasePositionCheckCondition* cond = (HdPackBasePositionCheckCondition*)condition;
+				writer.Write((int32_t)cond->Operator);
+				writer.Write(cond->Operand);
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+
+	auto writeConditionList = [&](vector<HdPackCondition*>& conditions) {
+		writer.Write((uint32_t)conditions.size());
+		for(HdPackCondition* condition : conditions) {
+			writer.Write(conditionIndexes[condition]);
+		}
+	};
+
+	vector<vector<uint32_t>> tilesByBitmap(data.ImageFileData.size());
+	writer.Write((uint32_t)data.Tiles.size());
+	for(size_t i = 0; i < data.Tiles.size(); i++) {
+		HdPackTileInfo* tile = data.Tiles[i].get();
+		writer.Write(tile->PaletteColors);
+		writer.WriteArray(tile->TileData, sizeof(tile->TileData));
+		writer.Write(tile->TileIndex);
+		writer.Write((uint8_t)tile->IsChrRamTile);
+		writer.Write(tile->BitmapIndex);
+		writer.Write(tile->X);
+		writer.Write(tile->Y);
+		writer.Write(tile->Width);
+		writer.Write(tile->Height);
+		writer.Write((int32_t)tile->Brightness);
+		writer.Write((uint8_t)tile->DefaultTile);
+		writer.Write(tile->ChrBankId);
+		writer.Write((uint8_t)tile->ForceDisableCache);
+		writer.Write((uint8_t)tile->HasFrameConstantConditions);
+		writeConditionList(tile->Conditions);
+		tilesByBitmap[tile->BitmapIndex].push_back((uint32_t)i);
+	}
+
+	std::unordered_map<HdPackBitmapInfo*, uint32_t> bgFileIndexes;
+	for(size_t i = 0; i < data.BackgroundFileData.size(); i++) {
+		bgFileIndexes[data.BackgroundFileData[i].get()] = (uint32_t)i;
+	}
+
+	for(int priority = 0; priority < HdPackData::BgLayerCount; priority++) {
+		writer.Write((uint32_t)data.BackgroundsByPriority[priority].size());
+		for(HdBackgroundInfo& bgInfo : data.BackgroundsByPriority[priority]) {
+			writer.Write(bgFileIndexes[bgInfo.Data]);
+			writer.Write((int32_t)bgInfo.Brightness);
+			writer.Write(bgInfo.HorizontalScrollRatio);
+			writer.Write(bgInfo.VerticalScrollRatio);
+			writer.Write(bgInfo.Priority);
+			writer.Write(bgInfo.Left);
+			writer.Write(bgInfo.Top);
+			writer.Write((uint32_t)bgInfo.BlendMode);
+			writeConditionList(bgInfo.Conditions);
+		}
+	}
+
+	//Tile records are appended to the current chunk, which is compressed and written once it is large enough
+	vector<uint8_t> chunk;
+	vector<uint8_t> compressedChunk;
+	auto appendToChunk = [&](const void* src, size_t size) {
+		chunk.insert(chunk.end(), (const uint8_t*)src, (const uint8_t*)src + size);
+	};
+	auto writeChunk = [&]() {
+		if(!chunk.empty()) {
+			compressedChunk.clear();
+			CompressionHelper::CompressFast(chunk.data(), chunk.size(), compressedChunk);
+			writer.Write((uint32_t)compressedChunk.size());
+			writer.WriteArray(compressedChunk.data(), compressedChunk.size());
+			chunk.clear();
+		}
+	};
+
+	bool success = true;
+	writer.Write((uint32_t)data.Tiles.size());
+	for(size_t i = 0; i < data.ImageFileData.size() && success; i++) {
+		if(tilesByBitmap[i].empty()) {
+			continue;
+		}
+
+		//With a texture budget, decoded bitmaps can be evicted at any time - decode a private copy instead
+		HdPackBitmapInfo* bitmap = data.ImageFileData[i].get();
+		vector<uint32_t> decodedData;
+		vector<uint32_t>* pixelData = &bitmap->PixelData;
+		uint32_t width = bitmap->Width;
+		if(data.TextureBudget > 0 || !bitmap->IsLoaded()) {
+			uint32_t height;
+			if(bitmap->FileData.empty() || !PNGHelper::ReadPNG(bitmap->FileData, decodedData, width, height)) {
+				success = false;
+				break;
+			}
+			HdPackBitmapInfo::PremultiplyAlpha(decodedData);
+			pixelData = &decodedData;
+		}
+
+		vector<uint32_t> tileData;
+		for(uint32_t tileIndex : tilesByBitmap[i]) {
+			HdPackTileInfo* tile = data.Tiles[tileIndex].get();
+			bool blank, hasTransparentPixels, isFullyTransparent;
+			tile->ExtractTileData(*pixelData, width, tileData);
+			HdPackTileInfo::GetTileFlags(tileData, blank, hasTransparentPixels, isFullyTransparent);
+
+			uint8_t flags = (blank ? 0x01 : 0) | (hasTransparentPixels ? 0x02 : 0) | (isFullyTransparent ? 0x04 : 0);
+			appendToChunk(&tileIndex, sizeof(tileIndex));
+			appendToChunk(&flags, sizeof(flags));
+			appendToChunk(tileData.data(), tileData.size() * sizeof(uint32_t));
+			if(chunk.size() >= HdPackCache::PixelChunkSize) {
+				writeChunk();
+			}
+		}
+
+		if(data.IsLoadCancelled()) {
+			success = false;
+		}
+	}
+	writeChunk();
+	writer.Write((uint32_t)0);
+	writer.WriteArray("END!", 4);
+
+	file.close();
+	if(!success || file.fail()) {
+		std::remove(data.CachePath.c_str());
+	}
+}
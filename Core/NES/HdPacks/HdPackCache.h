@@ -0,0 +1,28 @@
+#pragma once
+#include "pch.h"
+#include <functional>
+#include "NES/HdPacks/HdData.h"
+
+//Binary cache of an HD pack (hires.mcache) - contains the parsed conditions, tiles and backgrounds,
+//along with the tiles' premultiplied pixels (compressed), so the pack can be used without parsing hires.txt
+//or decoding its PNG files. The cache is only used when hires.txt is unchanged and the size and modification
+//time of all images match.
+class HdPackCache
+{
+private:
+	static constexpr uint32_t FileVersion = 2;
+
+	//Tile pixels are compressed in chunks of roughly this size
+	static constexpr size_t PixelChunkSize = 1024 * 1024;
+
+	static unique_ptr<HdPackCondition> CreateCondition(HdPackConditionType type, uint8_t paletteOffset);
+
+public:
+	static string GetCachePath(string hdPackFolder, bool loadFromZip);
+
+	//Restores the tables saved by Save() into data - data is left untouched when the cache can't be used
+	static bool Load(HdPackData& data, std::function<bool(string, vector<uint8_t>&)> loadFile, std::function<bool(string, uint64_t&, int64_t&)> getFileInfo);
+
+	//Called on the HD pack's loader thread, once its PNG files are decoded
+	static void Save(HdPackData& data);
+};
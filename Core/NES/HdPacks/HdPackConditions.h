@@ -69,6 +69,10 @@ struct HdPackBaseMemoryCondition : public HdPackCondition
 	uint32_t OperandB = 0;
 	uint8_t Mask = 0;
 
+	//Slots of the operands in HdScreenInfo::WatchedAddressValues (SlotB is only used when OperandB is an address)
+	uint32_t SlotA = 0;
+	uint32_t SlotB = 0;
+
 	void Initialize(uint32_t operandA, HdPackConditionOperator op, uint32_t operandB, uint8_t mask)
 	{
 		OperandA = operandA;
@@ -235,8 +239,8 @@ struct HdPackMemoryCheckCondition : public HdPackBaseMemoryCondition
 
 	bool InternalCheckCondition(int x, int y, HdPpuTileInfo* tile) override
 	{
-		uint8_t a = (uint8_t)(_screenInfo->WatchedAddressValues[OperandA] & Mask);
-		uint8_t b = (uint8_t)(_screenInfo->WatchedAddressValues[OperandB] & Mask);
+		uint8_t a = (uint8_t)(_screenInfo->WatchedAddressValues[SlotA] & Mask);
+		uint8_t b = (uint8_t)(_screenInfo->WatchedAddressValues[SlotB] & Mask);
 
 		switch(Operator) {
 			case HdPackConditionOperator::Equal: return a == b;
@@ -258,7 +262,7 @@ struct HdPackMemoryCheckConstantCondition : public HdPackBaseMemoryCondition
 
 	bool InternalCheckCondition(int x, int y, HdPpuTileInfo* tile) override
 	{
-		uint8_t a = (uint8_t)(_screenInfo->WatchedAddressValues[OperandA] & Mask);
+		uint8_t a = (uint8_t)(_screenInfo->WatchedAddressValues[SlotA] & Mask);
 		uint8_t b = OperandB;
 
 		switch(Operator) {
@@ -411,9 +415,10 @@ struct HdPackSpriteNearbyCondition : public HdPackBaseTileCondition
 	}
 };
 
-template<int paletteId>
-struct HdPackSpritePaletteCondition : public HdPackCondition
+struct HdPackBaseSpritePaletteCondition : public HdPackCondition
 {
+	uint8_t PaletteOffset = 0;
+
 	HdPackConditionType GetConditionType() override { return HdPackConditionType::SpritePalette; }
 	string GetConditionName() override { return "sppalette"; }
 	string ToString() override { return ""; }
@@ -421,6 +426,54 @@ struct HdPackSpritePaletteCondition : public HdPackCondition
 
 	bool InternalCheckCondition(int x, int y, HdPpuTileInfo* tile) override
 	{
-		return tile && (tile->PaletteOffset == (0x10 + (paletteId << 2)));
+		return tile && tile->PaletteOffset == PaletteOffset;
 	}
-};
\ No newline at end of file
+};
+
+template<int paletteId>
+struct HdPackSpritePaletteCondition : public HdPackBaseSpritePaletteCondition
+{
+	HdPackSpritePaletteCondition() { PaletteOffset = 0x10 + (paletteId << 2); }
+};
+
+class HdPackConditionEvaluator
+{
+public:
+	//Checks the tile's compiled conditions in order - the conditions' virtual functions are only called for
+	//frame-constant conditions (once per frame) and for condition types that have no opcode
+	static __forceinline bool Matches(HdPackTileInfo& tileInfo, HdPackFrameConditions& frameConditions, int x, int y, HdPpuTileInfo* tile)
+	{
+		for(HdPackConditionOp& op : tileInfo.CompiledConditions) {
+			bool result;
+			switch(op.Opcode) {
+				case HdPackConditionOpcode::FrameConstant:
+					//Inversion is already applied by the condition itself
+					if(!frameConditions.Check(op.Operand)) {
+						return false;
+					}
+					continue;
+
+				case HdPackConditionOpcode::HMirror: result = tile && tile->HorizontalMirroring; break;
+				case HdPackConditionOpcode::VMirror: result = tile && tile->VerticalMirroring; break;
+				case HdPackConditionOpcode::BgPriority: result = tile && tile->BackgroundPriority; break;
+				case HdPackConditionOpcode::SpritePalette: result = tile && tile->PaletteOffset == op.Operand; break;
+				
+				//Qualified calls are not virtual and can be inlined
+				case HdPackConditionOpcode::PositionCheck: result = ((HdPackBasePositionCheckCondition*)op.Condition)->HdPackBasePositionCheckCondition::InternalCheckCondition(x, y, tile); break;
+				case HdPackConditionOpcode::TileNearby: result = ((HdPackTileNearbyCondition*)op.Condition)->HdPackTileNearbyCondition::InternalCheckCondition(x, y, tile); break;
+				case HdPackConditionOpcode::SpriteNearby: result = ((HdPackSpriteNearbyCondition*)op.Condition)->HdPackSpriteNearbyCondition::InternalCheckCondition(x, y, tile); break;
+
+				default:
+					if(!op.Condition->CheckCondition(x, y, tile)) {
+						return false;
+					}
+					continue;
+			}
+
+			if(result == op.Invert) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <unordered_map>
 #include "NES/HdPacks/HdPackLoader.h"
+#include "NES/HdPacks/HdPackCache.h"
 #include "NES/HdPacks/HdPackConditions.h"
 #include "NES/HdPacks/HdNesPack.h"
 #include "NES/NesConsole.h"
@@ -13,6 +14,7 @@
 #include "Utilities/PNGHelper.h"
 #include "Utilities/FastString.h"
 #include "Utilities/magic_enum.hpp"
+#include "Utilities/sha1.h"
 
 #define checkConstraint(x, y) if(!(x)) { MessageManager::Log(y); return; }
 
@@ -85,6 +87,7 @@ bool HdPackLoader::LoadHdNesPack(string definitionFile, HdPackData &outData)
 bool HdPackLoader::LoadHdNesPack(VirtualFile &romFile, HdPackData &outData)
 {
 	HdPackLoader loader;
+	loader._useCache = true;
 	if(loader.InitializeLoader(romFile, &outData)) {
 		return loader.LoadPack();
 	}
@@ -130,6 +133,16 @@ bool HdPackLoader::LoadFile(string filename, vector<uint8_t> &fileData)
 	return false;
 }
 
+bool HdPackLoader::GetFileInfo(string filename, uint64_t& size, int64_t& modifiedTime)
+{
+	if(_loadFromZip) {
+		//Files in the archive don't have their own timestamps on the disk, use the archive's
+		return FolderUtilities::GetFileInfo(_hdPackFolder, size, modifiedTime);
+	} else {
+		return FolderUtilities::GetFileInfo(FolderUtilities::CombinePath(_hdPackFolder, filename), size, modifiedTime);
+	}
+}
+
 bool HdPackLoader::LoadPack()
 {
 	string lineContent;
@@ -139,7 +152,20 @@ bool HdPackLoader::LoadPack()
 			return false;
 		}
 
-		InitializeGlobalConditions();
+		bool cacheLoaded = false;
+		if(_useCache) {
+			_data->CachePath = HdPackCache::GetCachePath(_hdPackFolder, _loadFromZip);
+			_data->DefinitionHash = SHA1::GetHash(hdDefinition);
+			cacheLoaded = HdPackCache::Load(*_data,
+				[this](string filename, vector<uint8_t>& fileData) { return LoadFile(filename, fileData); },
+				[this](string filename, uint64_t& size, int64_t& modifiedTime) { return GetFileInfo(filename, size, modifiedTime); }
+			);
+			_data->CacheNeedsSave = !cacheLoaded;
+		}
+
+		if(!cacheLoaded) {
+			InitializeGlobalConditions();
+		}
 
 		size_t len = hdDefinition.size();
 		size_t pos = 0;
@@ -164,6 +190,10 @@ bool HdPackLoader::LoadPack()
 				lineContent = lineContent.substr(0, lineContent.size() - 1);
 			}
 
+			if(cacheLoaded && IsCachedTag(lineContent)) {
+				continue;
+			}
+
 			vector<HdPackCondition*> conditions;
 			if(lineContent.substr(0, 1) == "[") {
 				size_t endOfCondition = lineContent.find_first_of(']', 1);
@@ -249,6 +279,9 @@ bool HdPackLoader::ProcessImgTag(string src)
 		return false;
 	}
 	bitmapInfo.PngName = src;
+	if(_useCache) {
+		GetFileInfo(src, bitmapInfo.FileSize, bitmapInfo.FileTime);
+	}
 	return true;
 }
 
@@ -351,7 +384,12 @@ void HdPackLoader::ProcessTileTag(vector<string> &tokens, vector<HdPackCondition
 	tileInfo->Y = std::stoi(tokens[index++]);
 	tileInfo->Conditions = conditions;
 	tileInfo->ForceDisableCache = false;
+	tileInfo->HasFrameConstantConditions = true;
 	for(HdPackCondition* condition : conditions) {
+		if(!condition->IsFrameConstant()) {
+			tileInfo->HasFrameConstantConditions = false;
+		}
+
 		HdPackConditionType type = condition->GetConditionType();
 		switch(type){
 			case HdPackConditionType::SpriteNearby:
@@ -540,7 +578,6 @@ void HdPackLoader::ProcessConditionTag(vector<string> &tokens, bool createInvert
 					} else {
 						checkConstraint(operandB <= 0xFFFF, "[HDPack] Out of range memoryCheck operand");
 					}
-					_data->WatchedMemoryAddresses.emplace(operandB);
 					break;
 
 				case HdPackConditionType::MemoryCheckConstant:
@@ -548,8 +585,12 @@ void HdPackLoader::ProcessConditionTag(vector<string> &tokens, bool createInvert
 					break;
 			}
 
-			_data->WatchedMemoryAddresses.emplace(operandA);
-			((HdPackBaseMemoryCondition*)condition.get())->Initialize(operandA, op, operandB, (uint8_t)mask);
+			HdPackBaseMemoryCondition* memoryCondition = (HdPackBaseMemoryCondition*)condition.get();
+			memoryCondition->Initialize(operandA, op, operandB, (uint8_t)mask);
+			memoryCondition->SlotA = GetWatchedAddressSlot(operandA);
+			if(condition->GetConditionType() == HdPackConditionType::MemoryCheck) {
+				memoryCondition->SlotB = GetWatchedAddressSlot(operandB);
+			}
 			break;
 		}
 
@@ -633,6 +674,9 @@ void HdPackLoader::ProcessBackgroundTag(vector<string> &tokens, vector<HdPackCon
 			_data->BackgroundFileData.pop_back();
 		} else {
 			_backgroundsByName[tokens[0]] = bgFileData;
+			if(_useCache) {
+				GetFileInfo(bgFileData->PngName, bgFileData->FileSize, bgFileData->FileTime);
+			}
 		}
 	} else {
 		bgFileData = result->second;
@@ -837,19 +881,120 @@ void HdPackLoader::LoadCustomPalette()
 
 void HdPackLoader::InitializeHdPack()
 {
+	unordered_map<HdTileKey, vector<HdPackTileInfo*>> tileByKey;
 	for(unique_ptr<HdPackTileInfo> &tileInfo : _data->Tiles) {
-		auto tiles = _data->TileByKey.find(tileInfo->GetKey(false));
-		if(tiles == _data->TileByKey.end()) {
-			_data->TileByKey[tileInfo->GetKey(false)] = vector<HdPackTileInfo*>();
+		tileByKey[tileInfo->GetKey(false)].push_back(tileInfo.get());
+
+		if(!tileInfo->NeedInit()) {
+			//Loaded from the cache file
+			_data->TextureStats.ResidentBytes += tileInfo->HdTileData.size() * sizeof(uint32_t);
 		}
-		_data->TileByKey[tileInfo->GetKey(false)].push_back(tileInfo.get());
 
 		if(tileInfo->DefaultTile) {
-			auto tilesForDefaultKey = _data->TileByKey.find(tileInfo->GetKey(true));
-			if(tilesForDefaultKey == _data->TileByKey.end()) {
-				_data->TileByKey[tileInfo->GetKey(true)] = vector<HdPackTileInfo*>();
+			tileByKey[tileInfo->GetKey(true)].push_back(tileInfo.get());
+		}
+	}
+
+	_data->TileByKey.Build(tileByKey);
+
+	for(unique_ptr<HdPackBitmapInfo>& bitmap : _data->BackgroundFileData) {
+		bitmap->Stats = &_data->TextureStats;
+	}
+	for(unique_ptr<HdPackBitmapInfo>& bitmap : _data->ImageFileData) {
+		bitmap->Stats = &_data->TextureStats;
+	}
+
+	//Used to prefetch the bitmaps needed by the CHR ROM pages that are currently mapped (64 tiles per 1 KB page)
+	for(unique_ptr<HdPackTileInfo>& tileInfo : _data->Tiles) {
+		if(!tileInfo->IsChrRamTile && tileInfo->TileIndex >= 0) {
+			vector<HdPackBitmapInfo*>& bitmaps = _data->BitmapsByChrPage[(uint32_t)tileInfo->TileIndex >> 6];
+			if(std::find(bitmaps.begin(), bitmaps.end(), tileInfo->Bitmap) == bitmaps.end()) {
+				bitmaps.push_back(tileInfo->Bitmap);
 			}
-			_data->TileByKey[tileInfo->GetKey(true)].push_back(tileInfo.get());
 		}
 	}
+
+	CompileConditions();
+}
+
+bool HdPackLoader::IsCachedTag(string& lineContent)
+{
+	//These tags (and the conditions that prefix tiles/backgrounds) are restored from the cache file
+	return (
+		lineContent[0] == '[' ||
+		lineContent.compare(0, 6, "<tile>") == 0 ||
+		lineContent.compare(0, 12, "<background>") == 0 ||
+		lineContent.compare(0, 11, "<condition>") == 0 ||
+		lineContent.compare(0, 5, "<img>") == 0
+	);
+}
+
+uint32_t HdPackLoader::GetWatchedAddressSlot(uint32_t address)
+{
+	auto result = _watchedAddressSlots.find(address);
+	if(result != _watchedAddressSlots.end()) {
+		return result->second;
+	}
+
+	uint32_t slot = (uint32_t)_data->WatchedMemoryAddresses.size();
+	_data->WatchedMemoryAddresses.push_back(address);
+	_watchedAddressSlots[address] = slot;
+	return slot;
+}
+
+void HdPackLoader::CompileConditions()
+{
+	//Frame-constant conditions are given an index in the per-frame result bitset
+	for(unique_ptr<HdPackCondition>& condition : _data->Conditions) {
+		if(condition->IsFrameConstant()) {
+			condition->FrameIndex = (int32_t)_data->FrameConditions.size();
+			_data->FrameConditions.push_back(condition.get());
+		}
+	}
+
+	//The order of each tile's conditions is kept as-is, conditions are still evaluated lazily from left to right
+	for(unique_ptr<HdPackTileInfo>& tileInfo : _data->Tiles) {
+		tileInfo->CompiledConditions.clear();
+		for(HdPackCondition* condition : tileInfo->Conditions) {
+			tileInfo->CompiledConditions.push_back(CompileCondition(condition));
+		}
+	}
+}
+
+HdPackConditionOp HdPackLoader::CompileCondition(HdPackCondition* condition)
+{
+	HdPackConditionOp op;
+	op.Condition = condition;
+	op.Invert = condition->Name[0] == '!';
+
+	if(condition->FrameIndex >= 0) {
+		op.Opcode = HdPackConditionOpcode::FrameConstant;
+		op.Operand = (uint32_t)condition->FrameIndex;
+		return op;
+	}
+
+	switch(condition->GetConditionType()) {
+		case HdPackConditionType::HMirror: op.Opcode = HdPackConditionOpcode::HMirror; break;
+		case HdPackConditionType::VMirror: op.Opcode = HdPackConditionOpcode::VMirror; break;
+		case HdPackConditionType::BgPriority: op.Opcode = HdPackConditionOpcode::BgPriority; break;
+		case HdPackConditionType::TileNearby: op.Opcode = HdPackConditionOpcode::TileNearby; break;
+		case HdPackConditionType::SpriteNearby: op.Opcode = HdPackConditionOpcode::SpriteNearby; break;
+
+		case HdPackConditionType::SpritePalette:
+			op.Opcode = HdPackConditionOpcode::SpritePalette;
+			op.Operand = ((HdPackBaseSpritePaletteCondition*)condition)->PaletteOffset;
+			break;
+
+		case HdPackConditionType::PositionCheckX:
+		case HdPackConditionType::PositionCheckY:
+		case HdPackConditionType::OriginPositionCheckX:
+		case HdPackConditionType::OriginPositionCheckY:
+			op.Opcode = HdPackConditionOpcode::PositionCheck;
+			break;
+
+		default:
+			op.Opcode = HdPackConditionOpcode::Generic;
+			break;
+	}
+	return op;
 }
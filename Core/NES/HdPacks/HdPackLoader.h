@@ -15,20 +15,27 @@ public:
 private:
 	HdPackData* _data = nullptr;
 	bool _loadFromZip = false;
+	bool _useCache = false;
 	ZipReader _reader;
 	string _hdPackDefinitionFile;
 	string _hdPackFolder;
 	unordered_map<string, HdPackCondition*> _conditionsByName;
 	unordered_map<string, HdPackBitmapInfo*> _backgroundsByName;
+	unordered_map<uint32_t, uint32_t> _watchedAddressSlots;
 
 	HdPackLoader();
 
 	bool InitializeLoader(VirtualFile &romPath, HdPackData *data);
 	bool LoadFile(string filename, vector<uint8_t> &fileData);
 	bool CheckFile(string filename);
+	bool GetFileInfo(string filename, uint64_t& size, int64_t& modifiedTime);
 
 	bool LoadPack();
 	void InitializeHdPack();
+	bool IsCachedTag(string& lineContent);
+	void CompileConditions();
+	HdPackConditionOp CompileCondition(HdPackCondition* condition);
+	uint32_t GetWatchedAddressSlot(uint32_t address);
 	void LoadCustomPalette();
 	
 	void ReadTileData(HdTileKey& key, string& tileData, string& palData);
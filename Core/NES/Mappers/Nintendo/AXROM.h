@@ -16,6 +16,7 @@ class AXROM : public BaseMapper
 		}
 
 		bool HasBusConflicts() override { return _romInfo.SubMapperID == 2; }
+		bool NeedsPpuCallbacks() override { return false; }
 
 		void WriteRegister(uint16_t addr, uint8_t value) override
 		{
@@ -18,6 +18,7 @@ protected:
 	}
 	
 	bool HasBusConflicts() override { return (_romInfo.MapperID == 3 && _romInfo.SubMapperID == 2) || _romInfo.MapperID == 185; }
+	bool NeedsPpuCallbacks() override { return false; }
 
 	void WriteRegister(uint16_t addr, uint8_t value) override
 	{
@@ -7,6 +7,7 @@ class GxRom : public BaseMapper
 protected:
 	uint16_t GetPrgPageSize() override { return 0x8000; }
 	uint16_t GetChrPageSize() override { return 0x2000; }
+	bool NeedsPpuCallbacks() override { return false; }
 
 	void InitMapper() override
 	{
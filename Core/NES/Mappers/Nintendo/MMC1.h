@@ -114,6 +114,7 @@ protected:
 protected:
 	uint16_t GetPrgPageSize() override { return 0x4000; }
 	uint16_t GetChrPageSize() override { return 0x1000; }
+	bool NeedsPpuCallbacks() override { return false; }
 
 	virtual void UpdateState()
 	{
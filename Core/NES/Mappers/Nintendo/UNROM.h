@@ -18,6 +18,7 @@ protected:
 	}
 
 	bool HasBusConflicts() override { return _romInfo.SubMapperID == 2; }
+	bool NeedsPpuCallbacks() override { return false; }
 
 	void WriteRegister(uint16_t addr, uint8_t value) override
 	{
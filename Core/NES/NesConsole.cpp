@@ -13,6 +13,7 @@
 #include "NES/HdPacks/HdData.h"
 #include "NES/HdPacks/HdNesPpu.h"
 #include "NES/HdPacks/HdPackLoader.h"
+#include "NES/HdPacks/HdPackCache.h"
 #include "NES/HdPacks/HdPackBuilder.h"
 #include "NES/HdPacks/HdBuilderPpu.h"
 #include "NES/HdPacks/HdVideoFilter.h"
@@ -200,6 +201,10 @@ LoadRomResult NesConsole::LoadRom(VirtualFile& romFile)
 
 void NesConsole::LoadHdPack(VirtualFile& romFile)
 {
+	shared_ptr<HdPackData> prevData = _hdData.lock();
+	if(prevData) {
+		prevData->CancelLoad();
+	}
 	_hdData.reset();
 	if(GetNesConfig().EnableHdPacks) {
 		_hdData.reset(new HdPackData());
@@ -212,10 +217,14 @@ void NesConsole::LoadHdPack(VirtualFile& romFile)
 				romFile.ApplyPatch(patchFile);
 			}
 
+			_hdData->SetTextureBudget((uint64_t)GetNesConfig().HdPackTextureBudget * 1024 * 1024);
+
 			shared_ptr<HdPackData> data = _hdData.lock();
 			if(data) {
 				thread asyncLoadData([data]() {
 					data->LoadAsync();
+					HdPackCache::Save(*data.get());
+					data->ProcessPrefetchQueue();
 				});
 				asyncLoadData.detach();
 			}
@@ -257,6 +266,9 @@ void NesConsole::RunFrame()
 		_nextFrameOverclockDisabled = false;
 	}
 
+	//Run the PPU in batches (only when its state can be observed) unless the mapper or debugger need to see every PPU cycle
+	_cpu->SetPpuCatchUp(!_emu->IsDebugging() && !_vsSubConsole && !_vsMainConsole && _mapper->AllowPpuCatchUp());
+
 	while(frame == _ppu->GetFrameCount()) {
 		_cpu->Exec();
 		if(_vsSubConsole) {
@@ -643,6 +655,21 @@ DipSwitchInfo NesConsole::GetDipSwitchInfo()
 	return info;
 }
 
+TextureCacheStats NesConsole::GetTextureCacheStats()
+{
+	TextureCacheStats stats = {};
+	shared_ptr<HdPackData> hdData = _hdData.lock();
+	if(hdData) {
+		stats.Budget = hdData->TextureBudget;
+		stats.Hits = hdData->TextureStats.Hits;
+		stats.Misses = hdData->TextureStats.Misses;
+		stats.Decodes = hdData->TextureStats.Decodes;
+		stats.Evictions = hdData->TextureStats.Evictions;
+		stats.ResidentBytes = hdData->TextureStats.ResidentBytes;
+	}
+	return stats;
+}
+
 void NesConsole::ProcessNotification(ConsoleNotificationType type, void* parameter)
 {
 	if(type == ConsoleNotificationType::ExecuteShortcut) {
@@ -661,8 +688,8 @@ void NesConsole::StartRecordingHdPack(HdPackBuilderOptions options)
 
 	_emu->GetVideoDecoder()->WaitForAsyncFrameDecode();
 
-	std::stringstream saveState;
-	_emu->Serialize(saveState, false, 0);
+	vector<uint8_t> saveState;
+	_emu->Serialize(saveState, false);
 
 	_hdPackBuilder.reset();
 	_hdPackBuilder.reset(new HdPackBuilder(_emu, _ppu->GetPpuModel(), !_mapper->HasChrRom(), options));
@@ -671,7 +698,7 @@ void NesConsole::StartRecordingHdPack(HdPackBuilderOptions options)
 	_ppu.reset(new HdBuilderPpu(this, _hdPackBuilder.get(), options.ChrRamBankSize));
 	_memoryManager->RegisterIODevice(_ppu.get());
 
-	_emu->Deserialize(saveState, SaveStateManager::FileFormatVersion, false);
+	_emu->Deserialize(saveState, false);
 	_emu->GetSoundMixer()->StopAudio();
 
 	_emu->GetVideoDecoder()->ForceFilterUpdate();
@@ -684,8 +711,8 @@ void NesConsole::StopRecordingHdPack()
 		
 		_emu->GetVideoDecoder()->WaitForAsyncFrameDecode();
 
-		std::stringstream saveState;
-		_emu->Serialize(saveState, false, 0);
+		vector<uint8_t> saveState;
+		_emu->Serialize(saveState, false);
 
 		_memoryManager->UnregisterIODevice(_ppu.get());
 		if(_hdData) {
@@ -696,7 +723,7 @@ void NesConsole::StopRecordingHdPack()
 		_memoryManager->RegisterIODevice(_ppu.get());
 		_hdPackBuilder.reset();
 
-		_emu->Deserialize(saveState, SaveStateManager::FileFormatVersion, false);
+		_emu->Deserialize(saveState, false);
 		_emu->GetSoundMixer()->StopAudio();
 		_emu->GetVideoDecoder()->ForceFilterUpdate();
 	}
@@ -94,6 +94,7 @@ void NesCpu::Reset(bool softReset, ConsoleRegion region)
 	_isDmcDmaRead = false;
 	_cpuWrite = false;
 	_lastCrashWarning = 0;
+	_ppuSyncClock = 0;
 
 	//Use _memoryManager->Read() directly to prevent clocking the PPU/APU when setting PC at reset
 	_state.PC = _memoryManager->Read(NesCpu::ResetVector) | _memoryManager->Read(NesCpu::ResetVector+1) << 8;
@@ -238,6 +239,7 @@ void NesCpu::MemoryWrite(uint16_t addr, uint8_t value, MemoryOperationType opera
 	LogMemoryOperation(addr, value, operationType);
 #else
 	_cpuWrite = true;
+	SyncPpu(addr, true);
 	StartCpuCycle(false);
 	_memoryManager->Write(addr, value, operationType);
 	EndCpuCycle(false);
@@ -254,6 +256,7 @@ uint8_t NesCpu::MemoryRead(uint16_t addr, MemoryOperationType operationType)
 #else 
 	ProcessPendingDma(addr);
 
+	SyncPpu(addr, false);
 	StartCpuCycle(true);
 	uint8_t value = _memoryManager->Read(addr, operationType);
 	EndCpuCycle(true);
@@ -302,10 +305,40 @@ uint16_t NesCpu::FetchOperand()
 #endif
 }
 
+void NesCpu::SetPpuCatchUp(bool enabled)
+{
+	_ppuCatchUp = enabled;
+	_ppuSyncClock = 0;
+}
+
+void NesCpu::SyncPpu(uint16_t addr, bool forWrite)
+{
+	//PPU registers, input devices (e.g zapper) and mapper registers (CHR banking, mirroring)
+	//can observe or alter the PPU's state, make sure it has caught up before the access
+	if(_ppuCatchUp && ((addr >= 0x2000 && addr <= 0x3FFF) || (addr & 0xFFFE) == 0x4016 || (forWrite && addr >= 0x4020))) {
+		_ppuSyncClock = 0;
+	}
+}
+
+void NesCpu::RunPpu()
+{
+	uint64_t runTo = _masterClock - _ppuOffset;
+	if(runTo >= _ppuSyncClock) {
+		BaseNesPpu* ppu = _console->GetPpu();
+		ppu->Run(runTo);
+		if(_ppuCatchUp && !_emu->IsDebugging()) {
+			//Nothing outside of the PPU can observe its state until the next sync point (unless a register is accessed)
+			_ppuSyncClock = ppu->GetNextSyncClock();
+		} else {
+			_ppuSyncClock = 0;
+		}
+	}
+}
+
 void NesCpu::EndCpuCycle(bool forRead)
 {
 	_masterClock += forRead ? (_endClockCount + 1) : (_endClockCount - 1);
-	_console->GetPpu()->Run(_masterClock - _ppuOffset);
+	RunPpu();
 
 	//"The internal signal goes high during φ1 of the cycle that follows the one where the edge is detected,
 	//and stays high until the NMI has been handled. "
@@ -329,7 +362,7 @@ void NesCpu::StartCpuCycle(bool forRead)
 {
 	_masterClock += forRead ? (_startClockCount - 1) : (_startClockCount + 1);
 	_state.CycleCount++;
-	_console->GetPpu()->Run(_masterClock - _ppuOffset);
+	RunPpu();
 	_console->ProcessCpuClock();
 }
 
@@ -356,6 +389,11 @@ void NesCpu::ProcessPendingDma(uint16_t readAddress)
 	//The exact specifics of where the CPU reads instead aren't known yet - so just disable read side-effects entirely on PAL
 	bool isNtscInputBehavior = _console->GetRegion() != ConsoleRegion::Pal;
 
+	//DMA cycles read/write from arbitrary addresses (including $2004), run the PPU on every cycle until the DMA ends
+	bool ppuCatchUp = _ppuCatchUp;
+	_ppuCatchUp = false;
+	_ppuSyncClock = 0;
+
 	//"If this cycle is a read, hijack the read, discard the value, and prevent all other actions that occur on this cycle (PC not incremented, etc)"
 	StartCpuCycle(true);
 	if(isNtscInputBehavior && !skipFirstInputClock) {
@@ -432,6 +470,8 @@ void NesCpu::ProcessPendingDma(uint16_t readAddress)
 			}
 		}
 	}
+
+	_ppuCatchUp = ppuCatchUp;
 }
 
 uint8_t NesCpu::ProcessDmaRead(uint16_t addr, uint16_t& prevReadAddress, bool enableInternalRegReads, bool isNesBehavior)
@@ -565,4 +605,9 @@ void NesCpu::Serialize(Serializer &s)
 		SV(_prevNmiFlag);
 		SV(_needNmi);
 	}
+
+	if(!s.IsSaving()) {
+		//The PPU's state was saved at the point it was last run, let it catch up on the next cycle
+		_ppuSyncClock = 0;
+	}
 }
\ No newline at end of file
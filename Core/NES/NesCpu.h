@@ -61,6 +61,12 @@ private:
 	uint64_t _lastCrashWarning = 0;
 	bool _isDmcDmaRead = false;
 
+	//PPU catch-up mode: the PPU is only run once the master clock reaches _ppuSyncClock (0 = run on every half-cycle)
+	bool _ppuCatchUp = false;
+	uint64_t _ppuSyncClock = 0;
+
+	__forceinline void RunPpu();
+	__forceinline void SyncPpu(uint16_t addr, bool forWrite);
 	__forceinline void StartCpuCycle(bool forRead);
 	__forceinline void ProcessPendingDma(uint16_t readAddress);
 	uint8_t ProcessDmaRead(uint16_t addr, uint16_t& prevReadAddress, bool enableInternalRegReads, bool isNesBehavior);
@@ -792,6 +798,8 @@ public:
 	bool IsCpuWrite() { return _cpuWrite; }
 	bool IsDmcDma() { return _isDmcDmaRead; }
 
+	void SetPpuCatchUp(bool enabled);
+
 	void Reset(bool softReset, ConsoleRegion region);
 	void Exec();
 
@@ -18,6 +18,7 @@ NesSoundMixer::NesSoundMixer(NesConsole* console)
 	_blipBufLeft = blip_new(NesSoundMixer::MaxSamplesPerFrame);
 	_blipBufRight = blip_new(NesSoundMixer::MaxSamplesPerFrame);
 	_sampleRate = 96000;
+	_deltas.reserve(0x4000);
 }
 
 NesSoundMixer::~NesSoundMixer()
@@ -53,13 +54,12 @@ void NesSoundMixer::Reset()
 	blip_clear(_blipBufLeft);
 	blip_clear(_blipBufRight);
 
-	_timestamps.clear();
+	_deltas.clear();
 
 	for(uint32_t i = 0; i < MaxChannelCount; i++) {
 		_volumes[i] = 1.0;
 		_panning[i] = 0;
 	}
-	memset(_channelOutput, 0, sizeof(_channelOutput));
 	memset(_currentOutput, 0, sizeof(_currentOutput));
 
 	UpdateRates(true);
@@ -174,46 +174,78 @@ double NesSoundMixer::GetChannelOutput(AudioChannel channel, bool forRightChanne
 	}
 }
 
+void NesSoundMixer::UpdateOutputVolume(uint32_t changedChannels, bool forRightChannel)
+{
+	int side = forRightChannel ? 1 : 0;
+	if(changedChannels & NesSoundMixer::SquareChannels) {
+		double squareOutput = GetChannelOutput(AudioChannel::Square1, forRightChannel) + GetChannelOutput(AudioChannel::Square2, forRightChannel);
+		_squareVolume[side] = (uint16_t)((95.88*5000.0) / (8128.0 / squareOutput + 100.0));
+	}
+
+	if(changedChannels & NesSoundMixer::TndChannels) {
+		double tndOutput = GetChannelOutput(AudioChannel::DMC, forRightChannel) + 2.7516713261 * GetChannelOutput(AudioChannel::Triangle, forRightChannel) + 1.8493587125 * GetChannelOutput(AudioChannel::Noise, forRightChannel);
+		_tndVolume[side] = (uint16_t)((159.79*5000.0) / (22638.0 / tndOutput + 100.0));
+	}
+
+	if(changedChannels & NesSoundMixer::ExpansionChannels) {
+		_expansionOutput[side] =
+			GetChannelOutput(AudioChannel::FDS, forRightChannel) * 20 +
+			GetChannelOutput(AudioChannel::MMC5, forRightChannel) * 43 +
+			GetChannelOutput(AudioChannel::Namco163, forRightChannel) * 20 +
+			GetChannelOutput(AudioChannel::Sunsoft5B, forRightChannel) * 15 +
+			GetChannelOutput(AudioChannel::VRC6, forRightChannel) * 75 +
+			GetChannelOutput(AudioChannel::VRC7, forRightChannel);
+	}
+}
+
 int16_t NesSoundMixer::GetOutputVolume(bool forRightChannel)
 {
-	double squareOutput = GetChannelOutput(AudioChannel::Square1, forRightChannel) + GetChannelOutput(AudioChannel::Square2, forRightChannel);
-	double tndOutput = GetChannelOutput(AudioChannel::DMC, forRightChannel) + 2.7516713261 * GetChannelOutput(AudioChannel::Triangle, forRightChannel) + 1.8493587125 * GetChannelOutput(AudioChannel::Noise, forRightChannel);
-
-	uint16_t squareVolume = (uint16_t)((95.88*5000.0) / (8128.0 / squareOutput + 100.0));
-	uint16_t tndVolume = (uint16_t)((159.79*5000.0) / (22638.0 / tndOutput + 100.0));
-
-	return (int16_t)(squareVolume + tndVolume +
-		GetChannelOutput(AudioChannel::FDS, forRightChannel) * 20 +
-		GetChannelOutput(AudioChannel::MMC5, forRightChannel) * 43 +
-		GetChannelOutput(AudioChannel::Namco163, forRightChannel) * 20 +
-		GetChannelOutput(AudioChannel::Sunsoft5B, forRightChannel) * 15 +
-		GetChannelOutput(AudioChannel::VRC6, forRightChannel) * 75 +
-		GetChannelOutput(AudioChannel::VRC7, forRightChannel));
+	int side = forRightChannel ? 1 : 0;
+	return (int16_t)(_squareVolume[side] + _tndVolume[side] + _expansionOutput[side]);
 }
+
 void NesSoundMixer::AddDelta(AudioChannel channel, uint32_t time, int16_t delta)
 {
 	if(delta != 0) {
-		_timestamps.push_back(time);
-		_channelOutput[(int)channel][time] += delta;
+		_deltas.push_back(((uint64_t)time << 32) | ((uint32_t)channel << 16) | (uint16_t)delta);
 	}
 }
 
 void NesSoundMixer::EndFrame(uint32_t time)
 {
-	sort(_timestamps.begin(), _timestamps.end());
-	_timestamps.erase(std::unique(_timestamps.begin(), _timestamps.end()), _timestamps.end());
+	//Deltas are mostly in order already (each channel adds them in order)
+	if(!std::is_sorted(_deltas.begin(), _deltas.end())) {
+		std::sort(_deltas.begin(), _deltas.end());
+	}
 
-	for(size_t i = 0, len = _timestamps.size(); i < len; i++) {
-		uint32_t stamp = _timestamps[i];
-		for(uint32_t j = 0; j < MaxChannelCount; j++) {
-			_currentOutput[j] += _channelOutput[j][stamp];
-		}
+	//Volume/panning settings may have changed since the last frame, recalculate everything once
+	constexpr uint32_t allChannels = (1 << MaxChannelCount) - 1;
+	UpdateOutputVolume(allChannels, false);
+	if(_hasPanning) {
+		UpdateOutputVolume(allChannels, true);
+	}
 
+	size_t i = 0;
+	size_t len = _deltas.size();
+	while(i < len) {
+		//Apply all the deltas for this timestamp, and only update the channel groups that changed
+		uint32_t stamp = (uint32_t)(_deltas[i] >> 32);
+		uint32_t changedChannels = 0;
+		do {
+			uint64_t delta = _deltas[i];
+			uint32_t channel = (uint32_t)(delta >> 16) & 0xFFFF;
+			_currentOutput[channel] += (int16_t)(uint16_t)delta;
+			changedChannels |= 1 << channel;
+			i++;
+		} while(i < len && (uint32_t)(_deltas[i] >> 32) == stamp);
+
+		UpdateOutputVolume(changedChannels, false);
 		int16_t currentOutput = GetOutputVolume(false) * 4;
 		blip_add_delta(_blipBufLeft, stamp, (int)(currentOutput - _previousOutputLeft));
 		_previousOutputLeft = currentOutput;
 
 		if(_hasPanning) {
+			UpdateOutputVolume(changedChannels, true);
 			currentOutput = GetOutputVolume(true) * 4;
 			blip_add_delta(_blipBufRight, stamp, (int)(currentOutput - _previousOutputRight));
 			_previousOutputRight = currentOutput;
@@ -225,8 +257,6 @@ void NesSoundMixer::EndFrame(uint32_t time)
 		blip_end_frame(_blipBufRight, time);
 	}
 
-	//Reset everything
-	_timestamps.clear();
-	memset(_channelOutput, 0, sizeof(_channelOutput));
+	_deltas.clear();
 }
 
@@ -23,6 +23,11 @@ private:
 	static constexpr uint32_t MaxSamplesPerFrame = MaxSampleRate / 60 * 4 * 2; //x4 to allow CPU overclocking up to 10x, x2 for panning stereo
 	static constexpr uint32_t MaxChannelCount = 11;
 
+	//Channels that are mixed together by GetOutputVolume (used to only recalculate the groups that changed)
+	static constexpr uint32_t SquareChannels = (1 << (int)AudioChannel::Square1) | (1 << (int)AudioChannel::Square2);
+	static constexpr uint32_t TndChannels = (1 << (int)AudioChannel::Triangle) | (1 << (int)AudioChannel::Noise) | (1 << (int)AudioChannel::DMC);
+	static constexpr uint32_t ExpansionChannels = ((1 << MaxChannelCount) - 1) & ~(SquareChannels | TndChannels);
+
 	NesConsole* _console = nullptr;
 	SoundMixer* _mixer = nullptr;
 
@@ -33,10 +38,15 @@ private:
 	int16_t _previousOutputLeft = 0;
 	int16_t _previousOutputRight = 0;
 
-	vector<uint32_t> _timestamps;
-	int16_t _channelOutput[MaxChannelCount][CycleLength] = {};
+	//Deltas for the current frame, encoded as [timestamp:32][channel:16][delta:16] to be sorted by timestamp
+	vector<uint64_t> _deltas;
 	int16_t _currentOutput[MaxChannelCount] = {};
 
+	//Output of each group of channels, for the left [0] and right [1] channels
+	uint16_t _squareVolume[2] = {};
+	uint16_t _tndVolume[2] = {};
+	double _expansionOutput[2] = {};
+
 	blip_t* _blipBufLeft = nullptr;
 	blip_t* _blipBufRight = nullptr;
 	int16_t* _outputBuffer = nullptr;
@@ -50,6 +60,7 @@ private:
 	bool _hasPanning = false;
 
 	__forceinline double GetChannelOutput(AudioChannel channel, bool forRightChannel);
+	__forceinline void UpdateOutputVolume(uint32_t changedChannels, bool forRightChannel);
 	__forceinline int16_t GetOutputVolume(bool forRightChannel);
 	void EndFrame(uint32_t time);
 
@@ -9,11 +9,13 @@ public:
 	uint16_t Port = 0;
 	string Password;
 	bool Spectator = false;
+	bool Rollback = false;
+	uint32_t SimulatedLatency = 0;
 
 	ClientConnectionData() {}
 
-	ClientConnectionData(string host, uint16_t port, string password, bool spectator) :
-		Host(host), Port(port), Password(password), Spectator(spectator)
+	ClientConnectionData(string host, uint16_t port, string password, bool spectator, bool rollback, uint32_t simulatedLatency) :
+		Host(host), Port(port), Password(password), Spectator(spectator), Rollback(rollback), SimulatedLatency(simulatedLatency)
 	{
 	}
 
@@ -10,12 +10,19 @@
 #include "Netplay/PlayerListMessage.h"
 #include "Netplay/ForceDisconnectMessage.h"
 #include "Netplay/ServerInformationMessage.h"
+#include "Netplay/StateHashMessage.h"
+#include "Netplay/RequestStateMessage.h"
 #include "Netplay/GameServer.h"
 #include "Shared/BaseControlManager.h"
+#include "Shared/IControllerHub.h"
 #include "Shared/Emulator.h"
 #include "Shared/EmuSettings.h"
 #include "Shared/NotificationManager.h"
 #include "Shared/RomFinder.h"
+#include "Shared/CheatManager.h"
+#include "Utilities/CompressionHelper.h"
+#include "Utilities/CRC32.h"
+#include "Utilities/Serializer.h"
 
 GameClientConnection::GameClientConnection(Emulator* emu, unique_ptr<Socket> socket, ClientConnectionData &connectionData) : GameConnection(emu, std::move(socket))
 {
@@ -24,6 +31,8 @@ GameClientConnection::GameClientConnection(Emulator* emu, unique_ptr<Socket> soc
 	_enableControllers = false;
 	_minimumQueueSize = 3;
 	_controllerType = ControllerType::None;
+	_rollbackMode = connectionData.Rollback;
+	SetSimulatedLatency(connectionData.SimulatedLatency);
 
 	MessageManager::DisplayMessage("NetPlay", "ConnectedToServer");
 }
@@ -41,6 +50,12 @@ void GameClientConnection::Shutdown()
 
 		_emu->UnregisterInputProvider(this);
 
+		{
+			auto lock = _emu->AcquireLock();
+			_emu->SetNetplayClient(nullptr);
+			ClearRollbackStates();
+		}
+
 		MessageManager::DisplayMessage("NetPlay", "ConnectionLost");
 		_emu->GetSettings()->ClearFlag(EmulationFlags::MaximumSpeed);
 	}
@@ -65,7 +80,19 @@ void GameClientConnection::ClearInputData()
 	for(int i = 0; i < BaseControlDevice::PortCount; i++) {
 		_inputSize[i] = 0;
 		_inputData[i].clear();
+		_confirmedInput[i].clear();
+		_usedInput[i].clear();
+	}
+	_mispredictedPollCounter = UINT32_MAX;
+	_onTimeInputCount = 0;
+}
+
+void GameClientConnection::ClearRollbackStates()
+{
+	for(RollbackState& state : _rollbackStates) {
+		_freeStateBuffers.push_back(std::move(state.Data));
 	}
+	_rollbackStates.clear();
 }
 
 void GameClientConnection::ProcessMessage(NetMessage* message)
@@ -80,19 +107,23 @@ void GameClientConnection::ProcessMessage(NetMessage* message)
 
 		case MessageType::SaveState:
 			if(_gameLoaded) {
-				DisableControllers();
+				SaveStateMessage* saveState = (SaveStateMessage*)message;
+				if(saveState->GetChunkIndex() == 0) {
+					_syncData.clear();
+				}
 
-				auto lock = _emu->AcquireLock();
-				ClearInputData();
-				((SaveStateMessage*)message)->LoadState(_emu);
-				_enableControllers = true;
-				InitControlDevice();
+				vector<uint8_t>& data = saveState->GetData();
+				_syncData.insert(_syncData.end(), data.begin(), data.end());
+				if(saveState->IsLastChunk()) {
+					LoadSyncState(saveState->GetSyncType(), saveState->GetCheats());
+				}
 			}
 			break;
 
 		case MessageType::MovieData:
 			if(_gameLoaded) {
-				PushControllerState(((MovieDataMessage*)message)->GetPortNumber(), ((MovieDataMessage*)message)->GetInputState());
+				MovieDataMessage* movieData = (MovieDataMessage*)message;
+				PushControllerState(movieData->GetPortNumber(), movieData->GetInputState(), movieData->GetPollCounter());
 			}
 			break;
 
@@ -135,6 +166,60 @@ void GameClientConnection::ProcessMessage(NetMessage* message)
 	}
 }
 
+void GameClientConnection::LoadSyncState(StateSyncType syncType, vector<CheatCode>& cheats)
+{
+	vector<uint8_t> state;
+	bool result = CompressionHelper::Decompress(_syncData, state);
+	_syncData.clear();
+	if(result) {
+		if(syncType == StateSyncType::Delta) {
+			//Only the blocks that changed were sent, apply them to the last state received
+			result = SaveStateMessage::ApplyDelta(_syncState, state);
+		} else {
+			_syncState.swap(state);
+		}
+	}
+
+	if(!result) {
+		//The server will send the entire state once it notices the desync
+		MessageManager::Log("[Netplay] Could not load the state sent by the server.");
+		return;
+	}
+
+	DisableControllers();
+
+	auto lock = _emu->AcquireLock();
+	ClearInputData();
+	_stateRequested = false;
+	_emu->Deserialize(_syncState, true);
+	_emu->GetCheatManager()->SetCheats(cheats);
+
+	//The server sends its input for every poll that follows this state
+	ClearRollbackStates();
+	_confirmedPollCounter = GetPollCounter();
+	_prevFramePollCounter = _confirmedPollCounter;
+	if(_rollbackMode) {
+		//Clients in delay mode run frames normally (and can use run-ahead)
+		_emu->SetNetplayClient(this);
+	}
+
+	_enableControllers = true;
+	InitControlDevice();
+}
+
+uint32_t GameClientConnection::GetStateHash()
+{
+	//The server hashes its state with the keyed binary format - positional snapshots are not meant to be compared between processes
+	_emu->Serialize(_hashState, false, SerializeFormat::Binary);
+	return CRC32::GetCRC(_hashState);
+}
+
+void GameClientConnection::SendStateHash(uint32_t pollCounter, uint32_t hash)
+{
+	StateHashMessage message(pollCounter, hash);
+	SendNetMessage(message);
+}
+
 bool GameClientConnection::AttemptLoadGame(string filename, uint32_t crc32)
 {
 	if(filename.size() > 0) {
@@ -148,9 +233,38 @@ bool GameClientConnection::AttemptLoadGame(string filename, uint32_t crc32)
 	return false;
 }
 
-void GameClientConnection::PushControllerState(uint8_t port, ControlDeviceState state)
+void GameClientConnection::PushControllerState(uint8_t port, ControlDeviceState state, uint32_t pollCounter)
 {
 	LockHandler lock = _writeLock.AcquireSafe();
+	if(_rollbackMode) {
+		_confirmedInput[port][pollCounter] = state;
+		_confirmedPollCounter = std::max(_confirmedPollCounter, pollCounter);
+
+		auto used = _usedInput[port].find(pollCounter);
+		if(used != _usedInput[port].end() && used->second != state) {
+			//The input used for this poll was incorrect, the emulation needs to be rolled back
+			if(port == _controllerPort.Port && _mispredictedPollCounter == UINT32_MAX && _inputLead < MaxRollbackFrames - 1) {
+				//Our own input reached the server too late - run further ahead of the server
+				_inputLead++;
+				_onTimeInputCount = 0;
+			}
+			_mispredictedPollCounter = std::min(_mispredictedPollCounter, pollCounter);
+		} else if(used != _usedInput[port].end() && port == _controllerPort.Port) {
+			auto confirmed = _confirmedInput[port].find(pollCounter);
+			if(confirmed != _confirmedInput[port].begin() && std::prev(confirmed)->second != state) {
+				//Our input changed on this poll and the server received it in time
+				_onTimeInputCount++;
+				if(_onTimeInputCount >= InputLeadDecayCount && _inputLead > MinInputLead) {
+					//Input keeps arriving in time, try running closer to the server to reduce rollbacks
+					_inputLead--;
+					_onTimeInputCount = 0;
+				}
+			}
+		}
+		_waitForMovieData.Signal();
+		return;
+	}
+
 	_inputData[port].push_back(state);
 	_inputSize[port]++;
 
@@ -167,11 +281,16 @@ void GameClientConnection::DisableControllers()
 	for(int i = 0; i < BaseControlDevice::PortCount; i++) {
 		_waitForInput[i].Signal();
 	}
+	_waitForMovieData.Signal();
 }
 
 bool GameClientConnection::SetInput(BaseControlDevice *device)
 {
 	if(_enableControllers) {
+		if(_rollbackMode) {
+			return SetRollbackInput(device);
+		}
+
 		uint8_t port = device->GetPort();
 		while(_inputSize[port] == 0) {
 			_waitForInput[port].Wait();
@@ -207,6 +326,274 @@ bool GameClientConnection::SetInput(BaseControlDevice *device)
 	return true;
 }
 
+uint32_t GameClientConnection::GetPollCounter()
+{
+	shared_ptr<IConsole> console = _emu->GetConsole();
+	return console ? console->GetControlManager()->GetPollCounter() : 0;
+}
+
+BaseControlDevice* GameClientConnection::GetLocalDevice(BaseControlDevice* device, IControllerHub* hub)
+{
+	if(device->GetPort() != _controllerPort.Port) {
+		return nullptr;
+	}
+
+	//When the port has a hub/multitap, the selected controller is one of the hub's sub ports
+	BaseControlDevice* localDevice = nullptr;
+	if(hub) {
+		if(_controllerPort.SubPort < hub->GetHubPortCount()) {
+			localDevice = hub->GetController(_controllerPort.SubPort).get();
+		}
+	} else if(_controllerPort.SubPort == 0) {
+		localDevice = device;
+	}
+
+	return localDevice && localDevice->GetControllerType() == _controllerType ? localDevice : nullptr;
+}
+
+bool GameClientConnection::SetRollbackInput(BaseControlDevice* device)
+{
+	uint8_t port = device->GetPort();
+	uint32_t pollCounter = GetPollCounter();
+
+	//The server sends the hub's full state, while this client only sends the state of its own sub port
+	IControllerHub* hub = dynamic_cast<IControllerHub*>(device);
+	BaseControlDevice* localDevice = GetLocalDevice(device, hub);
+	bool isLocalPort = localDevice != nullptr;
+
+	ControlDeviceState localState;
+	bool sendInput = false;
+	ControlDeviceState state;
+	{
+		LockHandler lock = _writeLock.AcquireSafe();
+		auto used = _usedInput[port].find(pollCounter);
+		if(isLocalPort) {
+			if(used == _usedInput[port].end()) {
+				//First time this poll is emulated, read the local input and send it to the server
+				sendInput = GetLocalInput(localState);
+			} else if(hub) {
+				//Frame is being emulated again after a rollback, use the same input as the first time
+				device->SetRawState(used->second);
+				localState = localDevice->GetRawState();
+			} else {
+				//Frame is being emulated again after a rollback, use the same input as the first time
+				localState = used->second;
+			}
+		}
+
+		//Find the most recent input received from the server for this poll (or a previous one)
+		std::map<uint32_t, ControlDeviceState>& confirmedInput = _confirmedInput[port];
+		auto confirmed = confirmedInput.upper_bound(pollCounter);
+		bool hasConfirmedInput = confirmed != confirmedInput.begin();
+		if(hasConfirmedInput) {
+			confirmed--;
+		}
+
+		if(hasConfirmedInput && confirmed->first == pollCounter) {
+			//The server's input for this poll has been received already
+			state = confirmed->second;
+		} else if(isLocalPort && !hub) {
+			state = localState;
+		} else if(hasConfirmedInput) {
+			//Predict that the remote player's input hasn't changed since the last input received
+			state = confirmed->second;
+		} else {
+			device->ClearState();
+			state = device->GetRawState();
+		}
+
+		if(isLocalPort && hub) {
+			//Replace the local sub port's state in the hub's state with the local input
+			device->SetRawState(state);
+			localDevice->SetRawState(localState);
+			hub->RefreshHubState();
+			_usedInput[port][pollCounter] = device->GetRawState();
+			if(!hasConfirmedInput || confirmed->first != pollCounter) {
+				state = _usedInput[port][pollCounter];
+			}
+		} else {
+			_usedInput[port][pollCounter] = isLocalPort ? localState : state;
+		}
+	}
+
+	if(sendInput && _lastInputSent != localState) {
+		InputDataMessage message(localState, pollCounter);
+		SendNetMessage(message);
+		_lastInputSent = localState;
+	}
+
+	device->SetRawState(state);
+	return true;
+}
+
+bool GameClientConnection::WaitForRollbackInput()
+{
+	if(!_rollbackMode || !_enableControllers) {
+		return true;
+	}
+
+	//Wait for up to 2 frames before running the next frame anyway
+	int frameTime = std::max(1, (int)std::ceil(1000 / _emu->GetFps()));
+
+	uint32_t pollCounter = GetPollCounter();
+	for(int i = 0; i < 2; i++) {
+		int64_t lead;
+		int64_t inputLead;
+		{
+			LockHandler lock = _writeLock.AcquireSafe();
+			lead = (int64_t)pollCounter - _confirmedPollCounter;
+			inputLead = _inputLead;
+		}
+
+		if(lead + 1 < inputLead) {
+			//Not far enough ahead of the server for our input to reach it in time, catch up
+			_emu->GetSettings()->SetFlag(EmulationFlags::MaximumSpeed);
+		} else {
+			_emu->GetSettings()->ClearFlag(EmulationFlags::MaximumSpeed);
+		}
+
+		if(lead <= inputLead && _rollbackStates.size() <= MaxRollbackFrames) {
+			return true;
+		}
+
+		//Too far ahead of the server, wait for its input before running the next frame
+		_waitForMovieData.Wait(frameTime);
+		if(_shutdown || !_enableControllers) {
+			return true;
+		}
+		PruneRollbackStates();
+	}
+	return false;
+}
+
+bool GameClientConnection::GetRollbackState(vector<uint8_t>& state, uint32_t& frameCount)
+{
+	if(!_rollbackMode || !_enableControllers || _rollbackStates.empty()) {
+		return false;
+	}
+
+	uint32_t mispredictedPollCounter;
+	{
+		LockHandler lock = _writeLock.AcquireSafe();
+		mispredictedPollCounter = _mispredictedPollCounter;
+		_mispredictedPollCounter = UINT32_MAX;
+	}
+
+	if(mispredictedPollCounter == UINT32_MAX) {
+		return false;
+	}
+
+	if(_rollbackStates[0].PollCounter > mispredictedPollCounter) {
+		//The incorrect input was used before the oldest state that was kept, rolling back can't fix it
+		if(!_stateRequested) {
+			MessageManager::Log("[Netplay] Could not roll back far enough, requesting the server's state.");
+			RequestStateMessage message(mispredictedPollCounter);
+			SendNetMessage(message);
+			_stateRequested = true;
+		}
+		return false;
+	}
+
+	//Find the last state saved before the incorrect input was used
+	size_t index = 0;
+	while(index + 1 < _rollbackStates.size() && _rollbackStates[index + 1].PollCounter <= mispredictedPollCounter) {
+		index++;
+	}
+
+	frameCount = (uint32_t)(_rollbackStates.size() - index);
+	state.swap(_rollbackStates[index].Data);
+	_prevFramePollCounter = _rollbackStates[index].PrevPollCounter;
+
+	//The states for the frames that will be run again are saved again as they are emulated
+	while(_rollbackStates.size() > index) {
+		_freeStateBuffers.push_back(std::move(_rollbackStates.back().Data));
+		_rollbackStates.pop_back();
+	}
+	return true;
+}
+
+void GameClientConnection::PruneRollbackStates()
+{
+	uint32_t oldestPollCounter;
+	{
+		LockHandler lock = _writeLock.AcquireSafe();
+
+		//Keep the last state saved before the first poll that could still be mispredicted
+		uint32_t pollCounter = std::min(_confirmedPollCounter, _mispredictedPollCounter);
+		while(_rollbackStates.size() > 1 && _rollbackStates[1].PollCounter <= pollCounter) {
+			if(_rollbackStates.front().NeedHash && !_rollbackStates.front().HashSent) {
+				SendStateHash(_rollbackStates.front().PollCounter, _rollbackStates.front().Hash);
+			}
+			_freeStateBuffers.push_back(std::move(_rollbackStates.front().Data));
+			_rollbackStates.pop_front();
+		}
+
+		if(!_rollbackStates.empty()) {
+			RollbackState& oldest = _rollbackStates.front();
+			if(oldest.NeedHash && !oldest.HashSent && oldest.PollCounter <= pollCounter) {
+				//All the inputs used before this state are confirmed, send its hash to the server to validate it
+				SendStateHash(oldest.PollCounter, oldest.Hash);
+				oldest.HashSent = true;
+			}
+		}
+
+		oldestPollCounter = _rollbackStates.empty() ? pollCounter : _rollbackStates.front().PollCounter;
+		for(int i = 0; i < BaseControlDevice::PortCount; i++) {
+			//Keep the most recent confirmed input before the oldest state (used for predictions)
+			std::map<uint32_t, ControlDeviceState>& confirmed = _confirmedInput[i];
+			while(confirmed.size() > 1 && std::next(confirmed.begin())->first <= oldestPollCounter) {
+				confirmed.erase(confirmed.begin());
+			}
+
+			std::map<uint32_t, ControlDeviceState>& used = _usedInput[i];
+			while(!used.empty() && used.begin()->first < oldestPollCounter) {
+				used.erase(used.begin());
+			}
+		}
+	}
+}
+
+void GameClientConnection::SaveFrameState()
+{
+	if(!_enableControllers) {
+		return;
+	}
+
+	if(!_rollbackMode) {
+		//Every frame only uses the server's input, periodically send the hash of the state to the server
+		uint32_t pollCounter = GetPollCounter();
+		if(StateHashMessage::IsHashedFrame(_prevFramePollCounter, pollCounter)) {
+			SendStateHash(pollCounter, GetStateHash());
+		}
+		_prevFramePollCounter = pollCounter;
+		return;
+	}
+
+	PruneRollbackStates();
+	if(_rollbackStates.size() > MaxRollbackFrames) {
+		//Can't wait for the server any longer, older frames can no longer be rolled back
+		_freeStateBuffers.push_back(std::move(_rollbackStates.front().Data));
+		_rollbackStates.pop_front();
+	}
+
+	RollbackState state;
+	state.PollCounter = GetPollCounter();
+	state.PrevPollCounter = _prevFramePollCounter;
+	state.NeedHash = StateHashMessage::IsHashedFrame(_prevFramePollCounter, state.PollCounter);
+	if(state.NeedHash) {
+		//The hash is sent once the inputs used before this frame are confirmed, it must be computed now
+		state.Hash = GetStateHash();
+	}
+	_prevFramePollCounter = state.PollCounter;
+
+	if(!_freeStateBuffers.empty()) {
+		state.Data = std::move(_freeStateBuffers.back());
+		_freeStateBuffers.pop_back();
+	}
+	_emu->Serialize(state.Data, false);
+	_rollbackStates.push_back(std::move(state));
+}
+
 void GameClientConnection::InitControlDevice()
 {
 	shared_ptr<IConsole> console = _emu->GetConsole();
@@ -232,22 +619,32 @@ void GameClientConnection::ProcessNotification(ConsoleNotificationType type, voi
 	}
 }
 
-void GameClientConnection::SendInput()
+bool GameClientConnection::GetLocalInput(ControlDeviceState& state)
 {
-	if(_gameLoaded) {
-		if(!_controlDevice || _controllerType != _controlDevice->GetControllerType()) {
-			//Pretend we are using port 0 (to use player 1's keybindings during netplay)
-			shared_ptr<IConsole> console = _emu->GetConsole();
-			if(!console) {
-				return;
-			}
-			_controlDevice = console->GetControlManager()->CreateControllerDevice(_controllerType, 0);
+	if(!_controlDevice || _controllerType != _controlDevice->GetControllerType()) {
+		//Pretend we are using port 0 (to use player 1's keybindings during netplay)
+		shared_ptr<IConsole> console = _emu->GetConsole();
+		if(!console) {
+			return false;
 		}
+		_controlDevice = console->GetControlManager()->CreateControllerDevice(_controllerType, 0);
+	}
 
+	state = {};
+	if(_controlDevice) {
+		_controlDevice->SetStateFromInput();
+		state = _controlDevice->GetRawState();
+	}
+	return true;
+}
+
+void GameClientConnection::SendInput()
+{
+	//In rollback mode, input is read and sent by the emulation thread (see SetRollbackInput)
+	if(_gameLoaded && !_rollbackMode) {
 		ControlDeviceState inputState;
-		if(_controlDevice) {
-			_controlDevice->SetStateFromInput();
-			inputState = _controlDevice->GetRawState();
+		if(!GetLocalInput(inputState)) {
+			return;
 		}
 		
 		if(_lastInputSent != inputState) {
@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include <deque>
+#include <map>
 #include "Utilities/AutoResetEvent.h"
 #include "Utilities/SimpleLock.h"
 #include "Shared/BaseControlDevice.h"
@@ -12,10 +13,34 @@
 #include "Netplay/NetplayTypes.h"
 
 class Emulator;
+class IControllerHub;
+struct CheatCode;
+enum class StateSyncType : uint8_t;
 
 class GameClientConnection final : public GameConnection, public INotificationListener, public IInputProvider
 {
 private:
+	static constexpr uint32_t MaxRollbackFrames = 10;
+
+	//How far ahead of the server's input the client runs in rollback mode (see _inputLead)
+	static constexpr uint32_t MinInputLead = 2;
+	//Number of input changes that must reach the server in time before the input lead is reduced
+	static constexpr uint32_t InputLeadDecayCount = 8;
+
+	struct RollbackState
+	{
+		uint32_t PollCounter = 0;
+		uint32_t PrevPollCounter = 0;
+
+		//Only set for the frames whose hash is sent to the server (see StateHashMessage::HashInterval)
+		bool NeedHash = false;
+		bool HashSent = false;
+		uint32_t Hash = 0;
+
+		//Positional snapshot, only used to roll back
+		vector<uint8_t> Data;
+	};
+
 	std::deque<ControlDeviceState> _inputData[BaseControlDevice::PortCount];
 	atomic<uint32_t> _inputSize[BaseControlDevice::PortCount];
 	AutoResetEvent _waitForInput[BaseControlDevice::PortCount];
@@ -34,14 +59,52 @@ private:
 	ClientConnectionData _connectionData = {};
 	string _serverSalt;
 
+	//State sent by the server (compressed chunks received so far, and the last state loaded)
+	vector<uint8_t> _syncData;
+	vector<uint8_t> _syncState;
+	vector<uint8_t> _hashState;
+
+	//Rollback mode: local input is applied immediately, remote input is predicted, and the emulation
+	//is rolled back and re-run when the server's input (MovieData) does not match the prediction
+	bool _rollbackMode = false;
+	AutoResetEvent _waitForMovieData;
+	std::map<uint32_t, ControlDeviceState> _confirmedInput[BaseControlDevice::PortCount];
+	std::map<uint32_t, ControlDeviceState> _usedInput[BaseControlDevice::PortCount];
+	uint32_t _confirmedPollCounter = 0;
+	uint32_t _mispredictedPollCounter = UINT32_MAX;
+
+	//Increased when our own input reaches the server too late, reduced after InputLeadDecayCount input changes arrive in time
+	uint32_t _inputLead = MinInputLead;
+	uint32_t _onTimeInputCount = 0;
+
+	//Set when a full state was requested from the server, cleared when a state is received
+	bool _stateRequested = false;
+
+	//Poll counter at the start of the previous frame, used to find the frames whose state is hashed
+	uint32_t _prevFramePollCounter = 0;
+
+	//Only accessed by the emulation thread (or while the emulation is locked)
+	std::deque<RollbackState> _rollbackStates;
+	vector<vector<uint8_t>> _freeStateBuffers;
+
 private:
 	void SendHandshake();
 	void SendControllerSelection(NetplayControllerInfo controller);
 	void ClearInputData();
-	void PushControllerState(uint8_t port, ControlDeviceState state);
+	void ClearRollbackStates();
+	void LoadSyncState(StateSyncType syncType, vector<CheatCode>& cheats);
+	uint32_t GetStateHash();
+	void SendStateHash(uint32_t pollCounter, uint32_t hash);
+	void PushControllerState(uint8_t port, ControlDeviceState state, uint32_t pollCounter);
 	void DisableControllers();
 	bool AttemptLoadGame(string filename, uint32_t crc32);
 
+	uint32_t GetPollCounter();
+	bool GetLocalInput(ControlDeviceState& state);
+	BaseControlDevice* GetLocalDevice(BaseControlDevice* device, IControllerHub* hub);
+	bool SetRollbackInput(BaseControlDevice* device);
+	void PruneRollbackStates();
+
 protected:
 	void ProcessMessage(NetMessage* message) override;
 
@@ -57,6 +120,10 @@ public:
 	void InitControlDevice();
 	void SendInput();
 
+	bool WaitForRollbackInput();
+	bool GetRollbackState(vector<uint8_t>& state, uint32_t& frameCount);
+	void SaveFrameState();
+
 	void SelectController(NetplayControllerInfo controller);
 	vector<NetplayControllerUsageInfo> GetControllerList();
 	NetplayControllerInfo GetControllerPort();
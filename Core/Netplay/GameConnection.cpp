@@ -10,6 +10,8 @@
 #include "Netplay/ClientConnectionData.h"
 #include "Netplay/ForceDisconnectMessage.h"
 #include "Netplay/ServerInformationMessage.h"
+#include "Netplay/StateHashMessage.h"
+#include "Netplay/RequestStateMessage.h"
 
 GameConnection::GameConnection(Emulator* emu, unique_ptr<Socket> socket)
 {
@@ -20,6 +22,9 @@ GameConnection::GameConnection(Emulator* emu, unique_ptr<Socket> socket)
 GameConnection::~GameConnection()
 {
 	Disconnect();
+	for(auto& delayedMessage : _delayedMessages) {
+		delete delayedMessage.second;
+	}
 }
 
 void GameConnection::ReadSocket()
@@ -69,6 +74,8 @@ NetMessage* GameConnection::ReadMessage()
 				case MessageType::SelectController: return new SelectControllerMessage(_messageBuffer, messageLength);
 				case MessageType::ForceDisconnect: return new ForceDisconnectMessage(_messageBuffer, messageLength);
 				case MessageType::ServerInformation: return new ServerInformationMessage(_messageBuffer, messageLength);
+				case MessageType::StateHash: return new StateHashMessage(_messageBuffer, messageLength);
+				case MessageType::RequestState: return new RequestStateMessage(_messageBuffer, messageLength);
 			}
 		}
 	}
@@ -92,13 +99,34 @@ bool GameConnection::ConnectionError()
 	return _socket->ConnectionError();
 }
 
+void GameConnection::SetSimulatedLatency(uint32_t latency)
+{
+	_simulatedLatency = latency;
+}
+
+void GameConnection::ProcessReceivedMessage(NetMessage* message)
+{
+	message->Initialize();
+	ProcessMessage(message);
+	delete message;
+}
+
 void GameConnection::ProcessMessages()
 {
 	NetMessage* message;
 	while((message = ReadMessage()) != nullptr) {
 		//Loop until all messages have been processed
-		message->Initialize();
-		ProcessMessage(message);
-		delete message;
-	}		
+		if(_simulatedLatency > 0 || !_delayedMessages.empty()) {
+			_delayedMessages.push_back({ _latencyTimer.GetElapsedMS() + _simulatedLatency, message });
+		} else {
+			ProcessReceivedMessage(message);
+		}
+	}
+
+	double now = _latencyTimer.GetElapsedMS();
+	while(!_delayedMessages.empty() && _delayedMessages.front().first <= now) {
+		message = _delayedMessages.front().second;
+		_delayedMessages.pop_front();
+		ProcessReceivedMessage(message);
+	}
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include "Utilities/SimpleLock.h"
+#include "Utilities/Timer.h"
 
 class Socket;
 class NetMessage;
@@ -19,11 +20,17 @@ protected:
 	int _readPosition = 0;
 	SimpleLock _socketLock;
 
+	//Artificial latency applied to received messages (used to test netplay over a local connection)
+	uint32_t _simulatedLatency = 0;
+	Timer _latencyTimer;
+	std::deque<std::pair<double, NetMessage*>> _delayedMessages;
+
 private:
 	void ReadSocket();
 
 	bool ExtractMessage(void *buffer, uint32_t &messageLength);
 	NetMessage* ReadMessage();
+	void ProcessReceivedMessage(NetMessage* message);
 
 	virtual void ProcessMessage(NetMessage* message) = 0;
 
@@ -36,6 +43,7 @@ public:
 	virtual ~GameConnection();
 
 	bool ConnectionError();
+	void SetSimulatedLatency(uint32_t latency);
 	void ProcessMessages();
 	void SendNetMessage(NetMessage &message);
 };
\ No newline at end of file
@@ -2,18 +2,22 @@
 #include "Netplay/GameServer.h"
 #include "Netplay/GameServerConnection.h"
 #include "Netplay/PlayerListMessage.h"
+#include "Netplay/StateHashMessage.h"
 #include "Shared/Emulator.h"
 #include "Shared/BaseControlManager.h"
 #include "Shared/NotificationManager.h"
 #include "Shared/MessageManager.h"
 #include "Utilities/Socket.h"
 #include "Shared/ControllerHub.h"
+#include "Utilities/CRC32.h"
+#include "Utilities/Serializer.h"
 
 GameServer::GameServer(Emulator* emu)
 {
 	_emu = emu;
 	_stop = false;
 	_initialized = false;
+	_hashStates = false;
 	_hostControllerPort = {};
 }
 
@@ -48,12 +52,16 @@ void GameServer::UpdateConnections()
 			_openConnections.erase(_openConnections.begin() + i);
 		} else {
 			_openConnections[i]->ProcessMessages();
+			_openConnections[i]->SendPendingState();
 		}
 	}
+	_hashStates = !_openConnections.empty();
 }
 
 bool GameServer::SetInput(BaseControlDevice *device)
 {
+	shared_ptr<IConsole> console = _emu->GetConsole();
+	uint32_t pollCounter = console ? console->GetControlManager()->GetPollCounter() : 0;
 	uint8_t port = device->GetPort();
 	IControllerHub* hub = dynamic_cast<IControllerHub*>(device);
 	if(hub) {
@@ -63,7 +71,7 @@ bool GameServer::SetInput(BaseControlDevice *device)
 			if(connection) {
 				shared_ptr<BaseControlDevice> hubController = hub->GetController(i);
 				if(hubController) {
-					hubController->SetRawState(connection->GetState());
+					hubController->SetRawState(connection->GetState(pollCounter));
 				}
 			}
 		}
@@ -73,7 +81,7 @@ bool GameServer::SetInput(BaseControlDevice *device)
 		GameServerConnection* connection = GetNetPlayDevice(controller);
 		if(connection) {
 			//Device is controlled by a client
-			device->SetRawState(connection->GetState());
+			device->SetRawState(connection->GetState(pollCounter));
 			return true;
 		}
 	}
@@ -82,13 +90,63 @@ bool GameServer::SetInput(BaseControlDevice *device)
 	return false;
 }
 
+void GameServer::ProcessEndOfFrame()
+{
+	if(!_hashStates) {
+		return;
+	}
+
+	shared_ptr<IConsole> console = _emu->GetConsole();
+	if(!console) {
+		return;
+	}
+
+	//Called between frames - this is the state clients hash before running the next frame
+	uint32_t pollCounter = console->GetControlManager()->GetPollCounter();
+	bool hashFrame = StateHashMessage::IsHashedFrame(_prevFramePollCounter, pollCounter);
+	_prevFramePollCounter = pollCounter;
+	if(!hashFrame) {
+		return;
+	}
+
+	//Clients hash their states with the same (keyed binary) format
+	_emu->Serialize(_hashState, false, SerializeFormat::Binary);
+	uint32_t hash = CRC32::GetCRC(_hashState);
+
+	auto lock = _hashLock.AcquireSafe();
+	_stateHashes.push_back({ pollCounter, hash });
+	if(_stateHashes.size() > GameServer::MaxStateHashes) {
+		_stateHashes.pop_front();
+	}
+}
+
+StateHashResult GameServer::CheckStateHash(uint32_t pollCounter, uint32_t hash)
+{
+	auto lock = _hashLock.AcquireSafe();
+	bool found = false;
+	for(auto& stateHash : _stateHashes) {
+		if(stateHash.first == pollCounter) {
+			//Several frames can have the same poll counter (frames where input wasn't polled), any of them can match
+			if(stateHash.second == hash) {
+				return StateHashResult::Valid;
+			}
+			found = true;
+		}
+	}
+
+	//Frames that are too old (or not emulated yet) can't be validated
+	return found ? StateHashResult::Invalid : StateHashResult::Unknown;
+}
+
 void GameServer::RecordInput(vector<shared_ptr<BaseControlDevice>> devices)
 {
+	shared_ptr<IConsole> console = _emu->GetConsole();
+	uint32_t pollCounter = console ? console->GetControlManager()->GetPollCounter() : 0;
 	for(shared_ptr<BaseControlDevice> &device : devices) {
 		for(unique_ptr<GameServerConnection>& connection : _openConnections) {
 			if(!connection->ConnectionError()) {
-				//Send movie stream
-				connection->SendMovieData(device->GetPort(), device->GetRawState());
+				//Send movie stream (tagged with the poll counter, used by clients in rollback mode)
+				connection->SendMovieData(device->GetPort(), device->GetRawState(), pollCounter);
 			}
 		}
 	}
@@ -104,6 +162,12 @@ void GameServer::ProcessNotification(ConsoleNotificationType type, void * parame
 		//Register the server as an input provider/recorder
 		RegisterServerInput();
 	}
+
+	if(type == ConsoleNotificationType::GameLoaded || type == ConsoleNotificationType::StateLoaded || type == ConsoleNotificationType::GameReset) {
+		//Poll counters before this point no longer match the current state
+		auto lock = _hashLock.AcquireSafe();
+		_stateHashes.clear();
+	}
 }
 
 void GameServer::Exec()
@@ -151,6 +215,11 @@ void GameServer::StopServer()
 
 	_openConnections.clear();
 	_initialized = false;
+	_hashStates = false;
+	{
+		auto lock = _hashLock.AcquireSafe();
+		_stateHashes.clear();
+	}
 	_listener.reset();
 	MessageManager::DisplayMessage("NetPlay", "ServerStopped");
 
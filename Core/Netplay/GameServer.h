@@ -1,15 +1,26 @@
 #pragma once
 #include "pch.h"
 #include <thread>
+#include <deque>
 #include "Netplay/GameServerConnection.h"
 #include "Netplay/NetplayTypes.h"
 #include "Shared/Interfaces/INotificationListener.h"
 #include "Shared/Interfaces/IInputProvider.h"
 #include "Shared/Interfaces/IInputRecorder.h"
 #include "Shared/IControllerHub.h"
+#include "Utilities/SimpleLock.h"
 
 class Emulator;
 
+enum class StateHashResult
+{
+	Valid,
+	Invalid,
+
+	//The server has no hash for this poll counter (too old, or not emulated yet)
+	Unknown
+};
+
 class GameServer : public IInputRecorder, public IInputProvider, public INotificationListener, public std::enable_shared_from_this<GameServer>
 {
 private:
@@ -26,6 +37,15 @@ private:
 
 	NetplayControllerInfo _hostControllerPort = {};
 
+	//Hash of the state at the start of the last few hashed frames (by poll counter, see StateHashMessage::HashInterval),
+	//compared with the clients' hashes to detect desyncs
+	static constexpr uint32_t MaxStateHashes = 600;
+	atomic<bool> _hashStates;
+	SimpleLock _hashLock;
+	std::deque<std::pair<uint32_t, uint32_t>> _stateHashes;
+	vector<uint8_t> _hashState;
+	uint32_t _prevFramePollCounter = 0;
+
 	void AcceptConnections();
 	void UpdateConnections();
 
@@ -49,6 +69,9 @@ public:
 	
 	static vector<NetplayControllerUsageInfo> GetControllerList(Emulator* emu, vector<PlayerInfo>& players);
 
+	void ProcessEndOfFrame();
+	StateHashResult CheckStateHash(uint32_t pollCounter, uint32_t hash);
+
 	bool SetInput(BaseControlDevice *device) override;
 	void RecordInput(vector<shared_ptr<BaseControlDevice>> devices) override;
 
@@ -12,11 +12,16 @@
 #include "Netplay/GameServer.h"
 #include "Netplay/ForceDisconnectMessage.h"
 #include "Netplay/ServerInformationMessage.h"
+#include "Netplay/StateHashMessage.h"
+#include "Netplay/RequestStateMessage.h"
 #include "Netplay/NetplayTypes.h"
 #include "Shared/MessageManager.h"
 #include "Shared/Emulator.h"
 #include "Shared/EmuSettings.h"
 #include "Shared/BaseControlDevice.h"
+#include "Shared/BaseControlManager.h"
+#include "Shared/CheatManager.h"
+#include "Utilities/CompressionHelper.h"
 
 GameServerConnection::GameServerConnection(GameServer* gameServer, Emulator* emu, unique_ptr<Socket> socket, string serverPassword) : GameConnection(emu, std::move(socket))
 {
@@ -24,6 +29,7 @@ GameServerConnection::GameServerConnection(GameServer* gameServer, Emulator* emu
 	_server = gameServer;
 	_serverPassword = serverPassword;
 	_controllerPort = NetplayControllerInfo { GameConnection::SpectatorPort, 0 };
+	_needGameInformation = false;
 	SendServerInformation();
 }
 
@@ -52,20 +58,123 @@ void GameServerConnection::SendServerInformation()
 
 void GameServerConnection::SendGameInformation()
 {
-	auto lock = _emu->AcquireLock();
-	RomInfo romInfo = _emu->GetRomInfo();
-	GameInformationMessage gameInfo(romInfo.RomFile.GetFileName(), _emu->GetCrc32(), _controllerPort, _emu->IsPaused());
-	SendNetMessage(gameInfo);
-	SaveStateMessage saveState(_emu);
-	SendNetMessage(saveState);
+	SendState(true, false);
 }
 
-void GameServerConnection::SendMovieData(uint8_t port, ControlDeviceState state)
+void GameServerConnection::SendState(bool sendGameInformation, bool forceFullState)
 {
-	if(_handshakeCompleted) {
-		MovieDataMessage message(state, port);
+	vector<uint8_t> state;
+	vector<CheatCode> cheats;
+	uint32_t crc32;
+	{
+		auto lock = _emu->AcquireLock();
+		if(sendGameInformation) {
+			RomInfo romInfo = _emu->GetRomInfo();
+			GameInformationMessage gameInfo(romInfo.RomFile.GetFileName(), _emu->GetCrc32(), _controllerPort, _emu->IsPaused());
+			SendNetMessage(gameInfo);
+		}
+
+		shared_ptr<IConsole> console = _emu->GetConsole();
+		if(!console) {
+			return;
+		}
+
+		{
+			//Inputs sent for the previous state are no longer relevant
+			auto inputLock = _inputLock.AcquireSafe();
+			_pendingInput.clear();
+			_syncPollCounter = console->GetControlManager()->GetPollCounter();
+		}
+
+		//Only take a snapshot while the emulation is paused, it is compressed and sent after the lock is released
+		//The client loads it in another process, so the keyed binary format must be used (not the positional one)
+		_emu->Serialize(state, true, SerializeFormat::Binary);
+		cheats = _emu->GetCheatManager()->GetCheats();
+		crc32 = _emu->GetCrc32();
+
+		_stateLock.Acquire();
+		auto movieDataLock = _movieDataLock.AcquireSafe();
+		_sendingState = true;
+	}
+
+	SendStateChunks(state, cheats, crc32, forceFullState);
+
+	{
+		auto movieDataLock = _movieDataLock.AcquireSafe();
+		for(QueuedMovieData& data : _queuedMovieData) {
+			MovieDataMessage message(data.State, data.Port, data.PollCounter);
+			SendNetMessage(message);
+		}
+		_queuedMovieData.clear();
+		_sendingState = false;
+	}
+	_stateLock.Release();
+}
+
+void GameServerConnection::SendStateChunks(vector<uint8_t>& state, vector<CheatCode>& cheats, uint32_t crc32, bool forceFullState)
+{
+	//Only send the blocks that changed since the last state sent, if the client has a state for the same game
+	StateSyncType syncType = StateSyncType::Full;
+	vector<uint8_t> compressedState;
+	if(!forceFullState && _syncCrc32 == crc32 && _syncState.size() == state.size()) {
+		vector<uint8_t> delta;
+		SaveStateMessage::EncodeDelta(_syncState, state, delta);
+		CompressionHelper::CompressFast(delta.data(), delta.size(), compressedState);
+		syncType = StateSyncType::Delta;
+	} else {
+		CompressionHelper::CompressFast(state.data(), state.size(), compressedState);
+	}
+
+	uint32_t size = (uint32_t)compressedState.size();
+	uint32_t chunkCount = (size + SaveStateMessage::ChunkSize - 1) / SaveStateMessage::ChunkSize;
+	for(uint32_t i = 0; i < chunkCount; i++) {
+		uint32_t start = i * SaveStateMessage::ChunkSize;
+		uint32_t chunkSize = std::min(SaveStateMessage::ChunkSize, size - start);
+		bool isLastChunk = i == chunkCount - 1;
+		SaveStateMessage message(syncType, i, chunkCount, compressedState.data() + start, chunkSize, isLastChunk ? cheats : vector<CheatCode>());
 		SendNetMessage(message);
 	}
+
+	_syncState.swap(state);
+	_syncCrc32 = crc32;
+}
+
+void GameServerConnection::SendMovieData(uint8_t port, ControlDeviceState state, uint32_t pollCounter)
+{
+	if(_handshakeCompleted) {
+		auto lock = _movieDataLock.AcquireSafe();
+		if(_sendingState) {
+			//The client needs to receive the entire state before the input that follows it
+			_queuedMovieData.push_back({ port, state, pollCounter });
+		} else {
+			MovieDataMessage message(state, port, pollCounter);
+			SendNetMessage(message);
+		}
+	}
+}
+
+void GameServerConnection::ProcessStateHash(StateHashMessage* message)
+{
+	if(_hashCheckDisabled || message->GetPollCounter() < _syncPollCounter) {
+		//Ignore frames that were emulated before the client loaded the last state sent
+		return;
+	}
+
+	switch(_server->CheckStateHash(message->GetPollCounter(), message->GetHash())) {
+		case StateHashResult::Valid: _hashMismatchCount = 0; return;
+		case StateHashResult::Unknown: return; //Can't be validated, wait for the next hash
+		case StateHashResult::Invalid: break;
+	}
+
+	_hashMismatchCount++;
+	if(_hashMismatchCount <= 2) {
+		//Desync, send the blocks that changed since the last sync - if this doesn't fix it, send the entire state
+		MessageManager::Log("[Netplay] Client desync detected, sending state.");
+		SendState(false, _hashMismatchCount == 2);
+	} else {
+		MessageManager::Log("[Netplay] Client state still differs after a full sync, desync detection disabled for this client.");
+		_hashCheckDisabled = true;
+	}
 }
 
 void GameServerConnection::SendForceDisconnectMessage(string disconnectMessage)
@@ -75,17 +184,32 @@ void GameServerConnection::SendForceDisconnectMessage(string disconnectMessage)
 	Disconnect();
 }
 
-void GameServerConnection::PushState(ControlDeviceState state)
+void GameServerConnection::PushState(ControlDeviceState state, uint32_t pollCounter)
 {
 	auto lock = _inputLock.AcquireSafe();
-	_inputData = state;
+	if(pollCounter == 0) {
+		_pendingInput.clear();
+		_inputData = state;
+	} else if(pollCounter > _syncPollCounter) {
+		//Clients only send input for polls they haven't emulated yet, so a lower poll counter means the client
+		//loaded a state that was sent to it - the input queued after that poll was sent before the resync, drop it
+		while(!_pendingInput.empty() && _pendingInput.back().first >= pollCounter) {
+			_pendingInput.pop_back();
+		}
+		_pendingInput.push_back({ pollCounter, state });
+	}
 }
 
-ControlDeviceState GameServerConnection::GetState()
+ControlDeviceState GameServerConnection::GetState(uint32_t pollCounter)
 {
 	ControlDeviceState stateData;
 	{
 		auto lock = _inputLock.AcquireSafe();
+		while(!_pendingInput.empty() && _pendingInput.front().first <= pollCounter) {
+			//Input arrived in time (or late, in which case it is applied right away)
+			_inputData = _pendingInput.front().second;
+			_pendingInput.pop_front();
+		}
 		stateData = _inputData;
 	}
 	return stateData;
@@ -130,7 +254,24 @@ void GameServerConnection::ProcessMessage(NetMessage* message)
 				SendForceDisconnectMessage("Handshake has not been completed - invalid packet");
 				return;
 			}
-			PushState(((InputDataMessage*)message)->GetInputState());
+			PushState(((InputDataMessage*)message)->GetInputState(), ((InputDataMessage*)message)->GetPollCounter());
+			break;
+
+		case MessageType::StateHash:
+			if(!_handshakeCompleted) {
+				SendForceDisconnectMessage("Handshake has not been completed - invalid packet");
+				return;
+			}
+			ProcessStateHash((StateHashMessage*)message);
+			break;
+
+		case MessageType::RequestState:
+			if(!_handshakeCompleted) {
+				SendForceDisconnectMessage("Handshake has not been completed - invalid packet");
+				return;
+			}
+			MessageManager::Log("[Netplay] Client could not roll back to poll " + std::to_string(((RequestStateMessage*)message)->GetPollCounter()) + ", sending state.");
+			SendState(false, true);
 			break;
 
 		case MessageType::SelectController:
@@ -180,7 +321,7 @@ void GameServerConnection::ProcessNotification(ConsoleNotificationType type, voi
 		case ConsoleNotificationType::StateLoaded:
 		case ConsoleNotificationType::CheatsChanged:
 		case ConsoleNotificationType::ConfigChanged:
-			SendGameInformation();
+			_needGameInformation = true;
 			break;
 		
 		case ConsoleNotificationType::PpuFrameDone: {
@@ -193,7 +334,7 @@ void GameServerConnection::ProcessNotification(ConsoleNotificationType type, voi
 			s.SaveTo(currentConfig, 0);
 
 			if(_previousConfig != currentConfig.str()) {
-				SendGameInformation();
+				_needGameInformation = true;
 			}
 			_previousConfig = currentConfig.str();
 			break;
@@ -211,6 +352,14 @@ void GameServerConnection::ProcessNotification(ConsoleNotificationType type, voi
 	}
 }
 
+void GameServerConnection::SendPendingState()
+{
+	//Called by the server thread - serializing, compressing and sending the state is too slow for the emulation thread
+	if(_needGameInformation.exchange(false) && _handshakeCompleted) {
+		SendGameInformation();
+	}
+}
+
 NetplayControllerInfo GameServerConnection::GetControllerPort()
 {
 	return _controllerPort;
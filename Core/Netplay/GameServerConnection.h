@@ -9,7 +9,9 @@
 #include "Utilities/SimpleLock.h"
 
 class HandShakeMessage;
+class StateHashMessage;
 class GameServer;
+struct CheatCode;
 
 class GameServerConnection final : public GameConnection, public INotificationListener
 {
@@ -18,17 +20,45 @@ private:
 
 	SimpleLock _inputLock;
 	ControlDeviceState _inputData = {};
+	//Inputs sent by rollback clients, applied once the emulation reaches the poll they were sent for (sorted by poll counter)
+	std::deque<std::pair<uint32_t, ControlDeviceState>> _pendingInput;
 
 	string _previousConfig = "";
 
+	struct QueuedMovieData
+	{
+		uint8_t Port;
+		ControlDeviceState State;
+		uint32_t PollCounter;
+	};
+
+	//Movie data is queued while a state is being sent, and sent once the client has the entire state
+	SimpleLock _movieDataLock;
+	bool _sendingState = false;
+	vector<QueuedMovieData> _queuedMovieData;
+
+	//Last (uncompressed) state sent to the client, used to only send the blocks that changed on the next sync
+	SimpleLock _stateLock;
+	vector<uint8_t> _syncState;
+	uint32_t _syncCrc32 = 0;
+	uint32_t _syncPollCounter = 0;
+	uint32_t _hashMismatchCount = 0;
+	bool _hashCheckDisabled = false;
+
 	NetplayControllerInfo _controllerPort = {};
 	string _connectionHash;
 	string _serverPassword;
 	bool _handshakeCompleted = false;
 
-	void PushState(ControlDeviceState state);
+	//Set by notifications (which can be sent by the emulation thread), the state is sent by the server thread
+	atomic<bool> _needGameInformation;
+
+	void PushState(ControlDeviceState state, uint32_t pollCounter);
 	void SendServerInformation();
 	void SendGameInformation();
+	void SendState(bool sendGameInformation, bool forceFullState);
+	void SendStateChunks(vector<uint8_t>& state, vector<CheatCode>& cheats, uint32_t crc32, bool forceFullState);
+	void ProcessStateHash(StateHashMessage* message);
 	void SelectControllerPort(NetplayControllerInfo port);
 
 	void SendForceDisconnectMessage(string disconnectMessage);
@@ -42,8 +72,9 @@ public:
 	GameServerConnection(GameServer* gameServer, Emulator* emu, unique_ptr<Socket> socket, string serverPassword);
 	virtual ~GameServerConnection();
 
-	ControlDeviceState GetState();
-	void SendMovieData(uint8_t port, ControlDeviceState state);
+	ControlDeviceState GetState(uint32_t pollCounter);
+	void SendMovieData(uint8_t port, ControlDeviceState state, uint32_t pollCounter);
+	void SendPendingState();
 
 	NetplayControllerInfo GetControllerPort();
 
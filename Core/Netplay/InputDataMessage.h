@@ -7,23 +7,32 @@ class InputDataMessage : public NetMessage
 {
 private:
 	ControlDeviceState _inputState;
+	uint32_t _pollCounter = 0;
 
 protected:	
 	void Serialize(Serializer &s) override
 	{
 		SVVector(_inputState.State);
+		SV(_pollCounter);
 	}
 
 public:
 	InputDataMessage(void* buffer, uint32_t length) : NetMessage(buffer, length) { }
 
-	InputDataMessage(ControlDeviceState inputState) : NetMessage(MessageType::InputData)
+	//pollCounter is the input poll this state should be applied to (0 = as soon as possible)
+	InputDataMessage(ControlDeviceState inputState, uint32_t pollCounter = 0) : NetMessage(MessageType::InputData)
 	{
 		_inputState = inputState;
+		_pollCounter = pollCounter;
 	}
 
 	ControlDeviceState GetInputState()
 	{
 		return _inputState;
 	}
+
+	uint32_t GetPollCounter()
+	{
+		return _pollCounter;
+	}
 };
\ No newline at end of file
@@ -8,21 +8,24 @@ class MovieDataMessage : public NetMessage
 private:
 	uint8_t _portNumber = 0;
 	ControlDeviceState _inputState = {};
+	uint32_t _pollCounter = 0;
 
 protected:
 	void Serialize(Serializer &s) override
 	{
 		SV(_portNumber);
 		SVVector(_inputState.State);
+		SV(_pollCounter);
 	}
 
 public:
 	MovieDataMessage(void* buffer, uint32_t length) : NetMessage(buffer, length) { }
 
-	MovieDataMessage(ControlDeviceState state, uint8_t port) : NetMessage(MessageType::MovieData)
+	MovieDataMessage(ControlDeviceState state, uint8_t port, uint32_t pollCounter) : NetMessage(MessageType::MovieData)
 	{
 		_portNumber = port;
 		_inputState = state;
+		_pollCounter = pollCounter;
 	}
 
 	uint8_t GetPortNumber()
@@ -34,4 +37,9 @@ public:
 	{
 		return _inputState;
 	}
+
+	uint32_t GetPollCounter()
+	{
+		return _pollCounter;
+	}
 };
\ No newline at end of file
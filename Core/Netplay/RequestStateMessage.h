@@ -0,0 +1,27 @@
+#pragma once
+#include "pch.h"
+#include "Netplay/NetMessage.h"
+
+//Sent by rollback clients when they can't roll back far enough to correct a misprediction - the server sends its full state
+class RequestStateMessage : public NetMessage
+{
+private:
+	uint32_t _pollCounter = 0;
+
+protected:
+	void Serialize(Serializer &s) override
+	{
+		SV(_pollCounter);
+	}
+
+public:
+	RequestStateMessage(void* buffer, uint32_t length) : NetMessage(buffer, length) { }
+
+	//pollCounter is the first poll that used incorrect input
+	RequestStateMessage(uint32_t pollCounter) : NetMessage(MessageType::RequestState)
+	{
+		_pollCounter = pollCounter;
+	}
+
+	uint32_t GetPollCounter() { return _pollCounter; }
+};
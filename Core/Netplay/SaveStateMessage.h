@@ -1,48 +1,103 @@
 #pragma once
 #include "pch.h"
 #include "Netplay/NetMessage.h"
-#include "Shared/Emulator.h"
-#include "Shared/EmuSettings.h"
 #include "Shared/CheatManager.h"
-#include "Shared/SaveStateManager.h"
 
+enum class StateSyncType : uint8_t
+{
+	Full = 0, //Data contains the entire state
+	Delta = 1 //Data only contains the blocks that changed since the previous state sent to the client
+};
+
+//The state is compressed and split into several messages, the client loads it once the last chunk is received
 class SaveStateMessage : public NetMessage
 {
+public:
+	static constexpr uint32_t ChunkSize = 0x10000;
+	static constexpr uint32_t DeltaBlockSize = 256;
+
 private:
+	uint8_t _syncType = 0;
+	uint32_t _chunkIndex = 0;
+	uint32_t _chunkCount = 0;
+	vector<uint8_t> _data;
 	vector<CheatCode> _activeCheats;
-	vector<uint8_t> _stateData;
 
 protected:
 	void Serialize(Serializer &s) override
 	{
-		SVVector(_stateData);
+		SV(_syncType);
+		SV(_chunkIndex);
+		SV(_chunkCount);
+		SVVector(_data);
 		SVVector(_activeCheats);
 	}
 
 public:
 	SaveStateMessage(void* buffer, uint32_t length) : NetMessage(buffer, length) { }
-	
-	SaveStateMessage(Emulator* emu) : NetMessage(MessageType::SaveState)
+
+	SaveStateMessage(StateSyncType syncType, uint32_t chunkIndex, uint32_t chunkCount, uint8_t* data, uint32_t size, vector<CheatCode> activeCheats) : NetMessage(MessageType::SaveState)
 	{
-		//Used when sending state to clients
-		stringstream state;
-		{
-			auto lock = emu->AcquireLock();
-			_activeCheats = emu->GetCheatManager()->GetCheats();
-			emu->Serialize(state, true);
-		}
+		//Used when sending state to clients (cheats are only sent with the last chunk)
+		_syncType = (uint8_t)syncType;
+		_chunkIndex = chunkIndex;
+		_chunkCount = chunkCount;
+		_data = vector<uint8_t>(data, data + size);
+		_activeCheats = activeCheats;
+	}
+
+	StateSyncType GetSyncType() { return (StateSyncType)_syncType; }
+	uint32_t GetChunkIndex() { return _chunkIndex; }
+	bool IsLastChunk() { return _chunkIndex + 1 >= _chunkCount; }
+	vector<uint8_t>& GetData() { return _data; }
+	vector<CheatCode>& GetCheats() { return _activeCheats; }
 
-		uint32_t dataSize = (uint32_t)state.tellp();
-		_stateData.resize(dataSize);
-		state.read((char*)_stateData.data(), dataSize);
+	//Delta format: state size, followed by the index and content of each block that changed
+	static void EncodeDelta(vector<uint8_t>& prevState, vector<uint8_t>& state, vector<uint8_t>& output)
+	{
+		uint32_t size = (uint32_t)state.size();
+		output.clear();
+		output.insert(output.end(), (uint8_t*)&size, (uint8_t*)&size + sizeof(size));
+		for(uint32_t i = 0; i < size; i += DeltaBlockSize) {
+			uint32_t blockSize = std::min(DeltaBlockSize, size - i);
+			if(memcmp(prevState.data() + i, state.data() + i, blockSize) != 0) {
+				uint32_t blockIndex = i / DeltaBlockSize;
+				output.insert(output.end(), (uint8_t*)&blockIndex, (uint8_t*)&blockIndex + sizeof(blockIndex));
+				output.insert(output.end(), state.data() + i, state.data() + i + blockSize);
+			}
+		}
 	}
-	
-	void LoadState(Emulator* emu)
+
+	static bool ApplyDelta(vector<uint8_t>& state, vector<uint8_t>& delta)
 	{
-		std::stringstream ss;
-		ss.write((char*)_stateData.data(), _stateData.size());
-		emu->Deserialize(ss, SaveStateManager::FileFormatVersion, true);
+		uint32_t size;
+		if(delta.size() < sizeof(size)) {
+			return false;
+		}
 
-		emu->GetCheatManager()->SetCheats(_activeCheats);
+		memcpy(&size, delta.data(), sizeof(size));
+		if(size != state.size()) {
+			//The previous state doesn't match the one the server used
+			return false;
+		}
+
+		size_t pos = sizeof(size);
+		while(pos + sizeof(uint32_t) <= delta.size()) {
+			uint32_t blockIndex;
+			memcpy(&blockIndex, delta.data() + pos, sizeof(blockIndex));
+			pos += sizeof(blockIndex);
+
+			uint64_t start = (uint64_t)blockIndex * DeltaBlockSize;
+			if(start >= size) {
+				return false;
+			}
+			uint32_t blockSize = std::min(DeltaBlockSize, size - (uint32_t)start);
+			if(pos + blockSize > delta.size()) {
+				return false;
+			}
+			memcpy(state.data() + start, delta.data() + pos, blockSize);
+			pos += blockSize;
+		}
+		return pos == delta.size();
 	}
-};
\ No newline at end of file
+};
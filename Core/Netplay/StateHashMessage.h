@@ -0,0 +1,41 @@
+#pragma once
+#include "pch.h"
+#include "Netplay/NetMessage.h"
+
+//Sent by clients every HashInterval polls, used by the server to detect desyncs
+class StateHashMessage : public NetMessage
+{
+public:
+	//States are only hashed when the poll counter reaches a new multiple of HashInterval (rather than on every
+	//frame), to avoid serializing the state every frame. The client and server pick the same frames.
+	static constexpr uint32_t HashInterval = 60;
+
+	static bool IsHashedFrame(uint32_t prevPollCounter, uint32_t pollCounter)
+	{
+		return pollCounter / HashInterval != prevPollCounter / HashInterval;
+	}
+
+private:
+	uint32_t _pollCounter = 0;
+	uint32_t _hash = 0;
+
+protected:
+	void Serialize(Serializer &s) override
+	{
+		SV(_pollCounter);
+		SV(_hash);
+	}
+
+public:
+	StateHashMessage(void* buffer, uint32_t length) : NetMessage(buffer, length) { }
+
+	//pollCounter is the value of the poll counter when the state was saved (i.e at the start of a frame)
+	StateHashMessage(uint32_t pollCounter, uint32_t hash) : NetMessage(MessageType::StateHash)
+	{
+		_pollCounter = pollCounter;
+		_hash = hash;
+	}
+
+	uint32_t GetPollCounter() { return _pollCounter; }
+	uint32_t GetHash() { return _hash; }
+};
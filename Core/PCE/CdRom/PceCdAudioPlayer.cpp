@@ -33,6 +33,8 @@ void PceCdAudioPlayer::Play(uint32_t startSector, bool pause)
 		_state.CurrentSector = startSector;
 
 		_clockCounter = 0;
+
+		_cdrom->GetReadAhead().PrefetchAudio(startSector, _state.EndSector);
 	}
 }
 
@@ -45,13 +47,21 @@ void PceCdAudioPlayer::SetEndPosition(uint32_t endSector, CdPlayEndBehavior endB
 	_state.EndSector = endSector;
 	_state.EndBehavior = endBehavior;
 	_state.Status = CdAudioStatus::Playing;
+
+	_cdrom->GetReadAhead().PrefetchAudio(_state.CurrentSector, endSector);
 }
 
 void PceCdAudioPlayer::PlaySample()
 {
 	if(_state.Status == CdAudioStatus::Playing) {
-		_state.LeftSample = _disc->ReadLeftSample(_state.CurrentSector, _state.CurrentSample);
-		_state.RightSample = _disc->ReadRightSample(_state.CurrentSector, _state.CurrentSample);
+		if(_loadedSector != _state.CurrentSector) {
+			_cdrom->GetReadAhead().ReadAudioSector(_state.CurrentSector, _sectorData);
+			_loadedSector = _state.CurrentSector;
+		}
+
+		uint8_t* sample = _sectorData + _state.CurrentSample * 4;
+		_state.LeftSample = (int16_t)(sample[0] | (sample[1] << 8));
+		_state.RightSample = (int16_t)(sample[2] | (sample[3] << 8));
 		_samplesToPlay.push_back(_state.LeftSample);
 		_samplesToPlay.push_back(_state.RightSample);
 		_state.CurrentSample++;
@@ -110,4 +120,11 @@ void PceCdAudioPlayer::Serialize(Serializer& s)
 	SV(_state.RightSample);
 
 	SV(_clockCounter);
+
+	if(!s.IsSaving()) {
+		_loadedSector = -1;
+		if(_state.Status == CdAudioStatus::Playing) {
+			_cdrom->GetReadAhead().PrefetchAudio(_state.CurrentSector, _state.EndSector);
+		}
+	}
 }
@@ -1,13 +1,13 @@
 #pragma once
 #include "pch.h"
 #include "PCE/PceTypes.h"
+#include "Shared/CdReader.h"
 #include "Shared/Interfaces/IAudioProvider.h"
 #include "Utilities/Audio/HermiteResampler.h"
 #include "Utilities/ISerializable.h"
 
 class Emulator;
 class PceCdRom;
-struct DiscInfo;
 
 class PceCdAudioPlayer final : public IAudioProvider, public ISerializable
 {
@@ -17,6 +17,10 @@ class PceCdAudioPlayer final : public IAudioProvider, public ISerializable
 
 	PceCdAudioPlayerState _state = {};
 
+	//Copy of the sector that is currently playing
+	uint8_t _sectorData[DiscInfo::SectorSize] = {};
+	int64_t _loadedSector = -1;
+
 	vector<int16_t> _samplesToPlay;
 	uint32_t _clockCounter = 0;
 	uint32_t _seekDelay = 0;
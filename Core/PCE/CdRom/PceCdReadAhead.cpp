@@ -0,0 +1,160 @@
+#include "pch.h"
+#include "PCE/CdRom/PceCdReadAhead.h"
+
+PceCdReadAhead::PceCdReadAhead(DiscInfo& disc)
+{
+	_disc = &disc;
+	_stopFlag = false;
+
+	_workerDisc.Tracks = disc.Tracks;
+	_workerDisc.DiscSize = disc.DiscSize;
+	_workerDisc.DiscSectorCount = disc.DiscSectorCount;
+	_workerDisc.EndPosition = disc.EndPosition;
+	_workerDisc.Files.resize(disc.Files.size());
+	_useWorkerFile.resize(disc.Files.size());
+	for(size_t i = 0; i < disc.Files.size(); i++) {
+		_useWorkerFile[i] = disc.Files[i].CreateThreadReader(_workerDisc.Files[i]);
+	}
+}
+
+PceCdReadAhead::~PceCdReadAhead()
+{
+	if(_workerThread) {
+		_stopFlag = true;
+		_signal.Signal();
+		_workerThread->join();
+	}
+}
+
+void PceCdReadAhead::StartWorker()
+{
+	if(!_workerThread) {
+		_workerThread.reset(new std::thread(&PceCdReadAhead::WorkerThread, this));
+	}
+}
+
+void PceCdReadAhead::PrefetchData(uint32_t sector)
+{
+	int32_t track = _disc->GetTrack(sector);
+	{
+		auto lock = _slotLock.AcquireSafe();
+		_dataPos = sector;
+		if(track >= 0 && _disc->Tracks[track].Format != TrackFormat::Audio) {
+			//Prefetch until the end of the data track
+			_dataEnd = _disc->Tracks[track].LastSector + 1;
+		} else {
+			_dataEnd = sector;
+		}
+	}
+	StartWorker();
+	_signal.Signal();
+}
+
+void PceCdReadAhead::PrefetchAudio(uint32_t sector, uint32_t endSector)
+{
+	{
+		auto lock = _slotLock.AcquireSafe();
+		_audioPos = sector;
+		_audioEnd = endSector + 1;
+	}
+	StartWorker();
+	_signal.Signal();
+}
+
+void PceCdReadAhead::ReadDataSector(uint32_t sector, deque<uint8_t>& outData)
+{
+	{
+		auto lock = _slotLock.AcquireSafe();
+		_dataPos = sector + 1;
+		SectorSlot& slot = _dataSlots[sector % SlotCount];
+		if(slot.Sector == sector) {
+			outData.insert(outData.end(), slot.Data, slot.Data + slot.Size);
+			_signal.Signal();
+			return;
+		}
+	}
+
+	//Sector isn't loaded yet, read it right away
+	_disc->ReadDataSector(sector, outData);
+	_signal.Signal();
+}
+
+void PceCdReadAhead::ReadAudioSector(uint32_t sector, uint8_t outData[DiscInfo::SectorSize])
+{
+	{
+		auto lock = _slotLock.AcquireSafe();
+		_audioPos = sector + 1;
+		SectorSlot& slot = _audioSlots[sector % SlotCount];
+		if(slot.Sector == sector) {
+			memcpy(outData, slot.Data, DiscInfo::SectorSize);
+			_signal.Signal();
+			return;
+		}
+	}
+
+	//Sector isn't loaded yet, read it right away
+	_disc->ReadAudioSector(sector, outData);
+	_signal.Signal();
+}
+
+int64_t PceCdReadAhead::FindMissingSector(SectorSlot* slots, uint32_t pos, uint32_t end)
+{
+	for(uint32_t i = 0; i < SlotCount && pos + i < end; i++) {
+		if(slots[(pos + i) % SlotCount].Sector != pos + i) {
+			return pos + i;
+		}
+	}
+	return -1;
+}
+
+bool PceCdReadAhead::GetNextSector(bool& isAudio, uint32_t& sector)
+{
+	auto lock = _slotLock.AcquireSafe();
+	int64_t dataSector = FindMissingSector(_dataSlots, _dataPos, _dataEnd);
+	int64_t audioSector = FindMissingSector(_audioSlots, _audioPos, _audioEnd);
+	if(dataSector < 0 && audioSector < 0) {
+		return false;
+	}
+
+	//Load whichever sector is going to be needed first
+	isAudio = dataSector < 0 || (audioSector >= 0 && audioSector - _audioPos <= dataSector - _dataPos);
+	sector = (uint32_t)(isAudio ? audioSector : dataSector);
+	return true;
+}
+
+void PceCdReadAhead::LoadSector(bool isAudio, uint32_t sector, SectorSlot& slot)
+{
+	int32_t track = _workerDisc.GetTrack(sector);
+	DiscInfo& disc = track < 0 || _useWorkerFile[_workerDisc.Tracks[track].FileIndex] ? _workerDisc : *_disc;
+
+	slot.Sector = sector;
+	if(isAudio) {
+		disc.ReadAudioSector(sector, slot.Data);
+		slot.Size = DiscInfo::SectorSize;
+	} else {
+		vector<uint8_t> sectorData;
+		sectorData.reserve(DiscInfo::SectorSize);
+		disc.ReadDataSector(sector, sectorData);
+		slot.Size = (uint32_t)std::min<size_t>(sectorData.size(), DiscInfo::SectorSize);
+		memcpy(slot.Data, sectorData.data(), slot.Size);
+	}
+}
+
+void PceCdReadAhead::WorkerThread()
+{
+	unique_ptr<SectorSlot> loadedSector(new SectorSlot());
+	while(!_stopFlag) {
+		bool isAudio = false;
+		uint32_t sector = 0;
+		if(!GetNextSector(isAudio, sector)) {
+			_signal.Wait(100);
+			continue;
+		}
+
+		LoadSector(isAudio, sector, *loadedSector);
+
+		auto lock = _slotLock.AcquireSafe();
+		SectorSlot* slots = isAudio ? _audioSlots : _dataSlots;
+		slots[sector % SlotCount] = *loadedSector;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "pch.h"
+#include <thread>
+#include "Shared/CdReader.h"
+#include "Utilities/SimpleLock.h"
+#include "Utilities/AutoResetEvent.h"
+
+//Loads the upcoming data and audio sectors on a separate thread, to avoid blocking emulation on disk I/O.
+//Sectors that have not been prefetched yet are read on the emulation thread, so the data is always identical.
+//The worker reads the disc through its own file readers, so the emulation thread never waits for the worker's I/O.
+class PceCdReadAhead
+{
+private:
+	static constexpr uint32_t SlotCount = 32;
+
+	struct SectorSlot
+	{
+		int64_t Sector = -1;
+		uint32_t Size = 0;
+		uint8_t Data[DiscInfo::SectorSize] = {};
+	};
+
+	DiscInfo* _disc = nullptr;
+
+	//Copy of the disc with separate file readers, only used by the worker thread.
+	//Files that are already loaded in memory are read through _disc (see _useWorkerFile)
+	DiscInfo _workerDisc;
+	vector<bool> _useWorkerFile;
+
+	//Slots are indexed by sector % SlotCount
+	SectorSlot _dataSlots[SlotCount];
+	SectorSlot _audioSlots[SlotCount];
+	SimpleLock _slotLock;
+
+	//Sectors in [pos, end) are prefetched, up to SlotCount sectors ahead of pos
+	uint32_t _dataPos = 0;
+	uint32_t _dataEnd = 0;
+	uint32_t _audioPos = 0;
+	uint32_t _audioEnd = 0;
+
+	unique_ptr<std::thread> _workerThread;
+	AutoResetEvent _signal;
+	atomic<bool> _stopFlag;
+
+	void WorkerThread();
+	void StartWorker();
+	int64_t FindMissingSector(SectorSlot* slots, uint32_t pos, uint32_t end);
+	bool GetNextSector(bool& isAudio, uint32_t& sector);
+	void LoadSector(bool isAudio, uint32_t sector, SectorSlot& slot);
+
+public:
+	PceCdReadAhead(DiscInfo& disc);
+	~PceCdReadAhead();
+
+	void PrefetchData(uint32_t sector);
+	void PrefetchAudio(uint32_t sector, uint32_t endSector);
+
+	void ReadDataSector(uint32_t sector, deque<uint8_t>& outData);
+	void ReadAudioSector(uint32_t sector, uint8_t outData[DiscInfo::SectorSize]);
+};
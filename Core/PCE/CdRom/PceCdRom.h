@@ -4,6 +4,7 @@
 #include "PCE/CdRom/PceAdpcm.h"
 #include "PCE/CdRom/PceCdAudioPlayer.h"
 #include "PCE/CdRom/PceAudioFader.h"
+#include "PCE/CdRom/PceCdReadAhead.h"
 #include "PCE/PceTypes.h"
 #include "Shared/MemoryType.h"
 #include "Shared/CdReader.h"
@@ -20,6 +21,7 @@ private:
 	PceConsole* _console = nullptr;
 
 	DiscInfo _disc;
+	PceCdReadAhead _readAhead;
 	PceScsiBus _scsi;
 	PceAdpcm _adpcm;
 	PceAudioFader _audioFader;
@@ -60,6 +62,7 @@ public:
 
 	PceCdAudioPlayer& GetAudioPlayer() { return _audioPlayer; }
 	PceAudioFader& GetAudioFader() { return _audioFader; }
+	PceCdReadAhead& GetReadAhead() { return _readAhead; }
 	
 	uint32_t GetCurrentSector();
 
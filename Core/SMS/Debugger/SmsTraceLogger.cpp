@@ -63,12 +63,12 @@ RowDataType SmsTraceLogger::GetFormatTagType(string& tag)
 	}
 }
 
-void SmsTraceLogger::GetTraceRow(string &output, SmsCpuState &cpuState, TraceLogPpuState &vdpState, DisassemblyInfo &disassemblyInfo)
+void SmsTraceLogger::GetTraceRow(string &output, SmsCpuState &cpuState, TraceLogPpuState &vdpState, DisassemblyInfo &disassemblyInfo, TraceLogRowFormat& format, TraceLogMemoryInfo* memInfo)
 {
 	constexpr char activeStatusLetters[8] = { 'S', 'Z', '5', 'H', '3', 'P', 'N', 'C' };
 	constexpr char inactiveStatusLetters[8] = { 's', 'z', '-', 'h', '-', 'p', 'n', 'c' };
 	
-	for(RowPart& rowPart : _rowParts) {
+	for(RowPart& rowPart : format.Parts) {
 		switch(rowPart.DataType) {
 			case RowDataType::A: WriteIntValue(output, cpuState.A, rowPart); break;
 			case RowDataType::B: WriteIntValue(output, cpuState.B, rowPart); break;
@@ -92,7 +92,7 @@ void SmsTraceLogger::GetTraceRow(string &output, SmsCpuState &cpuState, TraceLog
 			case RowDataType::IY: WriteIntValue(output, (uint16_t)(cpuState.IYL | (cpuState.IYH << 8)), rowPart); break;
 			case RowDataType::SP: WriteIntValue(output, cpuState.SP, rowPart); break;
 			case RowDataType::PS: GetStatusFlag(activeStatusLetters, inactiveStatusLetters, output, cpuState.Flags, rowPart, 8); break;
-			default: ProcessSharedTag(rowPart, output, cpuState, vdpState, disassemblyInfo); break;
+			default: ProcessSharedTag(rowPart, output, cpuState, vdpState, disassemblyInfo, format, memInfo); break;
 		}
 	}
 }
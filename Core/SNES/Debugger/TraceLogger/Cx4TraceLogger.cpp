@@ -71,9 +71,9 @@ RowDataType Cx4TraceLogger::GetFormatTagType(string& tag)
 	}
 }
 
-void Cx4TraceLogger::GetTraceRow(string& output, Cx4State& cpuState, TraceLogPpuState& ppuState, DisassemblyInfo& disassemblyInfo)
+void Cx4TraceLogger::GetTraceRow(string& output, Cx4State& cpuState, TraceLogPpuState& ppuState, DisassemblyInfo& disassemblyInfo, TraceLogRowFormat& format, TraceLogMemoryInfo* memInfo)
 {
-	for(RowPart& rowPart : _rowParts) {
+	for(RowPart& rowPart : format.Parts) {
 		switch(rowPart.DataType) {
 			case RowDataType::PS: {
 				string status = string(cpuState.Carry ? "C" : "c") + (cpuState.Zero ? "Z" : "z") + (cpuState.Overflow ? "V" : "v") + (cpuState.Negative ? "N" : "n");
@@ -109,7 +109,7 @@ void Cx4TraceLogger::GetTraceRow(string& output, Cx4State& cpuState, TraceLogPpu
 			case RowDataType::PB: WriteIntValue(output, cpuState.PB, rowPart); break;
 			case RowDataType::P: WriteIntValue(output, cpuState.P, rowPart); break;
 
-			default: ProcessSharedTag(rowPart, output, cpuState, ppuState, disassemblyInfo); break;
+			default: ProcessSharedTag(rowPart, output, cpuState, ppuState, disassemblyInfo, format, memInfo); break;
 		}
 	}
 }
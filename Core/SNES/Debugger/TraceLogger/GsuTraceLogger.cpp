@@ -59,9 +59,9 @@ RowDataType GsuTraceLogger::GetFormatTagType(string& tag)
 	}
 }
 
-void GsuTraceLogger::GetTraceRow(string &output, GsuState &cpuState, TraceLogPpuState &ppuState, DisassemblyInfo &disassemblyInfo)
+void GsuTraceLogger::GetTraceRow(string &output, GsuState &cpuState, TraceLogPpuState &ppuState, DisassemblyInfo &disassemblyInfo, TraceLogRowFormat& format, TraceLogMemoryInfo* memInfo)
 {
-	for(RowPart& rowPart : _rowParts) {
+	for(RowPart& rowPart : format.Parts) {
 		switch(rowPart.DataType) {
 			case RowDataType::R0: WriteIntValue(output, cpuState.R[0], rowPart); break;
 			case RowDataType::R1: WriteIntValue(output, cpuState.R[1], rowPart); break;
@@ -90,7 +90,7 @@ void GsuTraceLogger::GetTraceRow(string &output, GsuState &cpuState, TraceLogPpu
 				break;
 			}
 
-			default: ProcessSharedTag(rowPart, output, cpuState, ppuState, disassemblyInfo); break;
+			default: ProcessSharedTag(rowPart, output, cpuState, ppuState, disassemblyInfo, format, memInfo); break;
 		}
 	}
 }
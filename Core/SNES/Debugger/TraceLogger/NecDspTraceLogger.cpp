@@ -55,9 +55,9 @@ void NecDspTraceLogger::WriteAccFlagsValue(string& output, NecDspAccFlags flags,
 	WriteStringValue(output, status, rowPart);
 }
 
-void NecDspTraceLogger::GetTraceRow(string& output, NecDspState& cpuState, TraceLogPpuState& ppuState, DisassemblyInfo& disassemblyInfo)
+void NecDspTraceLogger::GetTraceRow(string& output, NecDspState& cpuState, TraceLogPpuState& ppuState, DisassemblyInfo& disassemblyInfo, TraceLogRowFormat& format, TraceLogMemoryInfo* memInfo)
 {
-	for(RowPart& rowPart : _rowParts) {
+	for(RowPart& rowPart : format.Parts) {
 		switch(rowPart.DataType) {
 			case RowDataType::A: WriteIntValue(output, cpuState.A, rowPart); break;
 			case RowDataType::FlagsA: WriteAccFlagsValue(output, cpuState.FlagsA, rowPart); break;
@@ -74,7 +74,7 @@ void NecDspTraceLogger::GetTraceRow(string& output, NecDspState& cpuState, Trace
 			case RowDataType::TR: WriteIntValue(output, cpuState.TR, rowPart); break;
 			case RowDataType::TRB: WriteIntValue(output, cpuState.TRB, rowPart); break;
 
-			default: ProcessSharedTag(rowPart, output, cpuState, ppuState, disassemblyInfo); break;
+			default: ProcessSharedTag(rowPart, output, cpuState, ppuState, disassemblyInfo, format, memInfo); break;
 		}
 	}
 }
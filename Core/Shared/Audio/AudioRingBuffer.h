@@ -0,0 +1,104 @@
+#pragma once
+#include "pch.h"
+
+//Lock-free single-producer/single-consumer ring buffer of 16-bit samples
+//Read/write positions are monotonic counters (they never wrap), the producer publishes its position with
+//release semantics after writing the samples, and the consumer does the same after reading them.
+//Init() and Reset() must only be called while neither side is running (e.g audio device paused)
+class AudioRingBuffer
+{
+private:
+	unique_ptr<int16_t[]> _buffer;
+	uint32_t _capacity = 0;
+	uint32_t _mask = 0;
+
+	atomic<uint64_t> _writePosition;
+	atomic<uint64_t> _readPosition;
+
+	atomic<uint32_t> _underrunCount;
+	atomic<uint32_t> _overrunCount;
+
+public:
+	AudioRingBuffer()
+	{
+		_writePosition = 0;
+		_readPosition = 0;
+		_underrunCount = 0;
+		_overrunCount = 0;
+	}
+
+	void Init(uint32_t minCapacity)
+	{
+		_capacity = 1;
+		while(_capacity < minCapacity) {
+			_capacity <<= 1;
+		}
+		_mask = _capacity - 1;
+		_buffer.reset(new int16_t[_capacity]);
+		memset(_buffer.get(), 0, _capacity * sizeof(int16_t));
+		Reset();
+	}
+
+	void Reset()
+	{
+		_writePosition = 0;
+		_readPosition = 0;
+		_underrunCount = 0;
+		_overrunCount = 0;
+	}
+
+	uint32_t GetCapacity() { return _capacity; }
+
+	//Number of samples that can currently be read (can be called from either thread)
+	uint32_t GetFillLevel()
+	{
+		uint64_t readPos = _readPosition.load(std::memory_order_acquire);
+		uint64_t writePos = _writePosition.load(std::memory_order_acquire);
+		return (uint32_t)(writePos - readPos);
+	}
+
+	uint32_t GetUnderrunCount() { return _underrunCount; }
+	uint32_t GetOverrunCount() { return _overrunCount; }
+
+	//Producer - samples that don't fit are dropped
+	uint32_t Write(const int16_t* samples, uint32_t count)
+	{
+		uint64_t writePos = _writePosition.load(std::memory_order_relaxed);
+		uint64_t readPos = _readPosition.load(std::memory_order_acquire);
+		uint32_t available = _capacity - (uint32_t)(writePos - readPos);
+		if(count > available) {
+			_overrunCount++;
+			count = available;
+		}
+
+		uint32_t start = (uint32_t)(writePos & _mask);
+		uint32_t firstPart = std::min(count, _capacity - start);
+		memcpy(_buffer.get() + start, samples, firstPart * sizeof(int16_t));
+		memcpy(_buffer.get(), samples + firstPart, (count - firstPart) * sizeof(int16_t));
+
+		_writePosition.store(writePos + count, std::memory_order_release);
+		return count;
+	}
+
+	//Consumer - fills the end of the output with silence when there aren't enough samples
+	uint32_t Read(int16_t* output, uint32_t count)
+	{
+		uint64_t readPos = _readPosition.load(std::memory_order_relaxed);
+		uint64_t writePos = _writePosition.load(std::memory_order_acquire);
+		uint32_t available = (uint32_t)(writePos - readPos);
+		uint32_t readCount = count;
+		if(readCount > available) {
+			_underrunCount++;
+			readCount = available;
+			memset(output + readCount, 0, (count - readCount) * sizeof(int16_t));
+		}
+
+		uint32_t start = (uint32_t)(readPos & _mask);
+		uint32_t firstPart = std::min(readCount, _capacity - start);
+		memcpy(output, _buffer.get() + start, firstPart * sizeof(int16_t));
+		memcpy(output + firstPart, _buffer.get(), (readCount - firstPart) * sizeof(int16_t));
+
+		_readPosition.store(readPos + readCount, std::memory_order_release);
+		return readCount;
+	}
+};
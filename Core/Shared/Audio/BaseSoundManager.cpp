@@ -11,7 +11,12 @@ void BaseSoundManager::ProcessLatency(uint32_t readPosition, uint32_t writePosit
 		cursorGap = writePosition - readPosition;
 	}
 
-	_cursorGaps[_cursorGapIndex] = cursorGap;
+	ProcessBufferLevel(cursorGap);
+}
+
+void BaseSoundManager::ProcessBufferLevel(uint32_t bufferedBytes)
+{
+	_cursorGaps[_cursorGapIndex] = (int32_t)bufferedBytes;
 	_cursorGapIndex = (_cursorGapIndex + 1) % 60;
 	if(_cursorGapIndex == 0) {
 		_cursorGapFilled = true;
@@ -37,6 +42,7 @@ AudioStatistics BaseSoundManager::GetStatistics()
 	AudioStatistics stats;
 	stats.AverageLatency = _averageLatency;
 	stats.BufferUnderrunEventCount = _bufferUnderrunEventCount;
+	stats.BufferOverrunEventCount = _bufferOverrunEventCount;
 	stats.BufferSize = _bufferSize;
 	return stats;
 }
@@ -46,5 +52,6 @@ void BaseSoundManager::ResetStats()
 	_cursorGapIndex = 0;
 	_cursorGapFilled = false;
 	_bufferUnderrunEventCount = 0;
+	_bufferOverrunEventCount = 0;
 	_averageLatency = 0;
 }
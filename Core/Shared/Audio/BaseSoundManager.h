@@ -5,6 +5,7 @@ class BaseSoundManager : public IAudioDevice
 {
 public:
 	void ProcessLatency(uint32_t readPosition, uint32_t writePosition);
+	void ProcessBufferLevel(uint32_t bufferedBytes);
 	AudioStatistics GetStatistics();
 
 protected:
@@ -14,6 +15,7 @@ protected:
 	double _averageLatency = 0;
 	uint32_t _bufferSize = 0x10000;
 	uint32_t _bufferUnderrunEventCount = 0;
+	uint32_t _bufferOverrunEventCount = 0;
 
 	int32_t _cursorGaps[60];
 	int32_t _cursorGapIndex = 0;
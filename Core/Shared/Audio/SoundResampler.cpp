@@ -35,7 +35,7 @@ double SoundResampler::GetTargetRateAdjustment()
 		//TODO: Have 2 output streams (one for recording, one for the speakers)
 		AudioStatistics stats = _emu->GetSoundMixer()->GetStatistics();
 
-		if(stats.AverageLatency > 0 && _emu->GetSettings()->GetEmulationSpeed() == 100) {
+		if(stats.AverageLatency > 0 && !stats.PullMode && _emu->GetSettings()->GetEmulationSpeed() == 100) {
 			//Try to stay within +/- 3ms of requested latency
 			constexpr int32_t maxGap = 3;
 			constexpr int32_t maxSubAdjustment = 3600;
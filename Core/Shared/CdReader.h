@@ -137,27 +137,23 @@ struct DiscInfo
 		}
 	}
 
-	int16_t ReadAudioSample(uint32_t sector, uint32_t sample, uint32_t byteOffset)
+	void ReadAudioSector(uint32_t sector, uint8_t outData[DiscInfo::SectorSize])
 	{
 		int32_t track = GetTrack(sector);
 		if(track < 0) {
 			LogDebug("Invalid sector/track");
-			return 0;
+			memset(outData, 0, DiscInfo::SectorSize);
+			return;
 		}
 
-		uint32_t fileIndex = Tracks[track].FileIndex;
+		VirtualFile& file = Files[Tracks[track].FileIndex];
 		uint32_t startByte = Tracks[track].FileOffset + (sector - Tracks[track].FirstSector) * DiscInfo::SectorSize;
-		return (int16_t)(Files[fileIndex].ReadByte(startByte + sample * 4 + byteOffset) | (Files[fileIndex].ReadByte(startByte + sample * 4 + 1 + byteOffset) << 8));
-	}
-
-	int16_t ReadLeftSample(uint32_t sector, uint32_t sample)
-	{
-		return ReadAudioSample(sector, sample, 0);
-	}
-
-	int16_t ReadRightSample(uint32_t sector, uint32_t sample)
-	{
-		return ReadAudioSample(sector, sample, 2);
+		if(!file.ReadSpan(startByte, outData, DiscInfo::SectorSize)) {
+			//Sector goes past the end of the file, read whatever is available
+			for(uint32_t i = 0; i < DiscInfo::SectorSize; i++) {
+				outData[i] = file.ReadByte(startByte + i);
+			}
+		}
 	}
 };
 
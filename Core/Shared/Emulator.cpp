@@ -26,6 +26,7 @@
 #include "Shared/HistoryViewer.h"
 #include "Netplay/GameServer.h"
 #include "Netplay/GameClient.h"
+#include "Netplay/GameClientConnection.h"
 #include "Shared/Interfaces/IConsole.h"
 #include "Shared/Interfaces/IBarcodeReader.h"
 #include "Shared/Interfaces/ITapeRecorder.h"
@@ -134,7 +135,9 @@ void Emulator::Run()
 
 	while(!_stopFlag) {
 		bool useRunAhead = _settings->GetEmulationConfig().RunAheadFrames > 0 && !_debugger && !_audioPlayerHud && !_rewindManager->IsRewinding() && _settings->GetEmulationSpeed() > 0 && _settings->GetEmulationSpeed() <= 100;
-		if(useRunAhead) {
+		if(_netplayClient) {
+			RunNetplayClientFrame();
+		} else if(useRunAhead) {
 			RunFrameWithRunAhead();
 		} else {
 			_console->RunFrame();
@@ -143,6 +146,7 @@ void Emulator::Run()
 			ProcessSystemActions();
 		}
 
+		_gameServer->ProcessEndOfFrame();
 		ProcessAutoSaveState();
 
 		WaitForLock();
@@ -203,13 +207,12 @@ bool Emulator::ProcessSystemActions()
 
 void Emulator::RunFrameWithRunAhead()
 {
-	stringstream runAheadState;
 	uint32_t frameCount = _settings->GetEmulationConfig().RunAheadFrames;
 
 	//Run a single frame and save the state (no audio/video)
 	_isRunAheadFrame = true;
 	_console->RunFrame();
-	Serialize(runAheadState, false, 0);
+	Serialize(_runAheadState, false);
 
 	while(frameCount > 1) {
 		//Run extra frames if the requested run ahead frame count is higher than 1
@@ -227,11 +230,39 @@ void Emulator::RunFrameWithRunAhead()
 	if(!wasReset) {
 		//Load the state we saved earlier
 		_isRunAheadFrame = true;
-		Deserialize(runAheadState, SaveStateManager::FileFormatVersion, false);
+		Deserialize(_runAheadState, false);
 		_isRunAheadFrame = false;
 	}
 }
 
+void Emulator::RunNetplayClientFrame()
+{
+	if(!_netplayClient->WaitForRollbackInput()) {
+		//Too far ahead of the server, wait for its input before running more frames
+		return;
+	}
+
+	uint32_t frameCount = 0;
+	if(_netplayClient->GetRollbackState(_rollbackState, frameCount)) {
+		//Some remote inputs were mispredicted, load the state saved before the first incorrect
+		//input and run the frames again with the correct inputs (no audio/video)
+		_isRunAheadFrame = true;
+		Deserialize(_rollbackState, false, false);
+		for(uint32_t i = 0; i < frameCount; i++) {
+			_netplayClient->SaveFrameState();
+			_console->RunFrame();
+		}
+		_isRunAheadFrame = false;
+	}
+
+	//Run the current frame normally (with audio/video output)
+	_netplayClient->SaveFrameState();
+	_console->RunFrame();
+	_rewindManager->ProcessEndOfFrame();
+	_historyViewer->ProcessEndOfFrame();
+	ProcessSystemActions();
+}
+
 void Emulator::OnBeforeSendFrame()
 {
 	if(!_isRunAheadFrame) {
@@ -303,6 +334,7 @@ void Emulator::Stop(bool sendNotification, bool preventRecentGameSave, bool save
 			_console->SaveBattery();
 		}
 		_console.reset();
+		ClearPositionalLayouts();
 	}
 
 	_soundMixer->StopAudio(true);
@@ -541,6 +573,7 @@ void Emulator::InitConsole(unique_ptr<IConsole>& newConsole, ConsoleMemoryInfo o
 	}
 
 	_console.reset(newConsole);
+	ClearPositionalLayouts();
 	_consoleType = _console->GetConsoleType();
 	_notificationManager->RegisterNotificationListener(_console.lock());
 }
@@ -896,18 +929,101 @@ void Emulator::Serialize(ostream& out, bool includeSettings, int compressionLeve
 	s.SaveTo(out, compressionLevel);
 }
 
+void Emulator::Serialize(vector<uint8_t>& out, bool includeSettings)
+{
+	//Snapshot that is only loaded by this process - use the positional format, and reuse the buffer
+	Serialize(out, includeSettings, SerializeFormat::Positional);
+}
+
+void Emulator::Serialize(vector<uint8_t>& out, bool includeSettings, SerializeFormat format)
+{
+	//States sent to other machines (netplay) must use the keyed binary format, positional snapshots can only be loaded by this process
+	Serializer s(SaveStateManager::FileFormatVersion, true, format);
+	s.ReuseBuffer(out);
+	if(includeSettings) {
+		SV(_settings);
+	}
+	s.Stream(_console, "");
+	if(format == SerializeFormat::Positional) {
+		RegisterPositionalLayout(s.GetLayoutHash());
+	}
+	s.SaveTo(out);
+}
+
+void Emulator::RegisterPositionalLayout(uint64_t layoutHash)
+{
+	auto lock = _layoutLock.AcquireSafe();
+	if(std::find(_positionalLayouts.begin(), _positionalLayouts.end(), layoutHash) == _positionalLayouts.end()) {
+		if(_positionalLayouts.size() >= Emulator::MaxPositionalLayouts) {
+			_positionalLayouts.erase(_positionalLayouts.begin());
+		}
+		_positionalLayouts.push_back(layoutHash);
+	}
+}
+
+bool Emulator::IsKnownPositionalLayout(uint64_t layoutHash)
+{
+	auto lock = _layoutLock.AcquireSafe();
+	return std::find(_positionalLayouts.begin(), _positionalLayouts.end(), layoutHash) != _positionalLayouts.end();
+}
+
+bool Emulator::IsPositionalLayoutValid(uint64_t layoutHash, bool includeSettings)
+{
+	if(IsKnownPositionalLayout(layoutHash)) {
+		return true;
+	}
+
+	//Not saved for the current console by this instance (e.g a snapshot taken by the history viewer's emulator),
+	//compare it with the layout of the current state
+	vector<uint8_t> currentState;
+	Serialize(currentState, includeSettings, SerializeFormat::Positional);
+	return IsKnownPositionalLayout(layoutHash);
+}
+
+void Emulator::ClearPositionalLayouts()
+{
+	auto lock = _layoutLock.AcquireSafe();
+	_positionalLayouts.clear();
+}
+
 bool Emulator::Deserialize(istream& in, uint32_t fileFormatVersion, bool includeSettings, optional<ConsoleType> srcConsoleType, bool sendNotification)
 {
 	Serializer s(fileFormatVersion, false);
 	if(!s.LoadFrom(in)) {
 		return false;
 	}
+	return Deserialize(s, includeSettings, srcConsoleType, sendNotification);
+}
+
+bool Emulator::Deserialize(const vector<uint8_t>& in, bool includeSettings, bool sendNotification)
+{
+	Serializer s(SaveStateManager::FileFormatVersion, false);
+	if(!s.LoadFrom(in)) {
+		MessageManager::Log("[Emulator] Could not load snapshot - its format is not supported.");
+		return false;
+	}
+	return Deserialize(s, includeSettings, std::nullopt, sendNotification);
+}
+
+bool Emulator::Deserialize(Serializer& s, bool includeSettings, optional<ConsoleType> srcConsoleType, bool sendNotification)
+{
+	if(s.GetFormat() == SerializeFormat::Positional && !IsPositionalLayoutValid(s.GetLayoutHash(), includeSettings)) {
+		//Positional snapshots have no keys, a snapshot taken for another console/game (or with a different layout) can't be loaded
+		MessageManager::DisplayMessage("SaveStates", "SaveStateWrongSystem");
+		return false;
+	}
 
 	if(includeSettings) {
 		SV(_settings);
 	}
 
 	if(srcConsoleType.has_value() && srcConsoleType.value() != _console->GetConsoleType()) {
+		if(s.GetFormat() == SerializeFormat::Positional) {
+			//Positional snapshots can't be converted to another console type
+			MessageManager::DisplayMessage("SaveStates", "SaveStateWrongSystem");
+			return false;
+		}
+
 		//Used to allow save states taken on GB/GBC/SGB to be loaded on any of the 3 systems
 		SaveStateCompatInfo compatInfo = _console->ValidateSaveStateCompatibility(srcConsoleType.value());
 		if(!compatInfo.IsCompatible) {
@@ -930,6 +1046,12 @@ bool Emulator::Deserialize(istream& in, uint32_t fileFormatVersion, bool include
 	}
 
 	s.Stream(_console, "");
+
+	if(s.GetFormat() == SerializeFormat::Positional && !s.IsLayoutValid()) {
+		//The layout hash matched but the data didn't (e.g truncated snapshot)
+		MessageManager::Log("[Emulator] Snapshot data does not match its layout.");
+		return false;
+	}
 	
 	if(sendNotification) {
 		_notificationManager->SendNotification(ConsoleNotificationType::StateLoaded);
@@ -26,6 +26,7 @@ class MovieManager;
 class HistoryViewer;
 class FrameLimiter;
 class DebugStats;
+class Serializer;
 class BaseControlManager;
 class VirtualFile;
 class BaseVideoFilter;
@@ -34,6 +35,7 @@ class SystemActionManager;
 class AudioPlayerHud;
 class GameServer;
 class GameClient;
+class GameClientConnection;
 
 class IInputRecorder;
 class IInputProvider;
@@ -48,6 +50,7 @@ enum class ConsoleRegion;
 enum class ConsoleType;
 enum class HashType;
 enum class TapeRecorderAction;
+enum class SerializeFormat;
 
 struct ConsoleMemoryInfo
 {
@@ -102,6 +105,16 @@ private:
 	atomic<int> _blockDebuggerRequestCount;
 
 	atomic<bool> _isRunAheadFrame;
+	vector<uint8_t> _runAheadState;
+	
+	//Only set for netplay clients in rollback mode
+	GameClientConnection* _netplayClient = nullptr;
+	vector<uint8_t> _rollbackState;
+
+	//Layout hashes of the positional snapshots saved for the current console (cleared when the console changes)
+	static constexpr uint32_t MaxPositionalLayouts = 16;
+	SimpleLock _layoutLock;
+	vector<uint64_t> _positionalLayouts;
 	bool _frameRunning = false;
 
 	RomInfo _rom;
@@ -123,6 +136,13 @@ private:
 	void ProcessAutoSaveState();
 	bool ProcessSystemActions();
 	void RunFrameWithRunAhead();
+	void RunNetplayClientFrame();
+	bool Deserialize(Serializer& s, bool includeSettings, optional<ConsoleType> srcConsoleType, bool sendNotification);
+
+	void RegisterPositionalLayout(uint64_t layoutHash);
+	bool IsKnownPositionalLayout(uint64_t layoutHash);
+	bool IsPositionalLayoutValid(uint64_t layoutHash, bool includeSettings);
+	void ClearPositionalLayouts();
 
 	void BlockDebuggerRequests();
 	void ResetDebugger(bool startDebugger = false);
@@ -180,7 +200,10 @@ public:
 	void SuspendDebugger(bool release);
 
 	void Serialize(ostream& out, bool includeSettings, int compressionLevel = 1);
+	void Serialize(vector<uint8_t>& out, bool includeSettings);
+	void Serialize(vector<uint8_t>& out, bool includeSettings, SerializeFormat format);
 	bool Deserialize(istream& in, uint32_t fileFormatVersion, bool includeSettings, optional<ConsoleType> consoleType = std::nullopt, bool sendNotification = true);
+	bool Deserialize(const vector<uint8_t>& in, bool includeSettings, bool sendNotification = true);
 
 	SoundMixer* GetSoundMixer() { return _soundMixer.get(); }
 	VideoRenderer* GetVideoRenderer() { return _videoRenderer.get(); }
@@ -198,6 +221,7 @@ public:
 	HistoryViewer* GetHistoryViewer() { return _historyViewer.get(); }
 	GameServer* GetGameServer() { return _gameServer.get(); }
 	GameClient* GetGameClient() { return _gameClient.get(); }
+	void SetNetplayClient(GameClientConnection* client) { _netplayClient = client; }
 	shared_ptr<SystemActionManager> GetSystemActionManager() { return _systemActionManager; }
 
 	BaseVideoFilter* GetVideoFilter(bool getDefaultFilter = false);
@@ -118,9 +118,19 @@ bool HistoryViewer::CreateSaveState(string outputFile, uint32_t position)
 	position /= RewindManager::BufferSize;
 	position = std::min(position, (uint32_t)_history.size() - 1);
 
+	//Rewind data uses the positional format, load it and save it again in the regular format
+	auto lock = _emu->AcquireLock();
+	vector<uint8_t> currentState;
+	_emu->Serialize(currentState, true);
+
+	RewindData rewindData = _history[position];
+	rewindData.LoadState(_emu, _history, position, false);
+
 	std::stringstream stateData;
 	_emu->GetSaveStateManager()->GetSaveStateHeader(stateData);
-	_history[position].GetStateData(stateData, _history, position);
+	_emu->Serialize(stateData, true);
+
+	_emu->Deserialize(currentState, true, false);
 
 	ofstream output(outputFile, ios::binary);
 	if(output) {
@@ -138,16 +148,16 @@ bool HistoryViewer::SaveMovie(string movieFile, uint32_t startPosition, uint32_t
 
 	//Take a savestate to be able to restore it after generating the movie file
 	//(the movie generation uses the console's inputs, which could affect the emulation otherwise)
-	stringstream state;
+	vector<uint8_t> state;
 	auto lock = _emu->AcquireLock();
-	_emu->Serialize(state, true, false);
+	_emu->Serialize(state, true);
 
 	//Convert the rewind data to a .mmo file
 	unique_ptr<MovieRecorder> recorder(new MovieRecorder(_emu));
 	bool result = recorder->CreateMovie(movieFile, _history, startPosition, endPosition, _mainEmu->GetBatteryManager()->HasBattery());
 
 	//Resume the state and resume
-	_emu->Deserialize(state, SaveStateManager::FileFormatVersion, true);
+	_emu->Deserialize(state, true);
 	return result;
 }
 
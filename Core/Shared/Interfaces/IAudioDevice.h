@@ -6,7 +6,11 @@ struct AudioStatistics
 {
 	double AverageLatency = 0;
 	uint32_t BufferUnderrunEventCount = 0;
+	uint32_t BufferOverrunEventCount = 0;
 	uint32_t BufferSize = 0;
+
+	//The device adjusts its own playback rate to keep its buffer filled (low latency mode)
+	bool PullMode = false;
 };
 
 class IAudioDevice
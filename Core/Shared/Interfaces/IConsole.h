@@ -38,6 +38,17 @@ struct PpuFrameInfo
 	uint32_t CycleCount;
 };
 
+//Decoded texture cache used by HD packs with a texture budget (Budget is 0 when there is no budget)
+struct TextureCacheStats
+{
+	uint64_t Budget;
+	uint64_t Hits;
+	uint64_t Misses;
+	uint64_t Decodes;
+	uint64_t Evictions;
+	int64_t ResidentBytes;
+};
+
 enum class ShortcutState
 {
 	Disabled = 0,
@@ -63,6 +74,7 @@ public:
 	virtual BaseControlManager* GetControlManager() = 0;
 
 	virtual DipSwitchInfo GetDipSwitchInfo() { return {}; }
+	virtual TextureCacheStats GetTextureCacheStats() { return {}; }
 	virtual ConsoleRegion GetRegion() = 0;
 	virtual ConsoleType GetConsoleType() = 0;
 	virtual vector<CpuType> GetCpuTypes() = 0;
@@ -210,7 +210,10 @@ bool MovieRecorder::CreateMovie(string movieFile, deque<RewindData> &data, uint3
 			_hasSaveState = true;
 			_saveStateData = stringstream();
 			_emu->GetSaveStateManager()->GetSaveStateHeader(_saveStateData);
-			data[startPosition].GetStateData(_saveStateData, data, startPosition);
+			//Rewind data uses the positional format, load it and save it again in the regular format
+			RewindData rewindData = data[startPosition];
+			rewindData.LoadState(_emu, data, startPosition, false);
+			_emu->Serialize(_saveStateData, true, 0);
 		}
 
 		_inputData = stringstream();
@@ -1,78 +1,125 @@
 #include "pch.h"
 #include "Shared/RewindData.h"
 #include "Shared/Emulator.h"
-#include "Shared/SaveStateManager.h"
 #include "Utilities/CompressionHelper.h"
 
-void RewindData::GetStateData(stringstream &stateData, deque<RewindData>& prevStates, int32_t position)
+void RewindData::XorBuffers(vector<uint8_t>& data, vector<uint8_t>& keyFrame)
 {
-	vector<uint8_t> data;
-	CompressionHelper::Decompress(_saveStateData, data);
+	uint8_t* dst = data.data();
+	uint8_t* src = keyFrame.data();
+	size_t len = std::min(keyFrame.size(), data.size());
 
-	if(!IsFullState) {
-		position = (position > 0 ? position : (int32_t)prevStates.size()) - 1;
-		ProcessXorState(data, prevStates, position);
+	//Process 8 bytes at a time (the compiler turns this into SIMD code)
+	size_t i = 0;
+	for(; i + 8 <= len; i += 8) {
+		uint64_t a, b;
+		memcpy(&a, dst + i, sizeof(uint64_t));
+		memcpy(&b, src + i, sizeof(uint64_t));
+		a ^= b;
+		memcpy(dst + i, &a, sizeof(uint64_t));
 	}
 
-	stateData.write((char*)data.data(), data.size());
+	for(; i < len; i++) {
+		dst[i] ^= src[i];
+	}
 }
 
-template<typename T>
-void RewindData::ProcessXorState(T& data, deque<RewindData>& prevStates, int32_t position)
+vector<uint8_t>* RewindData::GetKeyFrame(deque<RewindData>& prevStates, int32_t position, RewindStateBuffers& buffers)
 {
-	//Find last full state and XOR with it
+	//Find last full state
 	while(position >= 0 && position < prevStates.size()) {
 		RewindData& prevState = prevStates[position];
 		if(prevState.IsFullState) {
-			//XOR with previous state to restore state data to its initial state
-			vector<uint8_t> prevStateData;
-			CompressionHelper::Decompress(prevState._saveStateData, prevStateData);
-			for(size_t i = 0, len = std::min(prevStateData.size(), data.size()); i < len; i++) {
-				data[i] ^= prevStateData[i];
+			if(prevState._keyFrameId == 0 || prevState._keyFrameId != buffers.KeyFrameId) {
+				CompressionHelper::Decompress(prevState._saveStateData, buffers.KeyFrame);
+				buffers.KeyFrameId = prevState._keyFrameId;
 			}
-			break;
+			return &buffers.KeyFrame;
 		}
 		position--;
 	}
+	return nullptr;
 }
 
-void RewindData::LoadState(Emulator* emu, deque<RewindData>& prevStates, int32_t position, bool sendNotification)
+void RewindData::XorWithKeyFrame(vector<uint8_t>& data, deque<RewindData>& prevStates, int32_t position, RewindStateBuffers& buffers)
+{
+	//XOR with previous full state to restore state data to its initial state
+	vector<uint8_t>* keyFrame = GetKeyFrame(prevStates, position, buffers);
+	if(keyFrame) {
+		XorBuffers(data, *keyFrame);
+	}
+}
+
+void RewindData::LoadState(Emulator* emu, deque<RewindData>& prevStates, int32_t position, bool sendNotification, RewindStateBuffers* buffers)
 {
 	if(_saveStateData.size() == 0) {
 		return;
 	}
-		
-	vector<uint8_t> data;
+
+	RewindStateBuffers localBuffers;
+	if(!buffers) {
+		buffers = &localBuffers;
+	}
+
+	if(IsFullState && _keyFrameId != 0 && _keyFrameId == buffers->KeyFrameId) {
+		//This is the cached key frame, no need to decompress it
+		emu->Deserialize(buffers->KeyFrame, true, sendNotification);
+		return;
+	}
+
+	vector<uint8_t>& data = buffers->State;
 	CompressionHelper::Decompress(_saveStateData, data);
 
 	if(!IsFullState) {
 		position = (position > 0 ? position : (int32_t)prevStates.size()) - 1;
-		ProcessXorState(data, prevStates, position);
+		XorWithKeyFrame(data, prevStates, position, *buffers);
 	}
 
-	stringstream stream;
-	stream.write((char*)data.data(), data.size());
-	stream.seekg(0, ios::beg);
-
-	emu->Deserialize(stream, SaveStateManager::FileFormatVersion, true, std::nullopt, sendNotification);
+	emu->Deserialize(data, true, sendNotification);
 }
 
-void RewindData::SaveState(Emulator* emu, deque<RewindData>& prevStates, int32_t position)
+void RewindData::SaveState(Emulator* emu, deque<RewindData>& prevStates, RewindStateBuffers& buffers, int32_t position)
 {
-	std::stringstream state;
-	emu->Serialize(state, true, 0);
-
-	string data = state.str();
+	vector<uint8_t>& data = buffers.State;
+	emu->Serialize(data, true);
 
 	position = position > 0 ? position : (int32_t)prevStates.size();
 
-	if(position > 0 && (position % 30) != 0) {
+	_saveStateData.clear();
+	if(position > 0 && (position % RewindData::KeyFrameInterval) != 0) {
 		position--;
-		ProcessXorState(data, prevStates, position);
+		XorWithKeyFrame(data, prevStates, position, buffers);
+		CompressionHelper::CompressFast(data.data(), data.size(), _saveStateData);
 	} else {
 		IsFullState = true;
+		CompressionHelper::CompressFast(data.data(), data.size(), _saveStateData);
+
+		//Keep the uncompressed data to encode the next states without having to decompress it
+		_keyFrameId = buffers.NextKeyFrameId++;
+		buffers.KeyFrameId = _keyFrameId;
+		std::swap(buffers.KeyFrame, buffers.State);
 	}
 
-	CompressionHelper::Compress(data, 1, _saveStateData);
 	FrameCount = 0;
 }
+
+uint32_t RewindData::GetMemoryUsage()
+{
+	size_t size = sizeof(RewindData) + _saveStateData.capacity();
+	for(int i = 0; i < BaseControlDevice::PortCount; i++) {
+		if(!InputLogs[i].empty()) {
+			size += InputLogs[i].size() * (sizeof(ControlDeviceState) + InputLogs[i].front().State.size());
+		}
+	}
+	return (uint32_t)size;
+}
+
+void RewindData::Recompress(int compressionLevel)
+{
+	vector<uint8_t> data;
+	if(CompressionHelper::Decompress(_saveStateData, data)) {
+		_saveStateData.clear();
+		CompressionHelper::Compress(string((char*)data.data(), data.size()), compressionLevel, _saveStateData);
+		_saveStateData.shrink_to_fit();
+	}
+}
@@ -5,23 +5,50 @@
 
 class Emulator;
 
+//Buffers reused by the rewind manager for every state it saves/loads
+struct RewindStateBuffers
+{
+	//Uncompressed copy of the last full state used to encode/decode the XOR deltas
+	vector<uint8_t> KeyFrame;
+	uint32_t KeyFrameId = 0;
+	uint32_t NextKeyFrameId = 1;
+
+	vector<uint8_t> State;
+};
+
+enum class RewindTier : uint8_t
+{
+	Recent = 0, //Full resolution
+	Thinned = 1, //Only some of the full states are kept, the other states are removed
+	Archived = 2 //Thinned, and recompressed with a higher compression level
+};
+
 class RewindData
 {
 private:
 	vector<uint8_t> _saveStateData;
+	uint32_t _keyFrameId = 0;
 
-	template<typename T>
-	void ProcessXorState(T& data, deque<RewindData>& prevStates, int32_t position);
+	static void XorBuffers(vector<uint8_t>& data, vector<uint8_t>& keyFrame);
+	vector<uint8_t>* GetKeyFrame(deque<RewindData>& prevStates, int32_t position, RewindStateBuffers& buffers);
+	void XorWithKeyFrame(vector<uint8_t>& data, deque<RewindData>& prevStates, int32_t position, RewindStateBuffers& buffers);
 
 public:
+	static constexpr int32_t KeyFrameInterval = 30; //Number of states between each full state
+
 	std::deque<ControlDeviceState> InputLogs[BaseControlDevice::PortCount];
 	int32_t FrameCount = 0;
 	bool EndOfSegment = false;
 	bool IsFullState = false;
+	RewindTier Tier = RewindTier::Recent;
+	bool NeedRecompress = false; //Archived, but not recompressed yet
 
-	void GetStateData(stringstream& stateData, deque<RewindData>& prevStates, int32_t position);
 	uint32_t GetStateSize() { return (uint32_t)_saveStateData.size(); }
+	uint32_t GetMemoryUsage();
+	uint32_t GetKeyFrameId() { return _keyFrameId; }
+
+	void Recompress(int compressionLevel);
 
-	void LoadState(Emulator* emu, deque<RewindData>& prevStates, int32_t position = -1, bool sendNotification = true);
-	void SaveState(Emulator* emu, deque<RewindData>& prevStates, int32_t position = -1);
+	void LoadState(Emulator* emu, deque<RewindData>& prevStates, int32_t position = -1, bool sendNotification = true, RewindStateBuffers* buffers = nullptr);
+	void SaveState(Emulator* emu, deque<RewindData>& prevStates, RewindStateBuffers& buffers, int32_t position = -1);
 };
@@ -45,6 +45,7 @@ void RewindManager::ClearBuffer()
 	_hasHistory = false;
 	_history.clear();
 	_historyBackup.clear();
+	_recompressPosition = 0;
 	_framesToFastForward = 0;
 	_videoHistory.clear();
 	_videoHistoryBuilder.clear();
@@ -90,6 +91,7 @@ void RewindManager::ProcessNotification(ConsoleNotificationType type, void * par
 			
 				case RewindState::Stopped:
 					_currentHistory.FrameCount++;
+					RecompressArchivedState();
 					break;
 			}
 		} else {
@@ -106,44 +108,152 @@ void RewindManager::ProcessNotification(ConsoleNotificationType type, void * par
 
 RewindStats RewindManager::GetStats()
 {
-	uint32_t memoryUsage = 0;
-	for(int i = (int)_history.size() - 1; i >= 0; i--) {
-		memoryUsage += _history[i].GetStateSize();
-	}
-	
 	RewindStats stats = {};
-	stats.MemoryUsage = memoryUsage;
+	for(RewindData& data : _history) {
+		stats.MemoryUsage += data.GetMemoryUsage();
+		switch(data.Tier) {
+			case RewindTier::Recent:
+				stats.HistoryDuration += RewindManager::BufferSize;
+				break;
+
+			case RewindTier::Thinned:
+			case RewindTier::Archived:
+				//Each remaining state also covers the time of the removed states that followed it (approximately)
+				stats.HistoryDuration += RewindManager::BufferSize * RewindManager::ThinnedKeyFrameInterval;
+				if(data.Tier == RewindTier::Thinned) {
+					stats.ThinnedStates++;
+				} else {
+					stats.ArchivedStates++;
+				}
+				break;
+		}
+	}
+
+	stats.MemoryLimit = (uint64_t)_settings->GetPreferences().RewindBufferSize << 20;
 	stats.HistorySize = (uint32_t)_history.size();
-	stats.HistoryDuration = stats.HistorySize * RewindManager::BufferSize;
 	return stats;
 }
 
-void RewindManager::AddHistoryBlock()
+void RewindManager::EnforceMemoryLimit(uint64_t memoryLimit)
 {
-	uint32_t maxHistorySize = _settings->GetPreferences().RewindBufferSize;
-	if(maxHistorySize > 0) {
-		uint32_t memoryUsage = 0;
-		for(int i = (int)_history.size() - 1; i >= 0; i--) {
-			memoryUsage += _history[i].GetStateSize();
-			if((memoryUsage >> 20) >= maxHistorySize) {
-				//Remove all old state data above the memory limit
-				for(int j = 0; j < i; j++) {
-					_history.pop_front();
+	uint64_t memoryUsage = 0;
+	for(RewindData& data : _history) {
+		memoryUsage += data.GetMemoryUsage();
+	}
+
+	if(memoryUsage <= memoryLimit) {
+		return;
+	}
+
+	//Find where the thinned & archived tiers start, based on the memory used by the more recent states
+	int32_t thinnedEnd = -1;
+	int32_t archivedEnd = -1;
+	uint64_t usage = 0;
+	for(int32_t i = (int32_t)_history.size() - 1; i >= 0; i--) {
+		usage += _history[i].GetMemoryUsage();
+		if(thinnedEnd < 0 && usage > memoryLimit / 2) {
+			thinnedEnd = i + 1;
+		}
+		if(usage > memoryLimit * 3 / 4) {
+			archivedEnd = i + 1;
+			break;
+		}
+	}
+
+	//The states after the thinned tier must still be able to reach their full state, so the tier ends on a full state
+	thinnedEnd = std::min(thinnedEnd, (int32_t)_history.size() - 1);
+	while(thinnedEnd > 0 && !_history[thinnedEnd].IsFullState) {
+		thinnedEnd--;
+	}
+
+	if(thinnedEnd > 0) {
+		size_t pos = 0;
+		size_t recompressPosition = SIZE_MAX;
+		bool keepGroup = true;
+		for(int32_t i = 0; i < (int32_t)_history.size(); i++) {
+			RewindData& data = _history[i];
+			if(i < thinnedEnd) {
+				if(data.IsFullState) {
+					//Full states are kept or removed along with the delta states that follow them - delta states
+					//can't be loaded without their full state, and their input logs are needed to replay the history
+					keepGroup = data.Tier != RewindTier::Recent || (data.GetKeyFrameId() % RewindManager::ThinnedKeyFrameInterval) == 0;
 				}
 
-				while(_history.size() > 0 && !_history.front().IsFullState) {
-					//Remove everything until the next full state
-					_history.pop_front();
+				if(!keepGroup) {
+					if(pos > 0) {
+						//The states after this one were removed, mark it as the end of a segment (for the history viewer)
+						_history[pos - 1].EndOfSegment = true;
+					}
+					continue;
 				}
-				break;
+
+				if(data.Tier == RewindTier::Recent) {
+					data.Tier = RewindTier::Thinned;
+				}
+
+				if(i < archivedEnd && data.Tier == RewindTier::Thinned) {
+					data.Tier = RewindTier::Archived;
+					data.NeedRecompress = true;
+				}
+			}
+
+			if(recompressPosition == SIZE_MAX && ((size_t)i >= _recompressPosition || data.NeedRecompress)) {
+				recompressPosition = pos;
+			}
+
+			if(pos != (size_t)i) {
+				_history[pos] = std::move(data);
 			}
+			pos++;
 		}
+		_history.resize(pos);
+		_recompressPosition = std::min(recompressPosition, pos);
 
+		memoryUsage = 0;
+		for(RewindData& data : _history) {
+			memoryUsage += data.GetMemoryUsage();
+		}
+	}
+
+	//Remove the oldest states until the history fits in the memory limit
+	while(!_history.empty() && memoryUsage > memoryLimit) {
+		memoryUsage -= _history.front().GetMemoryUsage();
+		_history.pop_front();
+		_recompressPosition -= _recompressPosition > 0 ? 1 : 0;
+	}
+
+	while(!_history.empty() && !_history.front().IsFullState) {
+		//Remove everything until the next full state
+		_history.pop_front();
+		_recompressPosition -= _recompressPosition > 0 ? 1 : 0;
+	}
+}
+
+void RewindManager::RecompressArchivedState()
+{
+	//Archived states are at the start of the history, stop at the first state that isn't archived
+	//The scan resumes where it stopped on the previous frame, instead of starting over from the oldest state
+	while(_recompressPosition < _history.size() && _history[_recompressPosition].Tier == RewindTier::Archived) {
+		RewindData& data = _history[_recompressPosition++];
+		if(data.NeedRecompress) {
+			data.Recompress(RewindManager::ArchiveCompressionLevel);
+			data.NeedRecompress = false;
+			break;
+		}
+	}
+}
+
+void RewindManager::AddHistoryBlock()
+{
+	uint32_t maxHistorySize = _settings->GetPreferences().RewindBufferSize;
+	if(maxHistorySize > 0) {
 		if(_currentHistory.FrameCount > 0) {
 			_history.push_back(_currentHistory);
 		}
+		EnforceMemoryLimit((uint64_t)maxHistorySize << 20);
+
 		_currentHistory = RewindData();
-		_currentHistory.SaveState(_emu, _history);
+		_currentHistory.SaveState(_emu, _history, _stateBuffers);
 	}
 }
 
@@ -165,7 +275,7 @@ void RewindManager::PopHistory()
 		}
 
 		_historyBackup.push_front(_currentHistory);
-		_currentHistory.LoadState(_emu, _history, -1, false);
+		_currentHistory.LoadState(_emu, _history, -1, false, &_stateBuffers);
 
 		if(!_audioHistoryBuilder.empty()) {
 			_audioHistory.insert(_audioHistory.begin(), _audioHistoryBuilder.begin(), _audioHistoryBuilder.end());
@@ -272,7 +382,7 @@ void RewindManager::Stop()
 			_framesToFastForward = _historyBackup.front().FrameCount;
 		}
 
-		_currentHistory.LoadState(_emu, _history);
+		_currentHistory.LoadState(_emu, _history, -1, true, &_stateBuffers);
 		if(_framesToFastForward > 0) {
 			_rewindState = RewindState::Stopping;
 			_currentHistory.FrameCount = 0;
@@ -452,7 +562,7 @@ void RewindManager::RewindSeconds(uint32_t seconds)
 				break;
 			}
 		}
-		_currentHistory.LoadState(_emu, _history);
+		_currentHistory.LoadState(_emu, _history, -1, true, &_stateBuffers);
 	}
 }
 
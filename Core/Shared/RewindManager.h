@@ -31,9 +31,12 @@ struct VideoFrame
 
 struct RewindStats
 {
-	uint32_t MemoryUsage;
+	uint64_t MemoryUsage;
+	uint64_t MemoryLimit;
 	uint32_t HistorySize;
 	uint32_t HistoryDuration;
+	uint32_t ThinnedStates;
+	uint32_t ArchivedStates;
 };
 
 class RewindManager : public INotificationListener, public IInputProvider, public IInputRecorder
@@ -41,6 +44,14 @@ class RewindManager : public INotificationListener, public IInputProvider, publi
 public:
 	static constexpr int32_t BufferSize = 30; //Number of frames between each save state
 
+	//Once the memory limit is reached, the oldest part of the history is compacted before anything is removed:
+	//the most recent half of the memory keeps all states, the next quarter only keeps 1 full state (along with the
+	//delta states that follow it) out of ThinnedKeyFrameInterval, and the oldest quarter also has these states
+	//recompressed with a higher level. Removing entire groups keeps the input logs of the remaining states complete.
+	static constexpr int32_t ThinnedKeyFrameInterval = 2;
+	//Archived states are recompressed one per frame (see RecompressArchivedState), to avoid frame time spikes
+	static constexpr int ArchiveCompressionLevel = 6;
+
 private:
 	Emulator* _emu = nullptr;
 	EmuSettings* _settings = nullptr;
@@ -50,6 +61,9 @@ private:
 	deque<RewindData> _history;
 	deque<RewindData> _historyBackup;
 	RewindData _currentHistory = {};
+	RewindStateBuffers _stateBuffers;
+	//Index of the next archived state to check in RecompressArchivedState (the states before it don't need to be recompressed)
+	size_t _recompressPosition = 0;
 
 	RewindState _rewindState = RewindState::Stopped;
 	int32_t _framesToFastForward = 0;
@@ -60,6 +74,8 @@ private:
 	vector<int16_t> _audioHistoryBuilder;
 
 	void AddHistoryBlock();
+	void EnforceMemoryLimit(uint64_t memoryLimit);
+	void RecompressArchivedState();
 	void PopHistory();
 
 	void Start(bool forDebugger);
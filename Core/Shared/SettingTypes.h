@@ -118,6 +118,7 @@ struct AudioConfig
 	const char* AudioDevice = nullptr;
 	bool EnableAudio = true;
 	bool DisableDynamicSampleRate = false;
+	bool LowLatencyMode = false;
 
 	uint32_t MasterVolume = 100;
 	uint32_t SampleRate = 48000;
@@ -532,6 +533,7 @@ struct NesConfig
 
 	ConsoleRegion Region = ConsoleRegion::Auto;
 	bool EnableHdPacks = true;
+	uint32_t HdPackTextureBudget = 0;
 	bool DisableGameDatabase = false;
 	bool FdsAutoLoadDisk = true;
 	bool FdsFastForwardOnLoad = false;
@@ -23,7 +23,9 @@ void DebugHud::ClearScreen()
 {
 	auto lock = _commandLock.AcquireSafe();
 	_commands.clear();
-	_drawPixels.clear();
+	_commandData.clear();
+	_commandCount = 0;
+	_needFullUpdate = true;
 }
 
 bool DebugHud::Draw(uint32_t* argbBuffer, FrameInfo frameInfo, OverscanDimensions overscan, uint32_t frameNumber, HudScaleFactors scaleFactors, bool clearAndUpdate)
@@ -32,64 +34,182 @@ bool DebugHud::Draw(uint32_t* argbBuffer, FrameInfo frameInfo, OverscanDimension
 
 	bool isDirty = false;
 	if(clearAndUpdate) {
-		unordered_map<uint32_t, uint32_t> drawPixels;
-		drawPixels.reserve(1000);
-		for(unique_ptr<DrawCommand>& command : _commands) {
-			command->Draw(&drawPixels, argbBuffer, frameInfo, overscan, frameNumber, scaleFactors);
+		if(_layerSize.Width != frameInfo.Width || _layerSize.Height != frameInfo.Height) {
+			_layerSize = frameInfo;
+			_layer.assign(frameInfo.Width * frameInfo.Height, 0);
+
+			uint32_t tileCount = DrawCommandRasterizer::GetTileColumns(frameInfo) * DrawCommandRasterizer::GetTileRows(frameInfo);
+			_dirtyTiles.assign((tileCount + 63) / 64, 0);
+			_prevDirtyTiles.assign((tileCount + 63) / 64, 0);
+			_needFullUpdate = true;
 		}
 
-		isDirty = drawPixels.size() != _drawPixels.size();
-		if(!isDirty) {
-			for(auto keyValue : drawPixels) {
-				auto match = _drawPixels.find(keyValue.first);
-				if(match != _drawPixels.end()) {
-					if(keyValue.second != match->second) {
-						isDirty = true;
-						break;
-					}
-				} else {
-					isDirty = true;
-					break;
-				}
-			}
+		_rasterizer.SetTarget(_layer.data(), frameInfo, overscan, scaleFactors, _dirtyTiles.data());
+		DrawCommands(frameNumber);
+		isDirty = UpdateOutput(argbBuffer);
+	} else {
+		isDirty = true;
+		_rasterizer.SetTarget(argbBuffer, frameInfo, overscan, scaleFactors, nullptr);
+		DrawCommands(frameNumber);
+	}
+
+	RemoveExpiredCommands();
+
+	return isDirty;
+}
+
+void DebugHud::DrawCommands(uint32_t frameNumber)
+{
+	for(DrawCommand& cmd : _commands) {
+		if(cmd.StartFrame < 0) {
+			//When no start frame was specified, start on the next drawn frame
+			cmd.StartFrame = frameNumber;
 		}
 
-		if(isDirty) {
-			memset(argbBuffer, 0, frameInfo.Height * frameInfo.Width * sizeof(uint32_t));
-			for(auto keyValue : drawPixels) {
-				argbBuffer[keyValue.first] = keyValue.second;
+		if(cmd.StartFrame <= (int32_t)frameNumber) {
+			_rasterizer.SetIntegerScaling(cmd.UseIntegerScaling);
+
+			switch(cmd.Type) {
+				case DrawCommandType::Pixel: DrawPixelCommand::Draw(_rasterizer, cmd); break;
+				case DrawCommandType::Line: DrawLineCommand::Draw(_rasterizer, cmd); break;
+				case DrawCommandType::Rectangle: DrawRectangleCommand::Draw(_rasterizer, cmd); break;
+				case DrawCommandType::String: DrawStringCommand::Draw(_rasterizer, cmd, (char*)_commandData.data() + cmd.DataOffset, cmd.DataSize); break;
+				case DrawCommandType::ScreenBuffer: DrawScreenBufferCommand::Draw(_rasterizer, cmd, _commandData.data() + cmd.DataOffset); break;
 			}
-			_drawPixels = drawPixels;
+
+			cmd.FrameCount--;
 		}
-	} else {
-		isDirty = true;
-		for(unique_ptr<DrawCommand>& command : _commands) {
-			command->Draw(nullptr, argbBuffer, frameInfo, overscan, frameNumber, scaleFactors);
+	}
+}
+
+bool DebugHud::UpdateOutput(uint32_t* argbBuffer)
+{
+	uint32_t width = _layerSize.Width;
+	uint32_t height = _layerSize.Height;
+	uint32_t tileColumns = DrawCommandRasterizer::GetTileColumns(_layerSize);
+	constexpr uint32_t tileSize = 1 << DrawCommandRasterizer::TileShift;
+
+	bool isDirty = false;
+	if(_needFullUpdate) {
+		size_t size = (size_t)width * height * sizeof(uint32_t);
+		if(size > 0 && memcmp(argbBuffer, _layer.data(), size) != 0) {
+			memcpy(argbBuffer, _layer.data(), size);
+			isDirty = true;
 		}
+		_needFullUpdate = false;
 	}
 
-	_commands.erase(std::remove_if(_commands.begin(), _commands.end(), [](const unique_ptr<DrawCommand>& c) { return c->Expired(); }), _commands.end());
-	_commandCount = (uint32_t)_commands.size();
+	for(size_t i = 0; i < _dirtyTiles.size(); i++) {
+		uint64_t tiles = _dirtyTiles[i] | _prevDirtyTiles[i];
+		if(tiles == 0) {
+			continue;
+		}
+
+		for(uint32_t bit = 0; bit < 64; bit++) {
+			if(!(tiles & ((uint64_t)1 << bit))) {
+				continue;
+			}
+
+			uint32_t tile = (uint32_t)i * 64 + bit;
+			uint32_t left = (tile % tileColumns) * tileSize;
+			uint32_t top = (tile / tileColumns) * tileSize;
+			uint32_t rowSize = std::min(tileSize, width - left) * sizeof(uint32_t);
+			uint32_t bottom = std::min(top + tileSize, height);
+
+			//Copy tiles that changed since the last frame to the output
+			bool changed = false;
+			for(uint32_t y = top; y < bottom && !changed; y++) {
+				changed = memcmp(argbBuffer + y * width + left, _layer.data() + y * width + left, rowSize) != 0;
+			}
+
+			if(changed) {
+				for(uint32_t y = top; y < bottom; y++) {
+					memcpy(argbBuffer + y * width + left, _layer.data() + y * width + left, rowSize);
+				}
+				isDirty = true;
+			}
+
+			if(_dirtyTiles[i] & ((uint64_t)1 << bit)) {
+				//Clear the tile to prepare the layer for the next frame
+				for(uint32_t y = top; y < bottom; y++) {
+					memset(_layer.data() + y * width + left, 0, rowSize);
+				}
+			}
+		}
+	}
+
+	_prevDirtyTiles.swap(_dirtyTiles);
+	std::fill(_dirtyTiles.begin(), _dirtyTiles.end(), 0);
 
 	return isDirty;
 }
 
+uint32_t DebugHud::AlignDataOffset(vector<uint8_t>& data)
+{
+	//Keep screen buffers aligned on 4 bytes
+	uint32_t offset = ((uint32_t)data.size() + 3) & ~3;
+	data.resize(offset);
+	return offset;
+}
+
+void DebugHud::RemoveExpiredCommands()
+{
+	size_t count = _commands.size();
+	_commands.erase(std::remove_if(_commands.begin(), _commands.end(), [](DrawCommand& c) { return c.Expired(); }), _commands.end());
+	_commandCount = (uint32_t)_commands.size();
+
+	if(_commands.empty()) {
+		//Typical case for scripts that draw every frame - reset the arena
+		_commandData.clear();
+	} else if(_commands.size() != count && !_commandData.empty()) {
+		//Some commands remain, move their data to the start of the arena
+		_compactedData.clear();
+		for(DrawCommand& cmd : _commands) {
+			if(cmd.DataSize > 0) {
+				uint32_t offset = AlignDataOffset(_compactedData);
+				_compactedData.insert(_compactedData.end(), _commandData.begin() + cmd.DataOffset, _commandData.begin() + cmd.DataOffset + cmd.DataSize);
+				cmd.DataOffset = offset;
+			}
+		}
+		_commandData.swap(_compactedData);
+	}
+}
+
+void DebugHud::AddCommand(DrawCommand cmd, const void* data, uint32_t dataSize)
+{
+	auto lock = _commandLock.AcquireSafe();
+	if(_commands.size() < DebugHud::MaxCommandCount) {
+		if(dataSize > 0) {
+			cmd.DataOffset = AlignDataOffset(_commandData);
+			cmd.DataSize = dataSize;
+			_commandData.insert(_commandData.end(), (uint8_t*)data, (uint8_t*)data + dataSize);
+		}
+		_commands.push_back(cmd);
+		_commandCount++;
+	}
+}
+
 void DebugHud::DrawPixel(int x, int y, int color, int frameCount, int startFrame)
 {
-	AddCommand(unique_ptr<DrawCommand>(new DrawPixelCommand(x, y, color, frameCount, startFrame)));
+	AddCommand(DrawPixelCommand::Create(x, y, color, frameCount, startFrame));
 }
 
 void DebugHud::DrawLine(int x, int y, int x2, int y2, int color, int frameCount, int startFrame)
 {
-	AddCommand(unique_ptr<DrawCommand>(new DrawLineCommand(x, y, x2, y2, color, frameCount, startFrame)));
+	AddCommand(DrawLineCommand::Create(x, y, x2, y2, color, frameCount, startFrame));
 }
 
 void DebugHud::DrawRectangle(int x, int y, int width, int height, int color, bool fill, int frameCount, int startFrame)
 {
-	AddCommand(unique_ptr<DrawCommand>(new DrawRectangleCommand(x, y, width, height, color, fill, frameCount, startFrame)));
+	AddCommand(DrawRectangleCommand::Create(x, y, width, height, color, fill, frameCount, startFrame));
 }
 
 void DebugHud::DrawString(int x, int y, string text, int color, int backColor, int frameCount, int startFrame, int maxWidth)
 {
-	AddCommand(unique_ptr<DrawCommand>(new DrawStringCommand(x, y, text, color, backColor, frameCount, startFrame, maxWidth)));
+	AddCommand(DrawStringCommand::Create(x, y, color, backColor, frameCount, startFrame, maxWidth), text.c_str(), (uint32_t)text.size());
+}
+
+void DebugHud::DrawScreenBuffer(uint32_t* buffer, uint32_t width, uint32_t height, int startFrame)
+{
+	AddCommand(DrawScreenBufferCommand::Create(width, height, startFrame), buffer, width * height * sizeof(uint32_t));
 }
@@ -3,15 +3,36 @@
 #include "Utilities/SimpleLock.h"
 #include "Shared/SettingTypes.h"
 #include "Shared/Video/DrawCommand.h"
+#include "Shared/Video/DrawCommandRasterizer.h"
 
 class DebugHud
 {
 private:
 	static constexpr size_t MaxCommandCount = 500000;
-	vector<unique_ptr<DrawCommand>> _commands;
+
+	//Commands are stored by value, and their text/pixel data in a separate arena - both vectors keep
+	//their capacity, so no allocations are needed once the HUD has been drawn a few times
+	vector<DrawCommand> _commands;
+	vector<uint8_t> _commandData;
+	vector<uint8_t> _compactedData;
 	atomic<uint32_t> _commandCount;
 	SimpleLock _commandLock;
-	unordered_map<uint32_t, uint32_t> _drawPixels;
+
+	DrawCommandRasterizer _rasterizer;
+
+	//Used when clearAndUpdate is set: commands are drawn to _layer, and only the tiles that were
+	//drawn to during this frame or the previous one are compared with/copied to the output buffer
+	vector<uint32_t> _layer;
+	vector<uint64_t> _dirtyTiles;
+	vector<uint64_t> _prevDirtyTiles;
+	FrameInfo _layerSize = {};
+	bool _needFullUpdate = true;
+
+	static uint32_t AlignDataOffset(vector<uint8_t>& data);
+	void AddCommand(DrawCommand cmd, const void* data = nullptr, uint32_t dataSize = 0);
+	void DrawCommands(uint32_t frameNumber);
+	void RemoveExpiredCommands();
+	bool UpdateOutput(uint32_t* argbBuffer);
 
 public:
 	DebugHud();
@@ -26,13 +47,5 @@ public:
 	void DrawLine(int x, int y, int x2, int y2, int color, int frameCount, int startFrame = -1);
 	void DrawRectangle(int x, int y, int width, int height, int color, bool fill, int frameCount, int startFrame = -1);
 	void DrawString(int x, int y, string text, int color, int backColor, int frameCount, int startFrame = -1, int maxWidth = 0);
-
-	__forceinline void AddCommand(unique_ptr<DrawCommand> cmd)
-	{
-		auto lock = _commandLock.AcquireSafe();
-		if(_commands.size() < DebugHud::MaxCommandCount) {
-			_commands.push_back(std::move(cmd));
-			_commandCount++;
-		}
-	}
+	void DrawScreenBuffer(uint32_t* buffer, uint32_t width, uint32_t height, int startFrame);
 };
@@ -6,6 +6,8 @@
 #include "Shared/Emulator.h"
 #include "Shared/RewindManager.h"
 #include "Shared/EmuSettings.h"
+#include "Shared/Video/VideoDecoder.h"
+#include "Shared/Interfaces/IConsole.h"
 
 void DebugStats::DisplayStats(Emulator *emu, double lastFrameTime)
 {
@@ -29,7 +31,7 @@ void DebugStats::DisplayStats(Emulator *emu, double lastFrameTime)
 	ss << std::fixed << std::setprecision(2) << stats.AverageLatency << " ms";
 	hud->DrawString(54, 21, ss.str(), color, 0xFF000000, 1, startFrame);
 
-	hud->DrawString(10, 30, "Underruns: " + std::to_string(stats.BufferUnderrunEventCount), 0xFFFFFF, 0xFF000000, 1, startFrame);
+	hud->DrawString(10, 30, "Under/Overruns: " + std::to_string(stats.BufferUnderrunEventCount) + "/" + std::to_string(stats.BufferOverrunEventCount), 0xFFFFFF, 0xFF000000, 1, startFrame);
 	hud->DrawString(10, 39, "Buffer Size: " + std::to_string(stats.BufferSize / 1024) + "kb", 0xFFFFFF, 0xFF000000, 1, startFrame);
 	hud->DrawString(10, 48, "Rate: " + std::to_string((uint32_t)(audioCfg.SampleRate * emu->GetSoundMixer()->GetRateAdjustment())) + "Hz", 0xFFFFFF, 0xFF000000, 1, startFrame);
 
@@ -87,8 +89,8 @@ void DebugStats::DisplayStats(Emulator *emu, double lastFrameTime)
 		hud->DrawLine(130 + i*2, 60 + 50 - duration*2, 130 + i*2 + 2, 60 + 50 - nextDuration*2, lineColor, 1, startFrame);
 	}
 
-	hud->DrawRectangle(8, 60, 115, 34, 0x40000000, true, 1, startFrame);
-	hud->DrawRectangle(8, 60, 115, 34, 0xFFFFFF, false, 1, startFrame);
+	hud->DrawRectangle(8, 60, 115, 52, 0x40000000, true, 1, startFrame);
+	hud->DrawRectangle(8, 60, 115, 52, 0xFFFFFF, false, 1, startFrame);
 
 	hud->DrawString(10, 62, "Misc. Stats", 0xFFFFFF, 0xFF000000, 1, startFrame);
 
@@ -103,4 +105,33 @@ void DebugStats::DisplayStats(Emulator *emu, double lastFrameTime)
 		ss << "   Per min.: " << std::fixed << std::setprecision(2) << (memUsage * 60 * 60 / rewindStats.HistoryDuration) << " MB";
 		hud->DrawString(9, 82, ss.str(), 0xFFFFFF, 0xFF000000, 1, startFrame);
 	}
+
+	hud->DrawString(10, 91, "Rewind limit: " + std::to_string(rewindStats.MemoryLimit >> 20) + " MB", 0xFFFFFF, 0xFF000000, 1, startFrame);
+	hud->DrawString(10, 100, "Thin/Arch.: " + std::to_string(rewindStats.ThinnedStates) + "/" + std::to_string(rewindStats.ArchivedStates), 0xFFFFFF, 0xFF000000, 1, startFrame);
+
+	shared_ptr<IConsole> console = emu->GetConsole();
+	TextureCacheStats textureStats = console ? console->GetTextureCacheStats() : TextureCacheStats {};
+	if(textureStats.Budget > 0) {
+		hud->DrawRectangle(8, 115, 115, 43, 0x40000000, true, 1, startFrame);
+		hud->DrawRectangle(8, 115, 115, 43, 0xFFFFFF, false, 1, startFrame);
+		hud->DrawString(10, 117, "HD Textures", 0xFFFFFF, 0xFF000000, 1, startFrame);
+		hud->DrawString(10, 128, "Hit/Miss: " + std::to_string(textureStats.Hits) + "/" + std::to_string(textureStats.Misses), 0xFFFFFF, 0xFF000000, 1, startFrame);
+		hud->DrawString(10, 137, "Dec./Evict.: " + std::to_string(textureStats.Decodes) + "/" + std::to_string(textureStats.Evictions), 0xFFFFFF, 0xFF000000, 1, startFrame);
+		hud->DrawString(10, 146, "Resident: " + std::to_string(textureStats.ResidentBytes >> 20) + "/" + std::to_string(textureStats.Budget >> 20) + " MB", 0xFFFFFF, 0xFF000000, 1, startFrame);
+	}
+
+	ScaleFilterStats filterStats = emu->GetVideoDecoder()->GetScaleFilterStats();
+	if(filterStats.BandedTime > 0 || filterStats.SerialTime > 0) {
+		hud->DrawRectangle(132, 94, 115, 34, 0x40000000, true, 1, startFrame);
+		hud->DrawRectangle(132, 94, 115, 34, 0xFFFFFF, false, 1, startFrame);
+		hud->DrawString(134, 96, "Scale Filter", 0xFFFFFF, 0xFF000000, 1, startFrame);
+
+		ss = std::stringstream();
+		ss << "Banded (" << filterStats.WorkerCount + 1 << "): " << std::fixed << std::setprecision(2) << filterStats.BandedTime << " ms";
+		hud->DrawString(134, 107, ss.str(), 0xFFFFFF, 0xFF000000, 1, startFrame);
+
+		ss = std::stringstream();
+		ss << "Single: " << std::fixed << std::setprecision(2) << filterStats.SerialTime << " ms";
+		hud->DrawString(134, 116, ss.str(), 0xFFFFFF, 0xFF000000, 1, startFrame);
+	}
 }
@@ -0,0 +1,191 @@
+#include "pch.h"
+#include "Shared/Video/DrawCommandRasterizer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define HUD_BLEND_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	#include <arm_neon.h>
+	#define HUD_BLEND_NEON
+#endif
+
+void DrawCommandRasterizer::SetTarget(uint32_t* argbBuffer, FrameInfo frameInfo, OverscanDimensions overscan, HudScaleFactors scaleFactors, uint64_t* dirtyTiles)
+{
+	_argbBuffer = argbBuffer;
+	_premultiplyEmptyPixels = dirtyTiles == nullptr;
+	_frameInfo = frameInfo;
+	_overscan = overscan;
+	_dirtyTiles = dirtyTiles;
+	_tileColumns = GetTileColumns(frameInfo);
+
+	if(scaleFactors.X != 0 && scaleFactors.Y != 0) {
+		_xScale = (float)scaleFactors.X;
+		_yScale = (int)scaleFactors.Y;
+	} else {
+		_yScale = 1;
+		_xScale = 1;
+	}
+}
+
+//Blends a semi-transparent color (alpha 1-254) on top of a row of pixels
+//The SSE2/NEON versions process 4 pixels at a time and must produce the same output as the scalar version
+void DrawCommandRasterizer::BlendRow(uint32_t* output, uint32_t count, uint32_t color, bool premultiplyEmptyPixels)
+{
+	uint8_t* input = (uint8_t*)&color;
+	uint32_t alpha = input[3] + 1;
+	uint32_t invertedAlpha = 256 - input[3];
+	uint32_t emptyAlpha = color & 0xFF000000;
+
+	uint32_t i = 0;
+#if defined(HUD_BLEND_SSE2)
+	//alpha * input + invertedAlpha * output is at most 257 * 255, so the 16-bit lanes can't overflow
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i src = _mm_set_epi16(
+		0, (int16_t)(alpha * input[2]), (int16_t)(alpha * input[1]), (int16_t)(alpha * input[0]),
+		0, (int16_t)(alpha * input[2]), (int16_t)(alpha * input[1]), (int16_t)(alpha * input[0])
+	);
+	const __m128i invAlpha = _mm_set1_epi16((int16_t)invertedAlpha);
+	const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i opaqueAlpha = _mm_set1_epi32((int)0xFF000000);
+	const __m128i inputAlpha = _mm_set1_epi32((int)emptyAlpha);
+	const __m128i inputColor = _mm_set1_epi32((int)color);
+	for(; i + 4 <= count; i += 4) {
+		__m128i dst = _mm_loadu_si128((const __m128i*)(output + i));
+		__m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), invAlpha), src), 8);
+		__m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), invAlpha), src), 8);
+		__m128i blended = _mm_and_si128(_mm_packus_epi16(lo, hi), colorMask);
+
+		__m128i empty = _mm_cmpeq_epi32(dst, zero);
+		__m128i emptyResult = premultiplyEmptyPixels ? _mm_or_si128(blended, inputAlpha) : inputColor;
+		__m128i result = _mm_or_si128(_mm_and_si128(empty, emptyResult), _mm_andnot_si128(empty, _mm_or_si128(blended, opaqueAlpha)));
+		_mm_storeu_si128((__m128i*)(output + i), result);
+	}
+#elif defined(HUD_BLEND_NEON)
+	const uint16_t srcValues[8] = {
+		(uint16_t)(alpha * input[0]), (uint16_t)(alpha * input[1]), (uint16_t)(alpha * input[2]), 0,
+		(uint16_t)(alpha * input[0]), (uint16_t)(alpha * input[1]), (uint16_t)(alpha * input[2]), 0
+	};
+	const uint16x8_t src = vld1q_u16(srcValues);
+	const uint8x8_t invAlpha = vdup_n_u8((uint8_t)invertedAlpha);
+	const uint32x4_t colorMask = vdupq_n_u32(0x00FFFFFF);
+	const uint32x4_t opaqueAlpha = vdupq_n_u32(0xFF000000);
+	const uint32x4_t inputAlpha = vdupq_n_u32(emptyAlpha);
+	const uint32x4_t inputColor = vdupq_n_u32(color);
+	for(; i + 4 <= count; i += 4) {
+		uint32x4_t dst = vld1q_u32(output + i);
+		uint8x16_t dst8 = vreinterpretq_u8_u32(dst);
+		uint16x8_t lo = vaddq_u16(vmull_u8(vget_low_u8(dst8), invAlpha), src);
+		uint16x8_t hi = vaddq_u16(vmull_u8(vget_high_u8(dst8), invAlpha), src);
+		uint32x4_t blended = vandq_u32(vreinterpretq_u32_u8(vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8))), colorMask);
+
+		uint32x4_t emptyResult = premultiplyEmptyPixels ? vorrq_u32(blended, inputAlpha) : inputColor;
+		uint32x4_t result = vbslq_u32(vceqq_u32(dst, vdupq_n_u32(0)), emptyResult, vorrq_u32(blended, opaqueAlpha));
+		vst1q_u32(output + i, result);
+	}
+#endif
+
+	for(; i < count; i++) {
+		uint8_t* out = (uint8_t*)(output + i);
+		bool empty = output[i] == 0;
+		if(empty && !premultiplyEmptyPixels) {
+			output[i] = color;
+			continue;
+		}
+		out[0] = (uint8_t)((alpha * input[0] + invertedAlpha * out[0]) >> 8);
+		out[1] = (uint8_t)((alpha * input[1] + invertedAlpha * out[1]) >> 8);
+		out[2] = (uint8_t)((alpha * input[2] + invertedAlpha * out[2]) >> 8);
+		out[3] = empty ? input[3] : 0xFF;
+	}
+}
+
+void DrawCommandRasterizer::MarkDirtyTiles(int left, int top, int right, int bottom)
+{
+	uint32_t firstColumn = (uint32_t)left >> TileShift;
+	uint32_t lastColumn = (uint32_t)(right - 1) >> TileShift;
+	uint32_t lastRow = (uint32_t)(bottom - 1) >> TileShift;
+	for(uint32_t row = (uint32_t)top >> TileShift; row <= lastRow; row++) {
+		for(uint32_t column = firstColumn; column <= lastColumn; column++) {
+			uint32_t tile = row * _tileColumns + column;
+			_dirtyTiles[tile >> 6] |= (uint64_t)1 << (tile & 0x3F);
+		}
+	}
+}
+
+void DrawCommandRasterizer::FillScreenRect(int left, int top, int right, int bottom, uint32_t color)
+{
+	uint32_t alpha = color & 0xFF000000;
+	if(alpha == 0) {
+		return;
+	}
+
+	//Convert to buffer coordinates and clip
+	left = std::max(left - (int)_overscan.Left, 0);
+	right = std::min(right - (int)_overscan.Left, (int)_frameInfo.Width);
+	top = std::max(top - (int)_overscan.Top, 0);
+	bottom = std::min(bottom - (int)_overscan.Top, (int)_frameInfo.Height);
+	if(left >= right || top >= bottom) {
+		return;
+	}
+
+	uint32_t count = right - left;
+	for(int y = top; y < bottom; y++) {
+		uint32_t* row = _argbBuffer + y * _frameInfo.Width + left;
+		if(alpha == 0xFF000000) {
+			std::fill(row, row + count, color);
+		} else {
+			BlendRow(row, count, color, _premultiplyEmptyPixels);
+		}
+	}
+
+	if(_dirtyTiles) {
+		MarkDirtyTiles(left, top, right, bottom);
+	}
+}
+
+void DrawCommandRasterizer::DrawSpan(int x, int y, int length, int color)
+{
+	if(length <= 0) {
+		return;
+	}
+
+	if(_yScale == 1 && _xScale == 1) {
+		FillScreenRect(x, y, x + length, y + 1, color);
+	} else if(_useIntegerScaling) {
+		int xScale = (int)std::floor(_xScale);
+		FillScreenRect(x * xScale, y * _yScale, (x + length) * xScale, (y + 1) * _yScale, color);
+	} else {
+		FillScreenRect((int)(x * _xScale), y * _yScale, (int)((x + length) * _xScale), (y + 1) * _yScale, color);
+	}
+}
+
+void DrawCommandRasterizer::FillRectangle(int x, int y, int width, int height, int color)
+{
+	if(width <= 0 || height <= 0) {
+		return;
+	}
+
+	if(_yScale == 1 && _xScale == 1) {
+		FillScreenRect(x, y, x + width, y + height, color);
+	} else if(_useIntegerScaling) {
+		int xScale = (int)std::floor(_xScale);
+		FillScreenRect(x * xScale, y * _yScale, (x + width) * xScale, (y + height) * _yScale, color);
+	} else {
+		FillScreenRect((int)(x * _xScale), y * _yScale, (int)((x + width) * _xScale), (y + height) * _yScale, color);
+	}
+}
+
+void DrawCommandRasterizer::CopyScreenBuffer(uint32_t* buffer, uint32_t width, uint32_t height)
+{
+	uint32_t srcOffset = _overscan.Top * width + _overscan.Left;
+	uint32_t srcSize = width * height;
+	for(uint32_t y = 0; y < _frameInfo.Height; y++) {
+		if(srcOffset + y * width + _frameInfo.Width > srcSize) {
+			break;
+		}
+		memcpy(_argbBuffer + y * _frameInfo.Width, buffer + srcOffset + y * width, _frameInfo.Width * sizeof(uint32_t));
+	}
+
+	if(_dirtyTiles && _frameInfo.Width > 0 && _frameInfo.Height > 0) {
+		MarkDirtyTiles(0, 0, _frameInfo.Width, _frameInfo.Height);
+	}
+}
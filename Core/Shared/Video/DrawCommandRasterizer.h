@@ -0,0 +1,50 @@
+#pragma once
+#include "pch.h"
+#include "Shared/SettingTypes.h"
+
+//Draws the HUD's primitives as horizontal spans of pixels (a 1-pixel span is drawn for single pixels)
+//Colors are ARGB with a regular alpha channel (255 = opaque) - semi-transparent pixels drawn on an
+//empty (0) pixel keep their alpha value, for hardware blending with the game screen.
+class DrawCommandRasterizer
+{
+public:
+	static constexpr uint32_t TileShift = 4; //16x16 pixel tiles
+
+private:
+	uint32_t* _argbBuffer = nullptr;
+	FrameInfo _frameInfo = {};
+	OverscanDimensions _overscan = {};
+	bool _useIntegerScaling = false;
+	bool _premultiplyEmptyPixels = true;
+	float _xScale = 1;
+	int _yScale = 1;
+
+	//Optional, one bit per tile touched by a draw call
+	uint64_t* _dirtyTiles = nullptr;
+	uint32_t _tileColumns = 0;
+
+	void MarkDirtyTiles(int left, int top, int right, int bottom);
+
+public:
+	static uint32_t GetTileColumns(FrameInfo frameInfo) { return (frameInfo.Width + (1 << TileShift) - 1) >> TileShift; }
+	static uint32_t GetTileRows(FrameInfo frameInfo) { return (frameInfo.Height + (1 << TileShift) - 1) >> TileShift; }
+
+	//When drawing directly to the output, semi-transparent pixels drawn on empty pixels are premultiplied
+	//When drawing to DebugHud's layer (dirty tiles are tracked), they are stored as-is
+	static void BlendRow(uint32_t* output, uint32_t count, uint32_t color, bool premultiplyEmptyPixels);
+
+	void SetTarget(uint32_t* argbBuffer, FrameInfo frameInfo, OverscanDimensions overscan, HudScaleFactors scaleFactors, uint64_t* dirtyTiles);
+	void SetIntegerScaling(bool useIntegerScaling) { _useIntegerScaling = useIntegerScaling; }
+
+	float GetXScale() { return _xScale; }
+
+	//Screen coordinates (after scaling, including overscan)
+	void FillScreenRect(int left, int top, int right, int bottom, uint32_t color);
+
+	//Game coordinates (before scaling)
+	void DrawSpan(int x, int y, int length, int color);
+	void DrawPixel(int x, int y, int color) { DrawSpan(x, y, 1, color); }
+	void FillRectangle(int x, int y, int width, int height, int color);
+
+	void CopyScreenBuffer(uint32_t* buffer, uint32_t width, uint32_t height);
+};
@@ -1,24 +1,42 @@
 #pragma once
 #include "pch.h"
 #include "Shared/Video/DrawCommand.h"
+#include "Shared/Video/DrawCommandRasterizer.h"
 
-class DrawLineCommand : public DrawCommand
+class DrawLineCommand
 {
-private:
-	int _x, _y, _x2, _y2, _color;
+public:
+	static DrawCommand Create(int x, int y, int x2, int y2, int color, int frameCount, int startFrame)
+	{
+		DrawCommand cmd(DrawCommandType::Line, startFrame, frameCount);
+		cmd.X = x;
+		cmd.Y = y;
+		cmd.X2 = x2;
+		cmd.Y2 = y2;
+		cmd.Color = DrawCommand::InvertAlpha(color);
+		return cmd;
+	}
 
-protected:
-	void InternalDraw()
+	static void Draw(DrawCommandRasterizer& rasterizer, DrawCommand& cmd)
 	{
-		int x = _x;
-		int y = _y;
-		int dx = abs(_x2 - x), sx = x < _x2 ? 1 : -1;
-		int dy = abs(_y2 - y), sy = y < _y2 ? 1 : -1;
+		if(cmd.Y == cmd.Y2) {
+			//Horizontal line, draw as a single span
+			rasterizer.DrawSpan(std::min(cmd.X, cmd.X2), cmd.Y, abs(cmd.X2 - cmd.X) + 1, cmd.Color);
+			return;
+		} else if(cmd.X == cmd.X2) {
+			rasterizer.FillRectangle(cmd.X, std::min(cmd.Y, cmd.Y2), 1, abs(cmd.Y2 - cmd.Y) + 1, cmd.Color);
+			return;
+		}
+
+		int x = cmd.X;
+		int y = cmd.Y;
+		int dx = abs(cmd.X2 - x), sx = x < cmd.X2 ? 1 : -1;
+		int dy = abs(cmd.Y2 - y), sy = y < cmd.Y2 ? 1 : -1;
 		int err = (dx > dy ? dx : -dy) / 2, e2;
 
 		while(true) {
-			DrawPixel(x, y, _color);
-			if(x == _x2 && y == _y2) {
+			rasterizer.DrawPixel(x, y, cmd.Color);
+			if(x == cmd.X2 && y == cmd.Y2) {
 				break;
 			}
 
@@ -31,12 +49,4 @@ protected:
 			}
 		}
 	}
-
-public:
-	DrawLineCommand(int x, int y, int x2, int y2, int color, int frameCount, int startFrame) :
-		DrawCommand(startFrame, frameCount), _x(x), _y(y), _x2(x2), _y2(y2), _color(color)
-	{
-		//Invert alpha byte - 0 = opaque, 255 = transparent (this way, no need to specifiy alpha channel all the time)
-		_color = (~color & 0xFF000000) | (color & 0xFFFFFF);
-	}
 };
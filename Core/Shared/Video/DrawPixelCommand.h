@@ -1,23 +1,22 @@
 #pragma once
 #include "pch.h"
 #include "Shared/Video/DrawCommand.h"
+#include "Shared/Video/DrawCommandRasterizer.h"
 
-class DrawPixelCommand : public DrawCommand
+class DrawPixelCommand
 {
-private:
-	int _x, _y, _color;
-
-protected:
-	void InternalDraw()
+public:
+	static DrawCommand Create(int x, int y, int color, int frameCount, int startFrame)
 	{
-		DrawPixel(_x, _y, _color);
+		DrawCommand cmd(DrawCommandType::Pixel, startFrame, frameCount);
+		cmd.X = x;
+		cmd.Y = y;
+		cmd.Color = DrawCommand::InvertAlpha(color);
+		return cmd;
 	}
 
-public:
-	DrawPixelCommand(int x, int y, int color, int frameCount, int startFrame) :
-		DrawCommand(startFrame, frameCount), _x(x), _y(y), _color(color)
+	static void Draw(DrawCommandRasterizer& rasterizer, DrawCommand& cmd)
 	{
-		//Invert alpha byte - 0 = opaque, 255 = transparent (this way, no need to specifiy alpha channel all the time)
-		_color = (~color & 0xFF000000) | (color & 0xFFFFFF);
+		rasterizer.DrawPixel(cmd.X, cmd.Y, cmd.Color);
 	}
 };
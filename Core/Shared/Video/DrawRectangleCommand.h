@@ -1,48 +1,46 @@
 #pragma once
 #include "pch.h"
 #include "Shared/Video/DrawCommand.h"
+#include "Shared/Video/DrawCommandRasterizer.h"
 
-class DrawRectangleCommand : public DrawCommand
+class DrawRectangleCommand
 {
-private:
-	int _x, _y, _width, _height, _color;
-	bool _fill;
-
-protected:
-	void InternalDraw()
-	{
-		if(_fill) {
-			for(int j = 0; j < _height; j++) {
-				for(int i = 0; i < _width; i++) {
-					DrawPixel(_x + i, _y + j, _color);
-				}
-			}
-		} else {
-			for(int i = 0; i < _width; i++) {
-				DrawPixel(_x + i, _y, _color);
-				DrawPixel(_x + i, _y + _height - 1, _color);
-			}
-			for(int i = 1; i < _height - 1; i++) {
-				DrawPixel(_x, _y + i, _color);
-				DrawPixel(_x + _width - 1, _y + i, _color);
-			}
-		}
-	}
-
 public:
-	DrawRectangleCommand(int x, int y, int width, int height, int color, bool fill, int frameCount, int startFrame) :
-		DrawCommand(startFrame, frameCount), _x(x), _y(y), _width(width), _height(height), _color(color), _fill(fill)
+	static DrawCommand Create(int x, int y, int width, int height, int color, bool fill, int frameCount, int startFrame)
 	{
+		DrawCommand cmd(DrawCommandType::Rectangle, startFrame, frameCount);
 		if(width < 0) {
-			_x += width + 1;
-			_width = -width;
+			x += width + 1;
+			width = -width;
 		}
 		if(height < 0) {
-			_y += height + 1;
-			_height = -height;
+			y += height + 1;
+			height = -height;
 		}
 
-		//Invert alpha byte - 0 = opaque, 255 = transparent (this way, no need to specifiy alpha channel all the time)
-		_color = (~color & 0xFF000000) | (color & 0xFFFFFF);
+		cmd.X = x;
+		cmd.Y = y;
+		cmd.X2 = width;
+		cmd.Y2 = height;
+		cmd.Fill = fill;
+		cmd.Color = DrawCommand::InvertAlpha(color);
+		return cmd;
+	}
+
+	static void Draw(DrawCommandRasterizer& rasterizer, DrawCommand& cmd)
+	{
+		int width = cmd.X2;
+		int height = cmd.Y2;
+		if(cmd.Fill) {
+			rasterizer.FillRectangle(cmd.X, cmd.Y, width, height, cmd.Color);
+		} else {
+			//Top and bottom rows are both drawn even when they overlap (height of 1)
+			rasterizer.DrawSpan(cmd.X, cmd.Y, width, cmd.Color);
+			rasterizer.DrawSpan(cmd.X, cmd.Y + height - 1, width, cmd.Color);
+			if(height > 2) {
+				rasterizer.FillRectangle(cmd.X, cmd.Y + 1, 1, height - 2, cmd.Color);
+				rasterizer.FillRectangle(cmd.X + width - 1, cmd.Y + 1, 1, height - 2, cmd.Color);
+			}
+		}
 	}
-};
\ No newline at end of file
+};
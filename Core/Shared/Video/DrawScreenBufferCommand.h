@@ -1,46 +1,24 @@
 #pragma once
 #include "pch.h"
 #include "Shared/Video/DrawCommand.h"
+#include "Shared/Video/DrawCommandRasterizer.h"
 
-class DrawScreenBufferCommand : public DrawCommand
+//Replaces the whole frame with the content of a buffer (stored in DebugHud's data arena)
+class DrawScreenBufferCommand
 {
-private:
-	uint32_t* _screenBuffer = nullptr;
-	uint32_t _width = 0;
-	uint32_t _height = 0;
-
-protected:
-	void InternalDraw()
-	{
-		int top = (int)_overscan.Top;
-		int left = (int)_overscan.Left;
-		int width = _frameInfo.Width;
-		int srcOffset = top * _width + left;
-		uint32_t bufferSize = _frameInfo.Width * _frameInfo.Height;
-
-		for(uint32_t y = 0; y < _frameInfo.Height; y++) {
-			if(y * _frameInfo.Width + width > bufferSize) {
-				break;
-			}
-			memcpy(_argbBuffer + y * _frameInfo.Width, _screenBuffer + srcOffset + y * _width, width * sizeof(uint32_t));
-		}
-	}
-
 public:
-	DrawScreenBufferCommand(uint32_t width, uint32_t height, int startFrame) : DrawCommand(startFrame, 1, false)
+	static DrawCommand Create(uint32_t width, uint32_t height, int startFrame)
 	{
-		_width = width;
-		_height = height;
-		_screenBuffer = new uint32_t[width * height];
+		DrawCommand cmd(DrawCommandType::ScreenBuffer, startFrame, 1);
+		cmd.X2 = (int32_t)width;
+		cmd.Y2 = (int32_t)height;
+		return cmd;
 	}
 
-	void SetPixel(int index, uint32_t color)
+	static void Draw(DrawCommandRasterizer& rasterizer, DrawCommand& cmd, uint8_t* data)
 	{
-		_screenBuffer[index] = color;
-	}
-
-	virtual ~DrawScreenBufferCommand()
-	{
-		delete[] _screenBuffer;
+		if(cmd.DataSize >= (uint64_t)cmd.X2 * cmd.Y2 * sizeof(uint32_t)) {
+			rasterizer.CopyScreenBuffer((uint32_t*)data, cmd.X2, cmd.Y2);
+		}
 	}
 };
@@ -1,14 +1,11 @@
 #pragma once
 #include "pch.h"
 #include "Shared/Video/DrawCommand.h"
+#include "Shared/Video/DrawCommandRasterizer.h"
 
-class DrawStringCommand : public DrawCommand
+class DrawStringCommand
 {
 private:
-	int _x, _y, _color, _backColor;
-	int _maxWidth = 0;
-	string _text;
-
 	//Taken from FCEUX's LUA code
 	static constexpr int _tabSpace = 4;
 
@@ -128,13 +125,43 @@ private:
 		return _font[GetCharNumber(ch) * 8];
 	}
 
-protected:
-	void InternalDraw()
+	//Draws the bits of a font row as runs of foreground/background pixels
+	static void DrawRow(DrawCommandRasterizer& rasterizer, int x, int y, uint8_t rowData, int width, int color, int backColor)
+	{
+		int start = 0;
+		int startBit = (rowData >> 7) & 0x01;
+		for(int col = 1; col <= width; col++) {
+			int bit = col < width ? (rowData >> (7 - col)) & 0x01 : -1;
+			if(bit != startBit) {
+				rasterizer.DrawSpan(x + start, y, col - start, startBit ? color : backColor);
+				start = col;
+				startBit = bit;
+			}
+		}
+	}
+
+public:
+	static DrawCommand Create(int x, int y, int color, int backColor, int frameCount, int startFrame, int maxWidth = 0)
+	{
+		DrawCommand cmd(DrawCommandType::String, startFrame, frameCount, true);
+		cmd.X = x;
+		cmd.Y = y;
+		cmd.MaxWidth = maxWidth;
+		cmd.Color = DrawCommand::InvertAlpha(color);
+		cmd.BackColor = DrawCommand::InvertAlpha(backColor);
+		return cmd;
+	}
+
+	static void Draw(DrawCommandRasterizer& rasterizer, DrawCommand& cmd, const char* text, uint32_t length)
 	{
-		int startX = (int)(_x * _xScale / std::floor(_xScale));
+		int color = cmd.Color;
+		int backColor = cmd.BackColor;
+		int maxWidth = cmd.MaxWidth;
+		float xScale = rasterizer.GetXScale();
+		int startX = (int)(cmd.X * xScale / std::floor(xScale));
 		int lineWidth = 0;
 		int x = startX;
-		int y = _y;
+		int y = cmd.Y;
 		int lineHeight = 9;
 		
 		auto newLine = [&lineWidth, &x, &y, &lineHeight, startX]() {
@@ -144,27 +171,23 @@ protected:
 			lineHeight = 9;
 		};
 
-		for(int i = 0; i < _text.size(); i++) {
-			unsigned char c = _text[i];
+		for(uint32_t i = 0; i < length; i++) {
+			unsigned char c = text[i];
 			if(c == '\n') {
 				newLine();
 			} else if(c == '\t') {
 				int tabWidth = (_tabSpace - (((x - startX) / 8) % _tabSpace)) * 8;
 				x += tabWidth;
 				lineWidth += tabWidth;
-				if(_maxWidth > 0 && lineWidth > _maxWidth) {
+				if(maxWidth > 0 && lineWidth > maxWidth) {
 					newLine();
 				}
 			} else if(c == 0x20) {
 				//Space (ignore spaces at the start of a new line, when text wrapping is enabled)
-				if(lineWidth > 0 || _maxWidth == 0) {
-					if(_backColor & 0xFF000000) {
+				if(lineWidth > 0 || maxWidth == 0) {
+					if(backColor & 0xFF000000) {
 						//Draw bg color for spaces (when bg color is set)
-						for(int row = 0; row < lineHeight; row++) {
-							for(int column = 0; column < 6; column++) {
-								DrawPixel(x + column, y + row - 1, _backColor);
-							}
-						}
+						rasterizer.FillRectangle(x, y - 1, 6, lineHeight, backColor);
 					}
 
 					lineWidth += 6;
@@ -173,14 +196,14 @@ protected:
 			} else if(c >= 0x80) {
 				//8x12 UTF-8 font for Japanese
 				int code = (uint8_t)c;
-				if(i + 2 < _text.size()) {
-					code |= ((uint8_t)_text[i + 1]) << 8;
-					code |= ((uint8_t)_text[i + 2]) << 16;
+				if(i + 2 < length) {
+					code |= ((uint8_t)text[i + 1]) << 8;
+					code |= ((uint8_t)text[i + 2]) << 16;
 
 					auto res = _jpFont.find(code);
 					if(res != _jpFont.end()) {
 						lineWidth += 8;
-						if(_maxWidth > 0 && lineWidth > _maxWidth) {
+						if(maxWidth > 0 && lineWidth > maxWidth) {
 							newLine();
 							lineWidth += 8;
 						}
@@ -188,11 +211,7 @@ protected:
 						uint8_t* charDef = (uint8_t*)res->second;
 
 						for(int row = 0; row < 12; row++) {
-							uint8_t rowData = charDef[row];
-							for(int column = 0; column < 8; column++) {
-								int drawFg = (rowData >> (7 - column)) & 0x01;
-								DrawPixel(x + column, y + row - 2, drawFg ? _color : _backColor);
-							}
+							DrawRow(rasterizer, x, y + row - 2, charDef[row], 8, color, backColor);
 						}
 						i += 2;
 						x += 8;
@@ -205,7 +224,7 @@ protected:
 				int width = GetCharWidth(c);
 				
 				lineWidth += width;
-				if(_maxWidth > 0 && lineWidth > _maxWidth) {
+				if(maxWidth > 0 && lineWidth > maxWidth) {
 					newLine();
 					lineWidth += width;
 				}
@@ -213,28 +232,14 @@ protected:
 				int rowOffset = (c == 'y' || c == 'g' || c == 'p' || c == 'q') ? 1 : 0;
 				for(int row = 0; row < 8; row++) {
 					uint8_t rowData = ((row == 7 && rowOffset == 0) || (row == 0 && rowOffset == 1)) ? 0 : _font[ch * 8 + 1 + row - rowOffset];
-					for(int col = 0; col < width; col++) {
-						int drawFg = (rowData >> (7 - col)) & 0x01;
-						DrawPixel(x + col, y + row, drawFg ? _color : _backColor);
-					}
-				}
-				for(int col = 0; col < width; col++) {
-					DrawPixel(x + col, y - 1, _backColor);
+					DrawRow(rasterizer, x, y + row, rowData, width, color, backColor);
 				}
+				rasterizer.DrawSpan(x, y - 1, width, backColor);
 				x += width;
 			}
 		}
 	}
 
-public:
-	DrawStringCommand(int x, int y, string text, int color, int backColor, int frameCount, int startFrame, int maxWidth = 0) :
-		DrawCommand(startFrame, frameCount, true), _x(x), _y(y), _color(color), _backColor(backColor), _maxWidth(maxWidth), _text(text)
-	{
-		//Invert alpha byte - 0 = opaque, 255 = transparent (this way, no need to specifiy alpha channel all the time)
-		_color = (~color & 0xFF000000) | (color & 0xFFFFFF);
-		_backColor = (~backColor & 0xFF000000) | (backColor & 0xFFFFFF);
-	}
-
 	static TextSize MeasureString(string& text, uint32_t maxWidth = 0)
 	{
 		uint32_t maxX = 0;
@@ -4,6 +4,7 @@
 #include "Utilities/HQX/hqx.h"
 #include "Utilities/Scale2x/scalebit.h"
 #include "Utilities/KreedSaiEagle/SaiEagle.h"
+#include "Utilities/ThreadPool.h"
 
 bool ScaleFilter::_hqxInitDone = false;
 
@@ -56,24 +57,76 @@ void ScaleFilter::UpdateOutputBuffer(uint32_t width, uint32_t height)
 	}
 }
 
-uint32_t* ScaleFilter::ApplyFilter(uint32_t *inputArgbBuffer, uint32_t width, uint32_t height)
+uint32_t ScaleFilter::GetBandOverlap()
 {
-	UpdateOutputBuffer(width, height);
+	//Number of rows above/below a pixel that the filter reads from
+	switch(_scaleFilterType) {
+		case ScaleFilterType::HQX: return 1;
+		case ScaleFilterType::Scale2x: return _filterScale == 4 ? 2 : 1; //4x is done in 2 passes of 2x
+		case ScaleFilterType::_2xSai:
+		case ScaleFilterType::Super2xSai:
+		case ScaleFilterType::SuperEagle:
+			return 2;
 
-	if(_scaleFilterType == ScaleFilterType::xBRZ) {
-		xbrz::scale(_filterScale, inputArgbBuffer, _outputBuffer, width, height, xbrz::ColorFormat::ARGB);
-	} else if(_scaleFilterType == ScaleFilterType::HQX) {
-		hqx(_filterScale, inputArgbBuffer, _outputBuffer, width, height);
+		default: return 0;
+	}
+}
+
+void ScaleFilter::ApplyFilter(uint32_t *inputArgbBuffer, uint32_t *outputBuffer, uint32_t width, uint32_t height)
+{
+	if(_scaleFilterType == ScaleFilterType::HQX) {
+		hqx(_filterScale, inputArgbBuffer, outputBuffer, width, height);
 	} else if(_scaleFilterType == ScaleFilterType::Scale2x) {
-		scale(_filterScale, _outputBuffer, width*sizeof(uint32_t)*_filterScale, inputArgbBuffer, width*sizeof(uint32_t), 4, width, height);
+		scale(_filterScale, outputBuffer, width*sizeof(uint32_t)*_filterScale, inputArgbBuffer, width*sizeof(uint32_t), 4, width, height);
 	} else if(_scaleFilterType == ScaleFilterType::_2xSai) {
-		twoxsai_generic_xrgb8888(width, height, inputArgbBuffer, width, _outputBuffer, width * _filterScale);
+		twoxsai_generic_xrgb8888(width, height, inputArgbBuffer, width, outputBuffer, width * _filterScale);
 	} else if(_scaleFilterType == ScaleFilterType::Super2xSai) {
-		supertwoxsai_generic_xrgb8888(width, height, inputArgbBuffer, width, _outputBuffer, width * _filterScale);
+		supertwoxsai_generic_xrgb8888(width, height, inputArgbBuffer, width, outputBuffer, width * _filterScale);
 	} else if(_scaleFilterType == ScaleFilterType::SuperEagle) {
-		supereagle_generic_xrgb8888(width, height, inputArgbBuffer, width, _outputBuffer, width * _filterScale);
-	} else if(_scaleFilterType == ScaleFilterType::Prescale) {
+		supereagle_generic_xrgb8888(width, height, inputArgbBuffer, width, outputBuffer, width * _filterScale);
+	}
+}
+
+void ScaleFilter::ApplyFilterToRows(uint32_t *inputArgbBuffer, uint32_t width, uint32_t height, uint32_t yFirst, uint32_t yLast, vector<uint32_t>& bandBuffer)
+{
+	if(_scaleFilterType == ScaleFilterType::xBRZ) {
+		xbrz::scale(_filterScale, inputArgbBuffer, _outputBuffer, width, height, xbrz::ColorFormat::ARGB, xbrz::ScalerCfg(), yFirst, yLast);
+		return;
+	}
+
+	//Filter the band along with the rows around it (the filters treat the first/last row as the edge of the image),
+	//and only copy the band's rows to the output, which makes the result identical to filtering the whole frame
+	uint32_t overlap = GetBandOverlap();
+	uint32_t sliceFirst = yFirst > overlap ? yFirst - overlap : 0;
+	uint32_t sliceLast = std::min(height, yLast + overlap);
+	uint32_t scaledWidth = width * _filterScale;
+
+	bandBuffer.resize(scaledWidth * (sliceLast - sliceFirst) * _filterScale);
+	ApplyFilter(inputArgbBuffer + sliceFirst * width, bandBuffer.data(), width, sliceLast - sliceFirst);
+
+	uint32_t* src = bandBuffer.data() + (yFirst - sliceFirst) * _filterScale * scaledWidth;
+	memcpy(_outputBuffer + yFirst * _filterScale * scaledWidth, src, (yLast - yFirst) * _filterScale * scaledWidth * sizeof(uint32_t));
+}
+
+uint32_t* ScaleFilter::ApplyFilter(uint32_t *inputArgbBuffer, uint32_t width, uint32_t height, ThreadPool* pool)
+{
+	UpdateOutputBuffer(width, height);
+
+	if(_scaleFilterType == ScaleFilterType::Prescale) {
 		ApplyPrescaleFilter(inputArgbBuffer);
+	} else if(pool && pool->GetWorkerCount() > 0 && height >= MinBandHeight * 2) {
+		//Split the frame into bands of rows that are filtered in parallel
+		uint32_t bandCount = std::min(height / MinBandHeight, (pool->GetWorkerCount() + 1) * ScaleFilter::BandsPerThread);
+		_bandBuffers.resize(bandCount);
+		pool->Run(bandCount, [=](uint32_t band) {
+			uint32_t yFirst = height * band / bandCount;
+			uint32_t yLast = height * (band + 1) / bandCount;
+			ApplyFilterToRows(inputArgbBuffer, width, height, yFirst, yLast, _bandBuffers[band]);
+		});
+	} else if(_scaleFilterType == ScaleFilterType::xBRZ) {
+		xbrz::scale(_filterScale, inputArgbBuffer, _outputBuffer, width, height, xbrz::ColorFormat::ARGB);
+	} else {
+		ApplyFilter(inputArgbBuffer, _outputBuffer, width, height);
 	}
 
 	return _outputBuffer;
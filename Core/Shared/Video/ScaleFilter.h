@@ -3,9 +3,14 @@
 #include "pch.h"
 #include "Shared/SettingTypes.h"
 
+class ThreadPool;
+
 class ScaleFilter
 {
 private:
+	static constexpr uint32_t BandsPerThread = 2;
+	static constexpr uint32_t MinBandHeight = 16;
+
 	static bool _hqxInitDone;
 	uint32_t _filterScale;
 	ScaleFilterType _scaleFilterType;
@@ -13,15 +18,22 @@ private:
 	uint32_t _width = 0;
 	uint32_t _height = 0;
 
+	//Used when filtering bands of rows in parallel, to discard the overlapping rows
+	vector<vector<uint32_t>> _bandBuffers;
+
 	void ApplyPrescaleFilter(uint32_t *inputArgbBuffer);
 	void UpdateOutputBuffer(uint32_t width, uint32_t height);
 
+	uint32_t GetBandOverlap();
+	void ApplyFilter(uint32_t *inputArgbBuffer, uint32_t *outputBuffer, uint32_t width, uint32_t height);
+	void ApplyFilterToRows(uint32_t *inputArgbBuffer, uint32_t width, uint32_t height, uint32_t yFirst, uint32_t yLast, vector<uint32_t>& bandBuffer);
+
 public:
 	ScaleFilter(ScaleFilterType scaleFilterType, uint32_t scale);
 	~ScaleFilter();
 
 	uint32_t GetScale();
-	uint32_t* ApplyFilter(uint32_t *inputArgbBuffer, uint32_t width, uint32_t height);
+	uint32_t* ApplyFilter(uint32_t *inputArgbBuffer, uint32_t width, uint32_t height, ThreadPool* pool = nullptr);
 	FrameInfo GetFrameInfo(FrameInfo baseFrameInfo);
 
 	static unique_ptr<ScaleFilter> GetScaleFilter(VideoFilterType filter);
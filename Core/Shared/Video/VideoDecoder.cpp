@@ -16,12 +16,17 @@
 #include "Shared/RenderedFrame.h"
 #include "Shared/Video/SystemHud.h"
 #include "SNES/CartTypes.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/Timer.h"
 
 VideoDecoder::VideoDecoder(Emulator* emu)
 {
 	_emu = emu;
 	_frameChanged = false;
 	_stopFlag = false;
+	_bandedFilterTime = 0;
+	_serialFilterTime = 0;
+	_filterWorkerCount = 0;
 	_baseFrameSize = { 256, 239 };
 	_lastFrameSize = _baseFrameSize;
 }
@@ -78,6 +83,17 @@ void VideoDecoder::UpdateVideoFilter()
 		_videoFilter.reset(_emu->GetVideoFilter());
 		_scaleFilter = ScaleFilter::GetScaleFilter(_videoFilterType);
 		_forceFilterUpdate = false;
+
+		_bandedFilterTime = 0;
+		_serialFilterTime = 0;
+
+		if(_scaleFilter && !_filterPool) {
+			_filterPool = ThreadPool::GetSharedPool();
+			_filterWorkerCount = _filterPool->GetWorkerCount();
+			if(_filterWorkerCount == 0) {
+				_filterPool.reset();
+			}
+		}
 	}
 
 	uint32_t screenRotation = _emu->GetSettings()->GetVideoConfig().ScreenRotation;
@@ -123,7 +139,14 @@ void VideoDecoder::DecodeFrame(bool forRewind)
 	_emu->GetDebugHud()->Draw(outputBuffer, frameSize, overscan, _frame.FrameNumber, _videoFilter->GetScaleFactor());
 
 	if(_scaleFilter && !isAudioPlayer) {
-		outputBuffer = _scaleFilter->ApplyFilter(outputBuffer, frameSize.Width, frameSize.Height);
+		bool serial = !_filterPool || (_emu->GetSettings()->GetPreferences().ShowDebugInfo && (_frame.FrameNumber % VideoDecoder::SerialFilterInterval) == 0);
+		Timer filterTimer;
+		outputBuffer = _scaleFilter->ApplyFilter(outputBuffer, frameSize.Width, frameSize.Height, serial ? nullptr : _filterPool.get());
+
+		atomic<double>& filterTime = serial ? _serialFilterTime : _bandedFilterTime;
+		double elapsed = filterTimer.GetElapsedMS();
+		double average = filterTime;
+		filterTime = average == 0 ? elapsed : (average * 0.9 + elapsed * 0.1);
 		frameSize = _scaleFilter->GetFrameInfo(frameSize);
 	}
 
@@ -163,6 +186,15 @@ void VideoDecoder::DecodeThread()
 	}
 }
 
+ScaleFilterStats VideoDecoder::GetScaleFilterStats()
+{
+	ScaleFilterStats stats = {};
+	stats.BandedTime = _bandedFilterTime;
+	stats.SerialTime = _serialFilterTime;
+	stats.WorkerCount = _filterWorkerCount;
+	return stats;
+}
+
 uint32_t VideoDecoder::GetFrameCount()
 {
 	return _frameCount;
@@ -8,12 +8,25 @@
 class BaseVideoFilter;
 class ScaleFilter;
 class RotateFilter;
+class ThreadPool;
 class IRenderingDevice;
 class Emulator;
 
+struct ScaleFilterStats
+{
+	//Average time spent in the scale filter per frame (in ms), 0 when not measured yet
+	double BandedTime;
+	double SerialTime;
+	uint32_t WorkerCount;
+};
+
 class VideoDecoder
 {
 private:
+	//While the debug stats are shown, the scale filter runs on a single thread once every SerialFilterInterval
+	//frames, to compare the banded and single-threaded paths (both produce identical output)
+	static constexpr uint32_t SerialFilterInterval = 30;
+
 	Emulator* _emu;
 
 	ConsoleType _consoleType = ConsoleType::Snes;
@@ -39,6 +52,12 @@ private:
 	unique_ptr<ScaleFilter> _scaleFilter;
 	unique_ptr<RotateFilter> _rotateFilter;
 
+	//Used by the scale filters to process several bands of the frame in parallel (shared with the HD packs)
+	shared_ptr<ThreadPool> _filterPool;
+	atomic<double> _bandedFilterTime;
+	atomic<double> _serialFilterTime;
+	atomic<uint32_t> _filterWorkerCount;
+
 	void UpdateVideoFilter();
 
 	void DecodeThread();
@@ -59,6 +78,7 @@ public:
 	FrameInfo GetBaseFrameInfo(bool removeOverscan);
 	FrameInfo GetFrameInfo();
 	double GetLastFrameScale() { return _frame.Scale; }
+	ScaleFilterStats GetScaleFilterStats();
 
 	void UpdateFrame(RenderedFrame frame, bool sync, bool forRewind);
 
@@ -83,6 +83,9 @@ extern "C"
 
 	DllExport void __stdcall StartLogTraceToFile(const char* filename) { WithDebugger(void, GetTraceLogFileSaver()->StartLogging(filename)); }
 	DllExport void __stdcall StopLogTraceToFile() { WithDebugger(void, GetTraceLogFileSaver()->StopLogging()); }
+	DllExport bool __stdcall IsTraceLogFileFormatting() { return WithDebugger(bool, GetTraceLogFileSaver()->IsFormatting()); }
+	DllExport double __stdcall GetTraceLogFileFormatProgress() { return WithDebugger(double, GetTraceLogFileSaver()->GetFormatProgress()); }
+	DllExport void __stdcall CancelTraceLogFileFormat() { WithDebugger(void, GetTraceLogFileSaver()->CancelFormat()); }
 
 	DllExport void __stdcall SetBreakpoints(Breakpoint breakpoints[], uint32_t length) { WithDebugger(void, SetBreakpoints(breakpoints, length)); }
 	
@@ -31,12 +31,6 @@ void SdlSoundManager::Release()
 		Stop();
 		SDL_CloseAudioDevice(_audioDeviceID);
 	}
-
-	if(_buffer) {
-		delete[] _buffer;
-		_buffer = nullptr;
-		_bufferSize = 0;
-	}
 }
 
 bool SdlSoundManager::InitializeAudio(uint32_t sampleRate, bool isStereo)
@@ -50,20 +44,24 @@ bool SdlSoundManager::InitializeAudio(uint32_t sampleRate, bool isStereo)
 
 	_sampleRate = sampleRate;
 	_isStereo = isStereo;
-	_previousLatency = _emu->GetSettings()->GetAudioConfig().AudioLatency;
+	AudioConfig cfg = _emu->GetSettings()->GetAudioConfig();
+	_previousLatency = cfg.AudioLatency;
+	_pullMode = cfg.LowLatencyMode;
+	_channelCount = isStereo ? 2 : 1;
+	_targetFrameCount = (uint32_t)((uint64_t)sampleRate * _previousLatency / 1000);
+	_lastFrame[0] = _lastFrame[1] = 0;
 
 	int bytesPerSample = 2 * (isStereo ? 2 : 1);
 	int32_t requestedByteLatency = (int32_t)((float)(sampleRate * _previousLatency) / 1000.0f * bytesPerSample);
-	_bufferSize = (int32_t)std::ceil((double)requestedByteLatency * 2 / 0x10000) * 0x10000;
-	_buffer = new uint8_t[_bufferSize];
-	memset(_buffer, 0, _bufferSize);
+	_ring.Init(std::max(requestedByteLatency * 2, 0x10000) / 2);
+	_bufferSize = _ring.GetCapacity() * sizeof(int16_t);
 
 	SDL_AudioSpec audioSpec;
 	SDL_memset(&audioSpec, 0, sizeof(audioSpec));
 	audioSpec.freq = sampleRate;
 	audioSpec.format = AUDIO_S16SYS; //16-bit samples
 	audioSpec.channels = isStereo ? 2 : 1;
-	audioSpec.samples = 1024;
+	audioSpec.samples = _pullMode ? 256 : 1024;
 	audioSpec.callback = &SdlSoundManager::FillAudioBuffer;
 	audioSpec.userdata = this;
 
@@ -75,9 +73,6 @@ bool SdlSoundManager::InitializeAudio(uint32_t sampleRate, bool isStereo)
 		_audioDeviceID = SDL_OpenAudioDevice(nullptr, isCapture, &audioSpec, &obtainedSpec, 0);
 	}
 
-	_writePosition = 0;
-	_readPosition = 0;
-
 	_needReset = false;
 
 	return _audioDeviceID != 0;
@@ -119,49 +114,66 @@ void SdlSoundManager::SetAudioDevice(string deviceName)
 
 void SdlSoundManager::ReadFromBuffer(uint8_t* output, uint32_t len)
 {
-	if(_readPosition + len < _bufferSize) {
-		memcpy(output, _buffer+_readPosition, len);
-		_readPosition += len;
+	if(_pullMode) {
+		PullFromBuffer((int16_t*)output, len / (_channelCount * sizeof(int16_t)));
 	} else {
-		int remainingBytes = (_bufferSize - _readPosition);
-		memcpy(output, _buffer+_readPosition, remainingBytes);
-		memcpy(output+remainingBytes, _buffer, len - remainingBytes);
-		_readPosition = len - remainingBytes;
-	}
-
-	if(_readPosition >= _writePosition && _readPosition - _writePosition < _bufferSize / 2) {
-		_bufferUnderrunEventCount++;
+		_ring.Read((int16_t*)output, len / sizeof(int16_t));
 	}
 }
 
-void SdlSoundManager::WriteToBuffer(uint8_t* input, uint32_t len)
+void SdlSoundManager::PullFromBuffer(int16_t* output, uint32_t frameCount)
 {
-	if(_writePosition + len < _bufferSize) {
-		memcpy(_buffer+_writePosition, input, len);
-		_writePosition += len;
+	if(frameCount == 0) {
+		return;
+	}
+
+	//Consume up to 0.5% more/fewer frames than requested when the buffered audio is more than
+	//one callback's worth away from the target latency (at least 1 frame per callback)
+	int32_t fill = (int32_t)(_ring.GetFillLevel() / _channelCount);
+	int32_t gap = fill - (int32_t)_targetFrameCount;
+	int32_t maxStep = std::max<int32_t>(1, frameCount / 200);
+	int32_t step = std::clamp<int32_t>(gap / (int32_t)frameCount, -maxStep, maxStep);
+	uint32_t inputCount = frameCount + step;
+
+	if(inputCount == frameCount) {
+		_ring.Read(output, frameCount * _channelCount);
 	} else {
-		int remainingBytes = _bufferSize - _writePosition;
-		memcpy(_buffer+_writePosition, input, remainingBytes);
-		memcpy(_buffer, ((uint8_t*)input)+remainingBytes, len - remainingBytes);
-		_writePosition = len - remainingBytes;
+		//Input frame 0 is the last frame of the previous callback, so playback stays continuous
+		_pullBuffer.resize((inputCount + 1) * _channelCount);
+		int16_t* input = _pullBuffer.data();
+		memcpy(input, _lastFrame, _channelCount * sizeof(int16_t));
+		_ring.Read(input + _channelCount, inputCount * _channelCount);
+
+		//Linear interpolation, output frame i is at position (i + 1) * inputCount / frameCount
+		for(uint32_t i = 0; i < frameCount; i++) {
+			uint64_t pos = ((uint64_t)(i + 1) * inputCount << 16) / frameCount;
+			uint32_t index = (uint32_t)(pos >> 16);
+			int32_t frac = (int32_t)(pos & 0xFFFF);
+			int16_t* a = input + index * _channelCount;
+			int16_t* b = index < inputCount ? a + _channelCount : a;
+			for(uint32_t ch = 0; ch < _channelCount; ch++) {
+				output[i * _channelCount + ch] = (int16_t)(a[ch] + (int32_t)(((int64_t)(b[ch] - a[ch]) * frac) >> 16));
+			}
+		}
 	}
+
+	memcpy(_lastFrame, output + (frameCount - 1) * _channelCount, _channelCount * sizeof(int16_t));
 }
+
 void SdlSoundManager::PlayBuffer(int16_t *soundBuffer, uint32_t sampleCount, uint32_t sampleRate, bool isStereo)
 {
 	uint32_t bytesPerSample = 2 * (isStereo ? 2 : 1);
-	uint32_t latency = _emu->GetSettings()->GetAudioConfig().AudioLatency;
-	if(_sampleRate != sampleRate || _isStereo != isStereo || _needReset || _previousLatency != latency) {
+	AudioConfig cfg = _emu->GetSettings()->GetAudioConfig();
+	uint32_t latency = cfg.AudioLatency;
+	if(_sampleRate != sampleRate || _isStereo != isStereo || _needReset || _previousLatency != latency || _pullMode != cfg.LowLatencyMode) {
 		Release();
 		InitializeAudio(sampleRate, isStereo);
 	}
 
-	WriteToBuffer((uint8_t*)soundBuffer, sampleCount * bytesPerSample);
+	_ring.Write(soundBuffer, sampleCount * (isStereo ? 2 : 1));
 
 	int32_t byteLatency = (int32_t)((float)(sampleRate * latency) / 1000.0f * bytesPerSample);
-	int32_t playWriteByteLatency = _writePosition - _readPosition;
-	if(playWriteByteLatency < 0) {
-		playWriteByteLatency = _bufferSize - _readPosition + _writePosition;
-	}
+	int32_t playWriteByteLatency = (int32_t)(_ring.GetFillLevel() * sizeof(int16_t));
 
 	if(playWriteByteLatency > byteLatency) {
 		//Start playing
@@ -178,14 +190,13 @@ void SdlSoundManager::Stop()
 {
 	Pause();
 
-	_readPosition = 0;
-	_writePosition = 0;
+	_ring.Reset();
 	ResetStats();
 }
 
 void SdlSoundManager::ProcessEndOfFrame()
 {
-	ProcessLatency(_readPosition, _writePosition);
+	ProcessBufferLevel(_ring.GetFillLevel() * sizeof(int16_t));
 
 	uint32_t emulationSpeed = _emu->GetSettings()->GetEmulationSpeed();
 	if(_averageLatency > 0 && emulationSpeed <= 100 && emulationSpeed > 0 && std::abs(_averageLatency - _emu->GetSettings()->GetAudioConfig().AudioLatency) > 50) {
@@ -193,3 +204,12 @@ void SdlSoundManager::ProcessEndOfFrame()
 		Stop();
 	}
 }
+
+AudioStatistics SdlSoundManager::GetStatistics()
+{
+	AudioStatistics stats = BaseSoundManager::GetStatistics();
+	stats.BufferUnderrunEventCount = _ring.GetUnderrunCount();
+	stats.BufferOverrunEventCount = _ring.GetOverrunCount();
+	stats.PullMode = _pullMode;
+	return stats;
+}
@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "SDL.h"
 #include "Core/Shared/Audio/BaseSoundManager.h"
+#include "Core/Shared/Audio/AudioRingBuffer.h"
 
 class Emulator;
 
@@ -10,14 +11,15 @@ public:
 	SdlSoundManager(Emulator* emu);
 	~SdlSoundManager();
 
-	void PlayBuffer(int16_t *soundBuffer, uint32_t bufferSize, uint32_t sampleRate, bool isStereo);
-	void Pause();
-	void Stop();
+	void PlayBuffer(int16_t *soundBuffer, uint32_t bufferSize, uint32_t sampleRate, bool isStereo) override;
+	void Pause() override;
+	void Stop() override;
 
-	void ProcessEndOfFrame();
+	void ProcessEndOfFrame() override;
+	AudioStatistics GetStatistics() override;
 
-	string GetAvailableDevices();
-	void SetAudioDevice(string deviceName);
+	string GetAvailableDevices() override;
+	void SetAudioDevice(string deviceName) override;
 
 private:
 	vector<string> GetAvailableDeviceInfo();
@@ -27,7 +29,7 @@ private:
 	static void FillAudioBuffer(void *userData, uint8_t *stream, int len);
 
 	void ReadFromBuffer(uint8_t* output, uint32_t len);
-	void WriteToBuffer(uint8_t* output, uint32_t len);
+	void PullFromBuffer(int16_t* output, uint32_t frameCount);
 
 private:
 	Emulator* _emu;
@@ -37,7 +39,14 @@ private:
 
 	uint16_t _previousLatency = 0;
 
-	uint8_t* _buffer = nullptr;
-	uint32_t _writePosition = 0;
-	uint32_t _readPosition = 0;
+	//Written by the emulation thread, read by SDL's audio thread
+	AudioRingBuffer _ring;
+
+	//Low latency mode: the callback consumes slightly more or fewer samples than it outputs to keep
+	//the ring buffer's fill level close to the requested latency (replaces the resampler's own adjustment)
+	bool _pullMode = false;
+	uint32_t _channelCount = 1;
+	uint32_t _targetFrameCount = 0;
+	int16_t _lastFrame[2] = {};
+	vector<int16_t> _pullBuffer;
 };
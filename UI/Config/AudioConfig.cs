@@ -15,6 +15,7 @@ namespace Mesen.Config
 		[Reactive] public string AudioDevice { get; set; } = "";
 		[Reactive] public bool EnableAudio { get; set; } = true;
 		[Reactive] public bool DisableDynamicSampleRate { get; set; } = false;
+		[Reactive] public bool LowLatencyMode { get; set; } = false;
 
 		[Reactive] [MinMax(0, 100)] public UInt32 MasterVolume { get; set; } = 100;
 		[Reactive] public AudioSampleRate SampleRate { get; set; } = AudioSampleRate._48000;
@@ -65,6 +66,7 @@ namespace Mesen.Config
 				AudioDevice = AudioDevice,
 				EnableAudio = EnableAudio,
 				DisableDynamicSampleRate = DisableDynamicSampleRate,
+				LowLatencyMode = LowLatencyMode,
 
 				MasterVolume = MasterVolume,
 				SampleRate = (UInt32)SampleRate,
@@ -117,6 +119,7 @@ namespace Mesen.Config
 		[MarshalAs(UnmanagedType.LPStr)] public string AudioDevice;
 		[MarshalAs(UnmanagedType.I1)] public bool EnableAudio;
 		[MarshalAs(UnmanagedType.I1)] public bool DisableDynamicSampleRate;
+		[MarshalAs(UnmanagedType.I1)] public bool LowLatencyMode;
 
 		public UInt32 MasterVolume;
 		public UInt32 SampleRate;
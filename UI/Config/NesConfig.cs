@@ -37,6 +37,7 @@ namespace Mesen.Config
 		[Reactive] public ConsoleRegion Region { get; set; } = ConsoleRegion.Auto;
 
 		[Reactive] public bool EnableHdPacks { get; set; } = true;
+		[Reactive][MinMax(0, 16384)] public UInt32 HdPackTextureBudget { get; set; } = 0;
 		[Reactive] public bool DisableGameDatabase { get; set; } = false;
 		[Reactive] public bool FdsAutoLoadDisk { get; set; } = true;
 		[Reactive] public bool FdsFastForwardOnLoad { get; set; } = false;
@@ -151,6 +152,7 @@ namespace Mesen.Config
 
 				Region = Region,
 				EnableHdPacks = EnableHdPacks,
+				HdPackTextureBudget = HdPackTextureBudget,
 				DisableGameDatabase = DisableGameDatabase,
 				FdsAutoLoadDisk = FdsAutoLoadDisk,
 				FdsFastForwardOnLoad = FdsFastForwardOnLoad,
@@ -317,6 +319,7 @@ namespace Mesen.Config
 
 		public ConsoleRegion Region;
 		[MarshalAs(UnmanagedType.I1)] public bool EnableHdPacks;
+		public UInt32 HdPackTextureBudget;
 		[MarshalAs(UnmanagedType.I1)] public bool DisableGameDatabase;
 		[MarshalAs(UnmanagedType.I1)] public bool FdsAutoLoadDisk;
 		[MarshalAs(UnmanagedType.I1)] public bool FdsFastForwardOnLoad;
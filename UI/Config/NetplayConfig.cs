@@ -8,6 +8,8 @@ namespace Mesen.Config
 		[Reactive] public string Host { get; set; } = "localhost";
 		[Reactive] public UInt16 Port { get; set; } = 8888;
 		[Reactive] public string Password { get; set; } = "";
+		[Reactive] public bool UseRollback { get; set; } = false;
+		[Reactive] public UInt32 SimulatedLatency { get; set; } = 0;
 
 		[Reactive] public UInt16 ServerPort { get; set; } = 8888;
 		[Reactive] public string ServerPassword { get; set; } = "";
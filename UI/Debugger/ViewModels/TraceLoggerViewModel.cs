@@ -32,6 +32,8 @@ namespace Mesen.Debugger.ViewModels
 		[Reactive] public int MinScrollPosition { get; set; } = 0;
 		[Reactive] public int MaxScrollPosition { get; set; } = DebugApi.TraceLogBufferSize;
 		[Reactive] public bool IsLoggingToFile { get; set; } = false;
+		[Reactive] public bool IsFormattingTraceFile { get; set; } = false;
+		[Reactive] public double TraceFileProgress { get; set; } = 0;
 
 		[Reactive] public List<TraceLoggerOptionTab> Tabs { get; set; } = new();
 		[Reactive] public TraceLoggerOptionTab SelectedTab { get; set; } = null!;
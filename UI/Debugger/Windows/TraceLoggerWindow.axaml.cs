@@ -22,6 +22,7 @@ namespace Mesen.Debugger.Windows
 	{
 		private TraceLoggerViewModel _model;
 		private CodeViewerSelectionHandler _selectionHandler;
+		private DispatcherTimer _formatTimer;
 
 		[Obsolete("For designer only")]
 		public TraceLoggerWindow() : this(new()) { }
@@ -48,6 +49,9 @@ namespace Mesen.Debugger.Windows
 
 			DataContext = model;
 
+			//The trace file is converted to text after logging stops, poll for its progress until it's done
+			_formatTimer = new DispatcherTimer(TimeSpan.FromMilliseconds(100), DispatcherPriority.Normal, (s, e) => UpdateFormatProgress());
+
 			if(Design.IsDesignMode) {
 				return;
 			}
@@ -59,6 +63,9 @@ namespace Mesen.Debugger.Windows
 		{
 			base.OnClosing(e);
 			_model.Config.SaveWindowSettings(this);
+			_formatTimer.Stop();
+
+			//The file's conversion to text continues in the background after the window is closed
 			DebugApi.StopLogTraceToFile();
 			
 			//Disable trace logging for all cpus
@@ -203,9 +210,26 @@ namespace Mesen.Debugger.Windows
 
 		private void OnStopLoggingClick(object sender, RoutedEventArgs e)
 		{
-			if(_model.IsLoggingToFile) {
-				_model.IsLoggingToFile = false;
+			if(_model.IsFormattingTraceFile) {
+				//Stop converting the file, it will only contain the rows converted so far
+				DebugApi.CancelTraceLogFileFormat();
+				UpdateFormatProgress();
+			} else if(_model.IsLoggingToFile) {
 				DebugApi.StopLogTraceToFile();
+				_model.TraceFileProgress = 0;
+				_model.IsFormattingTraceFile = true;
+				_formatTimer.Start();
+			}
+		}
+
+		private void UpdateFormatProgress()
+		{
+			if(DebugApi.IsTraceLogFileFormatting()) {
+				_model.TraceFileProgress = DebugApi.GetTraceLogFileFormatProgress() * 100;
+			} else {
+				_formatTimer.Stop();
+				_model.IsFormattingTraceFile = false;
+				_model.IsLoggingToFile = false;
 			}
 		}
 
@@ -24,6 +24,9 @@ namespace Mesen.Interop
 
 		[DllImport(DllPath)] public static extern void StartLogTraceToFile([MarshalAs(UnmanagedType.LPUTF8Str)] string filename);
 		[DllImport(DllPath)] public static extern void StopLogTraceToFile();
+		[DllImport(DllPath)] [return: MarshalAs(UnmanagedType.I1)] public static extern bool IsTraceLogFileFormatting();
+		[DllImport(DllPath)] public static extern double GetTraceLogFileFormatProgress();
+		[DllImport(DllPath)] public static extern void CancelTraceLogFileFormat();
 
 		[DllImport(DllPath)] public static extern void SetTraceOptions(CpuType cpuType, InteropTraceLoggerOptions options);
 
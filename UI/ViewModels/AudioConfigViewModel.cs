@@ -16,12 +16,16 @@ namespace Mesen.ViewModels
 		[Reactive] public AudioConfig OriginalConfig { get; set; }
 		[Reactive] public List<string> AudioDevices { get; set; } = new();
 		[Reactive] public bool ShowLatencyWarning { get; set; } = false;
+		public bool IsWindows { get; }
 
 		public AudioConfigViewModel()
 		{
 			Config = ConfigManager.Config.Audio;
 			OriginalConfig = Config.Clone();
 
+			//Low latency mode is only implemented for SDL (Linux/macOS)
+			IsWindows = OperatingSystem.IsWindows();
+
 			if(Design.IsDesignMode) {
 				return;
 			}
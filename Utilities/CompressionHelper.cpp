@@ -0,0 +1,186 @@
+#include "pch.h"
+#include "CompressionHelper.h"
+
+//Uses the LZ4 block format: each sequence is a token (literal length/match length nibbles),
+//the literals, a 16-bit match offset and the extra match length bytes.
+static constexpr int HashBits = 12;
+static constexpr size_t MinMatch = 4;
+static constexpr size_t LastLiterals = 5; //The last bytes of the input are always stored as literals
+static constexpr size_t MatchLimit = 12; //No match can start within the last 12 bytes of the input
+static constexpr size_t MaxOffset = 0xFFFF;
+
+static uint32_t ReadU32(const uint8_t* ptr)
+{
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+static uint64_t ReadU64(const uint8_t* ptr)
+{
+	uint64_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+static uint32_t GetHash(uint32_t value)
+{
+	return (value * 2654435761u) >> (32 - HashBits);
+}
+
+static uint8_t* WriteLength(uint8_t* dst, size_t length)
+{
+	while(length >= 255) {
+		*dst++ = 255;
+		length -= 255;
+	}
+	*dst++ = (uint8_t)length;
+	return dst;
+}
+
+size_t CompressionHelper::FastCompress(const uint8_t* src, size_t srcSize, uint8_t* dst)
+{
+	uint32_t hashTable[1 << HashBits] = {};
+	uint8_t* out = dst;
+	size_t anchor = 0;
+
+	auto writeSequence = [&](size_t literalEnd, size_t matchLength, size_t offset) {
+		size_t literalLength = literalEnd - anchor;
+		uint8_t* token = out++;
+		*token = (uint8_t)(std::min<size_t>(literalLength, 15) << 4);
+		if(literalLength >= 15) {
+			out = WriteLength(out, literalLength - 15);
+		}
+		if(literalLength) {
+			memcpy(out, src + anchor, literalLength);
+			out += literalLength;
+		}
+
+		if(matchLength) {
+			*out++ = (uint8_t)offset;
+			*out++ = (uint8_t)(offset >> 8);
+			*token |= (uint8_t)std::min<size_t>(matchLength - MinMatch, 15);
+			if(matchLength - MinMatch >= 15) {
+				out = WriteLength(out, matchLength - MinMatch - 15);
+			}
+		}
+	};
+
+	if(srcSize > MatchLimit) {
+		size_t matchStartLimit = srcSize - MatchLimit;
+		size_t matchEndLimit = srcSize - LastLiterals;
+		size_t pos = 1;
+		hashTable[GetHash(ReadU32(src))] = 0;
+
+		while(pos < matchStartLimit) {
+			uint32_t value = ReadU32(src + pos);
+			uint32_t hash = GetHash(value);
+			size_t ref = hashTable[hash];
+			hashTable[hash] = (uint32_t)pos;
+
+			if(pos - ref > MaxOffset || ReadU32(src + ref) != value) {
+				//Skip faster through data that doesn't compress well
+				pos += 1 + ((pos - anchor) >> 6);
+				continue;
+			}
+
+			//Extend the match backwards over the pending literals, then forwards
+			while(pos > anchor && ref > 0 && src[pos - 1] == src[ref - 1]) {
+				pos--;
+				ref--;
+			}
+
+			size_t matchEnd = pos + MinMatch;
+			while(matchEnd + 8 <= matchEndLimit && ReadU64(src + matchEnd) == ReadU64(src + ref + matchEnd - pos)) {
+				matchEnd += 8;
+			}
+			while(matchEnd < matchEndLimit && src[matchEnd] == src[ref + matchEnd - pos]) {
+				matchEnd++;
+			}
+
+			writeSequence(pos, matchEnd - pos, pos - ref);
+			anchor = matchEnd;
+			pos = matchEnd;
+
+			if(pos < matchStartLimit) {
+				hashTable[GetHash(ReadU32(src + pos - 2))] = (uint32_t)(pos - 2);
+			}
+		}
+	}
+
+	writeSequence(srcSize, 0, 0);
+	return out - dst;
+}
+
+bool CompressionHelper::FastDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+	const uint8_t* in = src;
+	const uint8_t* inEnd = src + srcSize;
+	size_t outPos = 0;
+
+	auto readLength = [&](size_t& length) {
+		uint8_t value;
+		do {
+			if(in >= inEnd) {
+				return false;
+			}
+			value = *in++;
+			length += value;
+		} while(value == 255);
+		return true;
+	};
+
+	while(in < inEnd) {
+		uint8_t token = *in++;
+
+		size_t literalLength = token >> 4;
+		if(literalLength == 15 && !readLength(literalLength)) {
+			return false;
+		}
+		if(literalLength > (size_t)(inEnd - in) || literalLength > dstSize - outPos) {
+			return false;
+		}
+		if(literalLength) {
+			memcpy(dst + outPos, in, literalLength);
+			in += literalLength;
+			outPos += literalLength;
+		}
+
+		if(in == inEnd) {
+			//The last sequence only contains literals
+			break;
+		}
+
+		if(inEnd - in < 2) {
+			return false;
+		}
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+
+		size_t matchLength = token & 0x0F;
+		if(matchLength == 15 && !readLength(matchLength)) {
+			return false;
+		}
+		matchLength += MinMatch;
+
+		if(offset == 0 || offset > outPos || matchLength > dstSize - outPos) {
+			return false;
+		}
+
+		uint8_t* out = dst + outPos;
+		const uint8_t* ref = out - offset;
+		if(offset >= matchLength) {
+			memcpy(out, ref, matchLength);
+		} else if(offset == 1) {
+			memset(out, *ref, matchLength);
+		} else {
+			//Overlapping match (e.g runs of the same byte)
+			for(size_t i = 0; i < matchLength; i++) {
+				out[i] = ref[i];
+			}
+		}
+		outPos += matchLength;
+	}
+
+	return outPos == dstSize;
+}
@@ -4,6 +4,14 @@
 
 class CompressionHelper
 {
+private:
+	//Set in the compressed size field when the data was compressed with CompressFast
+	static constexpr uint32_t FastCodecFlag = 0x80000000;
+
+	static size_t GetFastBound(size_t size) { return size + size / 255 + 16; }
+	static size_t FastCompress(const uint8_t* src, size_t srcSize, uint8_t* dst);
+	static bool FastDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+
 public:
 	static void Compress(string data, int compressionLevel, vector<uint8_t>& output)
 	{
@@ -19,14 +27,40 @@ public:
 		delete[] compressedData;
 	}
 
+	//LZ4-style byte-oriented codec - much faster than deflate (at a lower ratio), meant for data
+	//that is compressed often and kept in memory (e.g rewind states). Decompress() handles both formats.
+	static void CompressFast(const uint8_t* data, size_t size, vector<uint8_t>& output)
+	{
+		size_t headerPos = output.size();
+		size_t dataPos = headerPos + sizeof(uint32_t) * 2;
+		output.resize(dataPos + GetFastBound(size));
+
+		uint32_t compressedSize = (uint32_t)FastCompress(data, size, output.data() + dataPos);
+		uint32_t sizeField = compressedSize | FastCodecFlag;
+		uint32_t originalSize = (uint32_t)size;
+		memcpy(output.data() + headerPos, &originalSize, sizeof(uint32_t));
+		memcpy(output.data() + headerPos + sizeof(uint32_t), &sizeField, sizeof(uint32_t));
+
+		//Release the worst-case allocation, the output is usually kept in memory for a while
+		output.resize(dataPos + compressedSize);
+		output.shrink_to_fit();
+	}
+
 	static bool Decompress(vector<uint8_t>& input, vector<uint8_t>& output)
 	{
+		if(input.size() < sizeof(uint32_t) * 2) {
+			return false;
+		}
+
 		uint32_t decompressedSize;
 		uint32_t compressedSize;
 
 		memcpy(&decompressedSize, input.data(), sizeof(uint32_t));
 		memcpy(&compressedSize, input.data() + sizeof(uint32_t), sizeof(uint32_t));
 
+		bool isFastCodec = (compressedSize & FastCodecFlag) != 0;
+		compressedSize &= ~FastCodecFlag;
+
 		if(decompressedSize >= 1024 * 1024 * 10 || compressedSize >= 1024 * 1024 * 10) {
 			//Limit to 10mb the data's size
 			return false;
@@ -34,6 +68,13 @@ public:
 
 		output.resize(decompressedSize, 0);
 
+		if(isFastCodec) {
+			if(compressedSize > input.size() - sizeof(uint32_t) * 2) {
+				return false;
+			}
+			return FastDecompress(input.data() + sizeof(uint32_t) * 2, compressedSize, output.data(), decompressedSize);
+		}
+
 		unsigned long decompSize = decompressedSize;
 		if(uncompress(output.data(), &decompSize, input.data() + sizeof(uint32_t)*2, (unsigned long)input.size() - sizeof(uint32_t) * 2) != MZ_OK) {
 			return false;
@@ -225,6 +225,18 @@ string FolderUtilities::GetFolderName(string filepath)
 	return fs::u8path(filepath).remove_filename().u8string();
 }
 
+bool FolderUtilities::GetFileInfo(string filepath, uint64_t& size, int64_t& modifiedTime)
+{
+	std::error_code errorCode;
+	fs::path path = fs::u8path(filepath);
+	size = (uint64_t)fs::file_size(path, errorCode);
+	if(errorCode) {
+		return false;
+	}
+	modifiedTime = (int64_t)fs::last_write_time(path, errorCode).time_since_epoch().count();
+	return !errorCode;
+}
+
 string FolderUtilities::CombinePath(string folder, string filename)
 {
 	//Windows supports forward slashes for paths, too.  And fs::u8path is abnormally slow.
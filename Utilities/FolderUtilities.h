@@ -36,6 +36,7 @@ public:
 	static string GetFilename(string filepath, bool includeExtension);
 	static string GetExtension(string filename);
 	static string GetFolderName(string filepath);
+	static bool GetFileInfo(string filepath, uint64_t& size, int64_t& modifiedTime);
 
 	static void CreateFolder(string folder);
 
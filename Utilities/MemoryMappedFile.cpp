@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "Utilities/MemoryMappedFile.h"
+#include "Utilities/UTF8Util.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+bool MemoryMappedFile::Open(const string& path)
+{
+	Close();
+
+	HANDLE file = CreateFileW(utf8::utf8::decode(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || (uint64_t)fileSize.QuadPart > SIZE_MAX) {
+		//Empty files can't be mapped
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(!mapping) {
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(!view) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	_fileHandle = file;
+	_mappingHandle = mapping;
+	_data = (uint8_t*)view;
+	_size = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if(_data) {
+		UnmapViewOfFile(_data);
+		_data = nullptr;
+	}
+	if(_mappingHandle) {
+		CloseHandle((HANDLE)_mappingHandle);
+		_mappingHandle = nullptr;
+	}
+	if(_fileHandle) {
+		CloseHandle((HANDLE)_fileHandle);
+		_fileHandle = nullptr;
+	}
+	_size = 0;
+}
+#else
+bool MemoryMappedFile::Open(const string& path)
+{
+	Close();
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+
+	struct stat fileInfo;
+	if(fstat(fd, &fileInfo) != 0 || fileInfo.st_size <= 0) {
+		//Empty files can't be mapped
+		close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(view == MAP_FAILED) {
+		close(fd);
+		return false;
+	}
+
+	_fd = fd;
+	_data = (uint8_t*)view;
+	_size = (size_t)fileInfo.st_size;
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if(_data) {
+		munmap(_data, _size);
+		_data = nullptr;
+	}
+	if(_fd >= 0) {
+		close(_fd);
+		_fd = -1;
+	}
+	_size = 0;
+}
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+#include "pch.h"
+
+//Read-only view of an entire file, mapped into memory by the OS
+class MemoryMappedFile
+{
+private:
+	uint8_t* _data = nullptr;
+	size_t _size = 0;
+
+#ifdef _WIN32
+	void* _fileHandle = nullptr;
+	void* _mappingHandle = nullptr;
+#else
+	int _fd = -1;
+#endif
+
+public:
+	MemoryMappedFile() { }
+	~MemoryMappedFile();
+
+	MemoryMappedFile(const MemoryMappedFile&) = delete;
+	MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+	bool Open(const string& path);
+	void Close();
+
+	bool IsOpen() { return _data != nullptr; }
+	const uint8_t* GetData() { return _data; }
+	size_t GetSize() { return _size; }
+};
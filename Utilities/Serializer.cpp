@@ -1,5 +1,6 @@
 #include "pch.h"
 #include <algorithm>
+#include <sstream>
 #include "Serializer.h"
 #include "ISerializable.h"
 #include "miniz.h"
@@ -12,6 +13,7 @@ Serializer::Serializer(uint32_t version, bool forSave, SerializeFormat format)
 	if(forSave) {
 		switch(format) {
 			case SerializeFormat::Binary: _data.reserve(0x50000); break;
+			case SerializeFormat::Positional: _data.reserve(0x50000); _data.resize(PositionalHeaderSize); break;
 			case SerializeFormat::Map: _mapValues.reserve(500); break;
 			case SerializeFormat::Text: _values.reserve(500); break;
 		}
@@ -75,7 +77,17 @@ bool Serializer::LoadFrom(istream &file)
 	file.get(value);
 	bool isCompressed = value == 1;
 
-	if(isCompressed) {
+	if(value == 2) {
+		//Positional format, the values are read directly from _data as they are streamed
+		uint32_t pos = (uint32_t)file.tellg() - 1;
+		file.seekg(0, std::ios::end);
+		uint32_t stateSize = (uint32_t)file.tellg() - pos;
+		file.seekg(pos, std::ios::beg);
+
+		_data = vector<uint8_t>(stateSize, 0);
+		file.read((char*)_data.data(), stateSize);
+		return InitPositionalFormat();
+	} else if(isCompressed) {
 		uint32_t decompressedSize;
 		file.read((char*)&decompressedSize, sizeof(decompressedSize));
 
@@ -147,6 +159,36 @@ bool Serializer::LoadFrom(istream &file)
 	return _values.size() > 0;
 }
 
+bool Serializer::LoadFrom(const vector<uint8_t>& data)
+{
+	if(_saving || data.empty()) {
+		return false;
+	}
+
+	if(data[0] != 2 || _format == SerializeFormat::Text) {
+		std::stringstream stream;
+		stream.write((char*)data.data(), data.size());
+		return LoadFrom(stream);
+	}
+
+	_data = data;
+	return InitPositionalFormat();
+}
+
+bool Serializer::InitPositionalFormat()
+{
+	if(_data.size() < PositionalHeaderSize) {
+		return false;
+	}
+
+	//The caller must check that the layout matches the objects being loaded before streaming them (see GetLayoutHash)
+	memcpy(&_savedLayoutHash, _data.data() + 1, sizeof(uint64_t));
+
+	_pos = PositionalHeaderSize;
+	_format = SerializeFormat::Positional;
+	return true;
+}
+
 bool Serializer::LoadFromTextFormat(istream& file)
 {
 	uint32_t pos = (uint32_t)file.tellg();
@@ -206,7 +248,12 @@ bool Serializer::LoadFromTextFormat(istream& file)
 
 void Serializer::SaveTo(ostream& file, int compressionLevel)
 {
-	if(_format == SerializeFormat::Text) {
+	if(_format == SerializeFormat::Positional) {
+		//Always uncompressed
+		_data[0] = 2;
+		memcpy(_data.data() + 1, &_layoutHash, sizeof(uint64_t));
+		file.write((char*)_data.data(), _data.size());
+	} else if(_format == SerializeFormat::Text) {
 		file.write((char*)_data.data(), _data.size());
 	} else {
 		bool isCompressed = compressionLevel > 0;
@@ -229,6 +276,31 @@ void Serializer::SaveTo(ostream& file, int compressionLevel)
 	}
 }
 
+void Serializer::SaveTo(vector<uint8_t>& out)
+{
+	if(_format == SerializeFormat::Positional) {
+		//The header is already at the start of _data, no need to copy anything
+		_data[0] = 2;
+		memcpy(_data.data() + 1, &_layoutHash, sizeof(uint64_t));
+		out.swap(_data);
+		return;
+	}
+
+	//Binary format only - same output as SaveTo(file, 0), but reuses out's allocation
+	out.resize(_data.size() + 1);
+	out[0] = 0;
+	memcpy(out.data() + 1, _data.data(), _data.size());
+}
+
+void Serializer::ReuseBuffer(vector<uint8_t>& buffer)
+{
+	//Positional format only - serializes into buffer's allocation (given back by SaveTo(vector))
+	if(_format == SerializeFormat::Positional && _saving && buffer.capacity() > _data.capacity()) {
+		_data.swap(buffer);
+		_data.resize(PositionalHeaderSize);
+	}
+}
+
 void Serializer::LoadFromMap(unordered_map<string, SerializeMapValue>& map)
 {
 	_mapValues = map;
@@ -269,12 +341,21 @@ string Serializer::NormalizeName(const char* name, int index)
 
 void Serializer::PushNamePrefix(const char* name, int index)
 {
+	if(_format == SerializeFormat::Positional) {
+		UpdateLayoutHash(name, index, 0);
+		return;
+	}
+
 	_prefixes.push_back(NormalizeName(name, index));
 	UpdatePrefix();
 }
 
 void Serializer::PopNamePrefix()
 {
+	if(_format == SerializeFormat::Positional) {
+		return;
+	}
+
 	_prefixes.pop_back();
 	UpdatePrefix();
 }
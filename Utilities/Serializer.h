@@ -44,6 +44,49 @@ struct SerializeMapValue
 	SerializeMapValue(string v) : Format(SerializeMapValueFormat::String), Value(false), StringValue(v) {}
 };
 
+//Location and type of a value streamed in Map format - used by the Lua API to read values without serializing the whole state
+struct SerializeMapPointer
+{
+	void* Ptr = nullptr;
+	SerializeMapValueFormat Format = SerializeMapValueFormat::Integer;
+	uint8_t Size = 0;
+	bool IsSigned = false;
+
+	template<typename T>
+	static SerializeMapPointer Create(T& value)
+	{
+		SerializeMapPointer ptr;
+		ptr.Ptr = &value;
+		ptr.Size = (uint8_t)sizeof(T);
+		if constexpr(std::is_same<T, bool>::value) {
+			ptr.Format = SerializeMapValueFormat::Bool;
+		} else if constexpr(std::is_integral<T>::value) {
+			ptr.Format = SerializeMapValueFormat::Integer;
+			ptr.IsSigned = std::is_signed<T>::value;
+		} else if constexpr(std::is_floating_point<T>::value) {
+			ptr.Format = SerializeMapValueFormat::Double;
+		} else if constexpr(std::is_same<T, string>::value) {
+			ptr.Format = SerializeMapValueFormat::String;
+		}
+		return ptr;
+	}
+
+	int64_t ReadInteger()
+	{
+		switch(Size) {
+			case 1: return IsSigned ? (int64_t)*(int8_t*)Ptr : (int64_t)*(uint8_t*)Ptr;
+			case 2: return IsSigned ? (int64_t)*(int16_t*)Ptr : (int64_t)*(uint16_t*)Ptr;
+			case 4: return IsSigned ? (int64_t)*(int32_t*)Ptr : (int64_t)*(uint32_t*)Ptr;
+			default: return *(int64_t*)Ptr;
+		}
+	}
+
+	double ReadDouble()
+	{
+		return Size == sizeof(float) ? (double)*(float*)Ptr : *(double*)Ptr;
+	}
+};
+
 struct SerializeValue
 {
 	uint8_t* DataPtr;
@@ -66,7 +109,11 @@ enum class SerializeFormat
 {
 	Binary,
 	Text,
-	Map
+	Map,
+
+	//Values are stored in the order they are streamed, without their keys - only meant for
+	//in-process snapshots (rewind, run-ahead, etc.) that are loaded by the same build
+	Positional
 };
 
 class Serializer
@@ -81,16 +128,85 @@ private:
 
 	//Used by Lua API
 	unordered_map<string, SerializeMapValue> _mapValues;
+	unordered_map<string, SerializeMapPointer>* _mapPointers = nullptr;
+
+	//Address range of an object being streamed while recording map pointers. An object is stable when it is heap-allocated
+	//(streamed through a smart pointer), is the root object, or is stored inside a stable object's range.
+	struct SerializeOwner
+	{
+		uint8_t* Start;
+		size_t Size;
+		bool Stable;
+	};
+	vector<SerializeOwner> _owners;
 
 	uint32_t _version = 0;
 	bool _saving = false;
 	SerializeFormat _format = SerializeFormat::Binary;
 
+	//Positional format - the layout hash is computed from the names/sizes of all streamed values (and the element count of arrays)
+	static constexpr uint32_t PositionalHeaderSize = 1 + sizeof(uint64_t);
+	uint32_t _pos = 0;
+	uint64_t _layoutHash = 0xCBF29CE484222325;
+	uint64_t _savedLayoutHash = 0;
+	bool _layoutError = false;
+
 private:
 	bool LoadFromTextFormat(istream& file);
+	bool InitPositionalFormat();
 	string NormalizeName(const char* name, int index);
 	void UpdatePrefix();
 
+	__forceinline void UpdateLayoutHash(const char* name, int index, uint32_t size)
+	{
+		//FNV-1a
+		constexpr uint64_t prime = 0x100000001B3;
+		for(const char* c = name; *c; c++) {
+			_layoutHash = (_layoutHash ^ (uint8_t)*c) * prime;
+		}
+		_layoutHash = (_layoutHash ^ (uint32_t)index) * prime;
+		_layoutHash = (_layoutHash ^ size) * prime;
+	}
+
+	template<typename T>
+	void StreamPositional(T& value, const char* name, int index)
+	{
+		UpdateLayoutHash(name, index, sizeof(T));
+		if(_saving) {
+			uint8_t* ptr = (uint8_t*)&value;
+			_data.insert(_data.end(), ptr, ptr + sizeof(T));
+		} else if(_pos + sizeof(T) <= _data.size()) {
+			memcpy(&value, _data.data() + _pos, sizeof(T));
+			_pos += sizeof(T);
+		} else {
+			_layoutError = true;
+		}
+	}
+
+	//Used for arrays/vectors/strings - returns the number of bytes saved in the state for this value
+	uint32_t StreamPositionalSize(uint32_t size, const char* name, int index, uint32_t elementSize)
+	{
+		UpdateLayoutHash(name, index, elementSize);
+		if(_saving) {
+			WriteValue(size);
+			return size;
+		} else {
+			uint32_t savedSize = 0;
+			if(_pos + sizeof(uint32_t) <= _data.size()) {
+				memcpy(&savedSize, _data.data() + _pos, sizeof(uint32_t));
+				_pos += sizeof(uint32_t);
+			} else {
+				_layoutError = true;
+			}
+
+			if(_pos + savedSize > _data.size()) {
+				_layoutError = true;
+				savedSize = 0;
+			}
+			return savedSize;
+		}
+	}
+
 	string GetKey(const char* name, int index)
 	{
 		string valName = NormalizeName(name, index);
@@ -122,6 +238,30 @@ private:
 		}
 	}
 
+	bool IsInOwnerRange(SerializeOwner& owner, void* ptr, size_t size)
+	{
+		uint8_t* start = (uint8_t*)ptr;
+		return start >= owner.Start && start + size <= owner.Start + owner.Size;
+	}
+
+	bool IsStableValue(void* ptr, size_t size)
+	{
+		return !_owners.empty() && _owners.back().Stable && IsInOwnerRange(_owners.back(), ptr, size);
+	}
+
+	void StreamObject(ISerializable& obj, void* objPtr, size_t objSize, bool isHeapObject, const char* name, int index)
+	{
+		if(!_mapPointers) {
+			Stream(obj, name, index);
+			return;
+		}
+
+		bool stable = isHeapObject || _owners.empty() || IsStableValue(objPtr, objSize);
+		_owners.push_back({ (uint8_t*)objPtr, objSize, stable });
+		Stream(obj, name, index);
+		_owners.pop_back();
+	}
+
 	template<typename T>
 	void WriteMapFormat(string& key, T& value)
 	{
@@ -133,7 +273,15 @@ private:
 			_mapValues.try_emplace(key, SerializeMapValueFormat::Double, (double)value);
 		} else if constexpr(std::is_same<T, string>::value) {
 			_mapValues.try_emplace(key, value);
-		}	
+		}
+
+		if constexpr(std::is_same<T, bool>::value || std::is_arithmetic<T>::value || std::is_same<T, string>::value) {
+			//Only values stored inside a stable object can be read later on - anything else (e.g temporaries
+			//streamed from local variables inside Serialize) can only be read by serializing the state again
+			if(_mapPointers && IsStableValue(&value, sizeof(T))) {
+				_mapPointers->try_emplace(key, SerializeMapPointer::Create(value));
+			}
+		}
 	}
 
 	template<typename T>
@@ -221,7 +369,17 @@ public:
 	SerializeFormat GetFormat() { return _format; }
 	unordered_map<string, SerializeMapValue>& GetMapValues() { return _mapValues; }
 
+	//Map format - also records the location of each value that is saved and is stored inside a stable object (see SerializeOwner).
+	//The root object passed to Stream() must outlive the recorded pointers.
+	void SetMapPointers(unordered_map<string, SerializeMapPointer>* pointers) { _mapPointers = pointers; }
+
 	bool IsValid() { return _values.size() > 0; }
+	
+	//Positional format - hash of the layout of the values that were saved (or of the loaded snapshot)
+	uint64_t GetLayoutHash() { return _saving ? _layoutHash : _savedLayoutHash; }
+
+	//Positional format - false if the loaded data doesn't match the layout of the values that were streamed
+	bool IsLayoutValid() { return !_layoutError && _pos == _data.size() && _layoutHash == _savedLayoutHash; }
 	void AddKeyPrefix(string prefix);
 	void RemoveKeyPrefix(string prefix);
 	void RemoveKeys(vector<string>& keys);
@@ -240,7 +398,9 @@ public:
 		static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_base_of<ISerializable, T>::value, "[Serializer] Invalid value type");
 		
 		if constexpr(std::is_base_of<ISerializable, T>::value) {
-			Stream((ISerializable&)value, name, index);
+			StreamObject((ISerializable&)value, &value, sizeof(T), false, name, index);
+		} else if(_format == SerializeFormat::Positional) {
+			StreamPositional(value, name, index);
 		} else {
 			string key = GetKey(name, index);
 
@@ -262,6 +422,7 @@ public:
 
 					case SerializeFormat::Text: WriteTextFormat(key, value); break;
 					case SerializeFormat::Map: WriteMapFormat(key, value); break;
+					case SerializeFormat::Positional: break; //Handled by StreamPositional above
 				}
 			} else {
 				switch(_format) {
@@ -295,6 +456,10 @@ public:
 					case SerializeFormat::Map:
 						ReadMapFormat(key, value);
 						break;
+
+					case SerializeFormat::Positional:
+						//Handled by StreamPositional above
+						break;
 				}
 			}
 		}
@@ -310,39 +475,41 @@ public:
 	template<typename T> void Stream(unique_ptr<T>& obj, const char* name, int index = -1)
 	{
 		static_assert(std::is_base_of<ISerializable, T>::value, "[Serializer] Object does not implement ISerializable");
-		PushNamePrefix(name, index);
-		((ISerializable*)obj.get())->Serialize(*this);
-		PopNamePrefix();
+		StreamObject(*(ISerializable*)obj.get(), obj.get(), sizeof(T), true, name, index);
 	}
 
 	template<typename T> void Stream(const unique_ptr<T>& obj, const char* name, int index = -1)
 	{
 		static_assert(std::is_base_of<ISerializable, T>::value, "[Serializer] Object does not implement ISerializable");
-		PushNamePrefix(name, index);
-		((ISerializable*)obj.get())->Serialize(*this);
-		PopNamePrefix();
+		StreamObject(*(ISerializable*)obj.get(), obj.get(), sizeof(T), true, name, index);
 	}
 
 	template<typename T> void Stream(shared_ptr<T>& obj, const char* name, int index = -1)
 	{
 		static_assert(std::is_base_of<ISerializable, T>::value, "[Serializer] Object does not implement ISerializable");
-		PushNamePrefix(name, index);
-		((ISerializable*)obj.get())->Serialize(*this);
-		PopNamePrefix();
+		StreamObject(*(ISerializable*)obj.get(), obj.get(), sizeof(T), true, name, index);
 	}
 
 	template<typename T> void Stream(safe_ptr<T>& obj, const char* name, int index = -1)
 	{
 		static_assert(std::is_base_of<ISerializable, T>::value, "[Serializer] Object does not implement ISerializable");
-		PushNamePrefix(name, index);
-		((ISerializable*)obj.get())->Serialize(*this);
-		PopNamePrefix();
+		StreamObject(*(ISerializable*)obj.get(), obj.get(), sizeof(T), true, name, index);
 	}
 
 	template<typename T> void StreamArray(T* arrayValues, uint32_t elementCount, const char* name)
 	{
 		if(_format == SerializeFormat::Map) {
 			return;
+		} else if(_format == SerializeFormat::Positional) {
+			//Arrays have a fixed size, their element count is part of the layout
+			uint32_t size = StreamPositionalSize(elementCount * sizeof(T), name, -1, elementCount * sizeof(T));
+			if(_saving) {
+				_data.insert(_data.end(), (uint8_t*)arrayValues, (uint8_t*)(arrayValues + elementCount));
+			} else {
+				memcpy(arrayValues, _data.data() + _pos, std::min<uint32_t>(size, sizeof(T) * elementCount));
+				_pos += size;
+			}
+			return;
 		}
 
 		string key = GetKey(name, -1);
@@ -392,6 +559,18 @@ public:
 	{
 		if(_format == SerializeFormat::Map) {
 			return;
+		} else if(_format == SerializeFormat::Positional) {
+			uint32_t size = StreamPositionalSize((uint32_t)(values.size() * sizeof(T)), name, index, sizeof(T));
+			if(_saving) {
+				_data.insert(_data.end(), (uint8_t*)values.data(), (uint8_t*)(values.data() + values.size()));
+			} else {
+				values.resize(size / sizeof(T));
+				if(size) {
+					memcpy(values.data(), _data.data() + _pos, values.size() * sizeof(T));
+				}
+				_pos += size;
+			}
+			return;
 		}
 
 		string key = GetKey(name, index);
@@ -432,12 +611,26 @@ public:
 	void PushNamePrefix(const char* name, int index = -1);
 	void PopNamePrefix();
 	void SaveTo(ostream &file, int compressionLevel = 1);
+	void SaveTo(vector<uint8_t>& out);
+	void ReuseBuffer(vector<uint8_t>& buffer);
 	bool LoadFrom(istream& file);
+	bool LoadFrom(const vector<uint8_t>& data);
 	void LoadFromMap(unordered_map<string, SerializeMapValue>& map);
 };
 
 template<> inline void Serializer::Stream(string& value, const char* name, int index)
 {
+	if(_format == SerializeFormat::Positional) {
+		uint32_t size = StreamPositionalSize((uint32_t)value.size(), name, index, 1);
+		if(_saving) {
+			_data.insert(_data.end(), value.begin(), value.end());
+		} else {
+			value = string(_data.data() + _pos, _data.data() + _pos + size);
+			_pos += size;
+		}
+		return;
+	}
+
 	string key = GetKey(name, index);
 
 	CheckDuplicateKey(key);
@@ -0,0 +1,106 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t workerCount)
+{
+	for(uint32_t i = 0; i < workerCount; i++) {
+		_workers.emplace_back(&ThreadPool::WorkerThread, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_stopFlag = true;
+		_workSignal.notify_all();
+	}
+
+	for(std::thread& worker : _workers) {
+		worker.join();
+	}
+}
+
+uint32_t ThreadPool::GetDefaultWorkerCount(uint32_t maxWorkers)
+{
+	uint32_t coreCount = std::thread::hardware_concurrency();
+	if(coreCount <= 1) {
+		return 0;
+	}
+	return std::min(coreCount - 1, maxWorkers);
+}
+
+shared_ptr<ThreadPool> ThreadPool::GetSharedPool()
+{
+	static std::mutex sharedPoolLock;
+	static std::weak_ptr<ThreadPool> sharedPool;
+
+	std::lock_guard<std::mutex> lock(sharedPoolLock);
+	shared_ptr<ThreadPool> pool = sharedPool.lock();
+	if(!pool) {
+		pool.reset(new ThreadPool(GetDefaultWorkerCount(ThreadPool::MaxSharedWorkers)));
+		sharedPool = pool;
+	}
+	return pool;
+}
+
+bool ThreadPool::RunNextJob(std::unique_lock<std::mutex>& lock)
+{
+	if(_nextJob >= _jobCount) {
+		return false;
+	}
+
+	uint32_t jobIndex = _nextJob++;
+	lock.unlock();
+	_job(jobIndex);
+	lock.lock();
+
+	_pendingJobs--;
+	if(_pendingJobs == 0) {
+		_doneSignal.notify_all();
+	}
+	return true;
+}
+
+void ThreadPool::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(true) {
+		_workSignal.wait(lock, [this] { return _stopFlag || _nextJob < _jobCount; });
+		if(_stopFlag) {
+			break;
+		}
+
+		while(RunNextJob(lock)) {
+		}
+	}
+}
+
+void ThreadPool::Run(uint32_t jobCount, std::function<void(uint32_t)> job)
+{
+	if(jobCount == 0) {
+		return;
+	}
+
+	if(_workers.empty() || jobCount == 1) {
+		for(uint32_t i = 0; i < jobCount; i++) {
+			job(i);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> runLock(_runLock);
+	std::unique_lock<std::mutex> lock(_mutex);
+	_job = std::move(job);
+	_jobCount = jobCount;
+	_nextJob = 0;
+	_pendingJobs = jobCount;
+	_workSignal.notify_all();
+
+	//The calling thread processes jobs too, instead of sleeping until the workers are done
+	while(RunNextJob(lock)) {
+	}
+
+	_doneSignal.wait(lock, [this] { return _pendingJobs == 0; });
+	_job = nullptr;
+}
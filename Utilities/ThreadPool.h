@@ -0,0 +1,49 @@
+#pragma once
+#include "pch.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+//Small persistent pool used to split a frame's work into independent jobs
+//The calling thread also processes jobs, so a pool with N workers runs up to N+1 jobs at once
+class ThreadPool
+{
+private:
+	static constexpr uint32_t MaxSharedWorkers = 7;
+
+	vector<std::thread> _workers;
+	std::mutex _runLock;
+	std::mutex _mutex;
+	std::condition_variable _workSignal;
+	std::condition_variable _doneSignal;
+
+	std::function<void(uint32_t)> _job;
+	uint32_t _jobCount = 0;
+	uint32_t _nextJob = 0;
+	uint32_t _pendingJobs = 0;
+	bool _stopFlag = false;
+
+	void WorkerThread();
+	bool RunNextJob(std::unique_lock<std::mutex>& lock);
+
+public:
+	ThreadPool(uint32_t workerCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint32_t GetWorkerCount() { return (uint32_t)_workers.size(); }
+
+	//Runs job(0) to job(jobCount - 1) and returns once all of them are done
+	//Calls from several threads are processed one after the other
+	void Run(uint32_t jobCount, std::function<void(uint32_t)> job);
+
+	//Number of workers that makes sense for this machine (excludes the calling thread)
+	static uint32_t GetDefaultWorkerCount(uint32_t maxWorkers);
+
+	//Pool shared by all the frame processing code (HD packs, scale filters, etc.), to avoid creating
+	//a set of threads for each of them - the pool is destroyed once nothing references it anymore
+	static shared_ptr<ThreadPool> GetSharedPool();
+};
@@ -10,6 +10,7 @@
 #include "Utilities/Patches/IpsPatcher.h"
 #include "Utilities/Patches/UpsPatcher.h"
 #include "Utilities/CRC32.h"
+#include "Utilities/MemoryMappedFile.h"
 
 const std::initializer_list<string> VirtualFile::RomExtensions = {
 	".nes", ".fds", ".unif", ".unf", ".nsf", ".nsfe", ".studybox",
@@ -229,8 +230,98 @@ void VirtualFile::InitChunks()
 {
 	if(!_useChunks) {
 		_useChunks = true;
-		_chunks.resize(GetSize() / VirtualFile::ChunkSize + 1);
+		if(IsArchive()) {
+			//Archives are always fully extracted in memory
+			LoadFile();
+		} else if(_data.empty()) {
+			_mappedFile.reset(new MemoryMappedFile());
+			if(_mappedFile->Open(_path)) {
+				_fileSize = (int64_t)_mappedFile->GetSize();
+			} else {
+				_mappedFile.reset();
+				_chunks.resize(GetSize() / VirtualFile::ChunkSize + 1);
+				_chunkLastUse.resize(_chunks.size());
+			}
+		}
+	}
+}
+
+bool VirtualFile::CreateThreadReader(VirtualFile& reader)
+{
+	//Creates a reader with its own file stream and chunk cache, which can be used on another thread at the same time as this instance.
+	//Returns false when the data is already in memory - it can then be read from any thread through this instance.
+	InitChunks();
+	if(_data.size() > 0) {
+		return false;
+	}
+
+	reader = VirtualFile();
+	reader._path = _path;
+	reader._fileSize = _fileSize;
+	reader._useChunks = true;
+	if(_mappedFile) {
+		//The mapping is read-only and can be shared
+		reader._mappedFile = _mappedFile;
+	} else {
+		reader._chunks.resize(_chunks.size());
+		reader._chunkLastUse.resize(_chunks.size());
+	}
+	return true;
+}
+
+uint8_t* VirtualFile::LoadChunk(uint32_t chunkId)
+{
+	vector<uint8_t>& chunk = _chunks[chunkId];
+	if(chunk.empty()) {
+		if(_cachedChunkCount >= VirtualFile::MaxCachedChunks) {
+			//Evict the least recently used chunk
+			uint32_t lruChunk = 0;
+			uint64_t lruTime = UINT64_MAX;
+			for(uint32_t i = 0; i < (uint32_t)_chunks.size(); i++) {
+				if(!_chunks[i].empty() && _chunkLastUse[i] < lruTime) {
+					lruTime = _chunkLastUse[i];
+					lruChunk = i;
+				}
+			}
+			vector<uint8_t>().swap(_chunks[lruChunk]);
+			_cachedChunkCount--;
+		}
+
+		if(!_chunkStream) {
+			_chunkStream.reset(new ifstream(_path, std::ios::in | std::ios::binary));
+		}
+		if(!_chunkStream->is_open()) {
+			return nullptr;
+		}
+
+		chunk.resize(VirtualFile::ChunkSize);
+		_chunkStream->clear();
+		_chunkStream->seekg((std::streamoff)chunkId * VirtualFile::ChunkSize, std::ios::beg);
+		_chunkStream->read((char*)chunk.data(), VirtualFile::ChunkSize);
+		_cachedChunkCount++;
 	}
+
+	_chunkLastUse[chunkId] = ++_chunkUseCounter;
+	return chunk.data();
+}
+
+const uint8_t* VirtualFile::GetSpan(uint32_t offset, uint32_t& length)
+{
+	//Returns a pointer to the data at the given offset, and reduces length to the number of contiguous bytes available
+	if(_data.size() > 0) {
+		return _data.data() + offset;
+	} else if(_mappedFile) {
+		return _mappedFile->GetData() + offset;
+	} else if(_chunks.empty()) {
+		return nullptr;
+	}
+
+	uint32_t chunkId = offset / VirtualFile::ChunkSize;
+	uint32_t chunkOffset = offset - chunkId * VirtualFile::ChunkSize;
+	length = std::min(length, VirtualFile::ChunkSize - chunkOffset);
+
+	uint8_t* chunk = LoadChunk(chunkId);
+	return chunk ? chunk + chunkOffset : nullptr;
 }
 
 bool VirtualFile::ReadFile(vector<uint8_t>& out)
@@ -267,21 +358,36 @@ bool VirtualFile::ReadFile(uint8_t* out, uint32_t expectedSize)
 uint8_t VirtualFile::ReadByte(uint32_t offset)
 {
 	InitChunks();
-	if(offset < 0 || offset > GetSize()) {
+	if(offset >= GetSize()) {
 		//Out of bounds
 		return 0;
 	}
 
-	uint32_t chunkId = offset / VirtualFile::ChunkSize;
-	uint32_t chunkStart = chunkId * VirtualFile::ChunkSize;
-	if(_chunks[chunkId].size() == 0) {
-		ifstream input(_path, std::ios::in | std::ios::binary);
-		input.seekg(chunkStart, std::ios::beg);
+	uint32_t length = 1;
+	const uint8_t* data = GetSpan(offset, length);
+	return data ? *data : 0;
+}
+
+bool VirtualFile::ReadSpan(uint32_t offset, uint8_t* out, uint32_t length)
+{
+	InitChunks();
+	if((size_t)offset + length > GetSize()) {
+		//Out of bounds
+		return false;
+	}
 
-		_chunks[chunkId].resize(VirtualFile::ChunkSize);
-		input.read((char*)_chunks[chunkId].data(), VirtualFile::ChunkSize);
+	while(length > 0) {
+		uint32_t size = length;
+		const uint8_t* data = GetSpan(offset, size);
+		if(!data) {
+			return false;
+		}
+		memcpy(out, data, size);
+		out += size;
+		offset += size;
+		length -= size;
 	}
-	return _chunks[chunkId][offset - chunkStart];
+	return true;
 }
 
 bool VirtualFile::ApplyPatch(VirtualFile& patch)
@@ -2,10 +2,13 @@
 #include "pch.h"
 #include <sstream>
 
+class MemoryMappedFile;
+
 class VirtualFile
 {
 private:
-	constexpr static int ChunkSize = 256 * 1024;
+	constexpr static uint32_t ChunkSize = 256 * 1024;
+	constexpr static uint32_t MaxCachedChunks = 128;
 
 	string _path = "";
 	string _innerFile = "";
@@ -13,13 +16,23 @@ private:
 	vector<uint8_t> _data;
 	int64_t _fileSize = -1;
 
+	//Plain files are memory mapped when possible, otherwise they are read in chunks.
+	//Chunks are kept in a LRU cache, to avoid keeping large disc images entirely in memory
+	shared_ptr<MemoryMappedFile> _mappedFile;
+	shared_ptr<ifstream> _chunkStream;
 	vector<vector<uint8_t>> _chunks;
+	vector<uint64_t> _chunkLastUse;
+	uint64_t _chunkUseCounter = 0;
+	uint32_t _cachedChunkCount = 0;
 	bool _useChunks = false;
 
 	void FromStream(std::istream &input, vector<uint8_t> &output);
 
 	void LoadFile();
 
+	uint8_t* LoadChunk(uint32_t chunkId);
+	const uint8_t* GetSpan(uint32_t offset, uint32_t& length);
+
 public:
 	static const std::initializer_list<string> RomExtensions;
 
@@ -43,12 +56,14 @@ public:
 	size_t GetSize();
 	bool CheckFileSignature(vector<string> signatures, bool loadArchives = false);
 	void InitChunks();
+	bool CreateThreadReader(VirtualFile& reader);
 
 	bool ReadFile(vector<uint8_t> &out);
 	bool ReadFile(std::stringstream &out);
 	bool ReadFile(uint8_t* out, uint32_t expectedSize);
 
 	uint8_t ReadByte(uint32_t offset);
+	bool ReadSpan(uint32_t offset, uint8_t* out, uint32_t length);
 
 	bool ApplyPatch(VirtualFile &patch);
 
@@ -56,13 +71,22 @@ public:
 	bool ReadChunk(T& container, int start, int length)
 	{
 		InitChunks();
-		if(start < 0 || start + length > GetSize()) {
+		if(start < 0 || length < 0 || (size_t)start + length > GetSize()) {
 			//Out of bounds
 			return false;
 		}
 
-		for(int i = start, end = start + length; i < end; i++) {
-			container.push_back(ReadByte(i));
+		uint32_t offset = (uint32_t)start;
+		uint32_t remaining = (uint32_t)length;
+		while(remaining > 0) {
+			uint32_t size = remaining;
+			const uint8_t* data = GetSpan(offset, size);
+			if(!data) {
+				return false;
+			}
+			container.insert(container.end(), data, data + size);
+			offset += size;
+			remaining -= size;
 		}
 
 		return true;